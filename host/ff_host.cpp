@@ -0,0 +1,183 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+// The subset of the FatFs API used by the emulation core implemented on top of stdio.
+// Paths are used as is so images are read from and written to the host's file system.
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "ff.h"
+
+// The owning FATFS is never used on the host so the FILE is kept there.
+static inline FILE* GetFile(FIL* fp)
+{
+	return (FILE*)fp->obj.fs;
+}
+
+static FRESULT ErrnoToFRESULT()
+{
+	switch (errno)
+	{
+		case ENOENT:
+			return FR_NO_FILE;
+		case EACCES:
+		case EPERM:
+			return FR_DENIED;
+		case EEXIST:
+			return FR_EXIST;
+		case EROFS:
+			return FR_WRITE_PROTECTED;
+		default:
+			return FR_DISK_ERR;
+	}
+}
+
+FRESULT f_open(FIL* fp, const TCHAR* path, BYTE mode)
+{
+	const char* fmode;
+	FILE* file;
+
+	if (!fp)
+		return FR_INVALID_OBJECT;
+
+	memset(fp, 0, sizeof(FIL));
+
+	if (mode & FA_CREATE_NEW)
+	{
+		file = fopen(path, "rb");
+		if (file)
+		{
+			fclose(file);
+			return FR_EXIST;
+		}
+	}
+
+	if (mode & (FA_CREATE_ALWAYS | FA_CREATE_NEW))
+		fmode = (mode & FA_READ) ? "w+b" : "wb";
+	else if (mode & FA_WRITE)
+		fmode = "r+b";
+	else
+		fmode = "rb";
+
+	file = fopen(path, fmode);
+	if (!file && (mode & FA_OPEN_ALWAYS))
+		file = fopen(path, "w+b");
+	if (!file)
+		return ErrnoToFRESULT();
+
+	fseek(file, 0, SEEK_END);
+	fp->obj.objsize = ftell(file);
+	if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND)
+		fp->fptr = fp->obj.objsize;
+	else
+		fseek(file, 0, SEEK_SET);
+
+	fp->obj.fs = (FATFS*)file;
+	fp->flag = mode;
+	return FR_OK;
+}
+
+FRESULT f_close(FIL* fp)
+{
+	FILE* file = GetFile(fp);
+	if (!file)
+		return FR_INVALID_OBJECT;
+	fclose(file);
+	fp->obj.fs = 0;
+	return FR_OK;
+}
+
+FRESULT f_read(FIL* fp, void* buff, UINT btr, UINT* br)
+{
+	FILE* file = GetFile(fp);
+	if (!file)
+		return FR_INVALID_OBJECT;
+	*br = fread(buff, 1, btr, file);
+	fp->fptr += *br;
+	return ferror(file) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_write(FIL* fp, const void* buff, UINT btw, UINT* bw)
+{
+	FILE* file = GetFile(fp);
+	if (!file)
+		return FR_INVALID_OBJECT;
+	*bw = fwrite(buff, 1, btw, file);
+	fp->fptr += *bw;
+	if (fp->fptr > fp->obj.objsize)
+		fp->obj.objsize = fp->fptr;
+	return ferror(file) ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_lseek(FIL* fp, FSIZE_t ofs)
+{
+	FILE* file = GetFile(fp);
+	if (!file)
+		return FR_INVALID_OBJECT;
+	if (fseek(file, ofs, SEEK_SET) != 0)
+		return FR_DISK_ERR;
+	fp->fptr = ofs;
+	return FR_OK;
+}
+
+FRESULT f_sync(FIL* fp)
+{
+	FILE* file = GetFile(fp);
+	if (!file)
+		return FR_INVALID_OBJECT;
+	return fflush(file) == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_stat(const TCHAR* path, FILINFO* fno)
+{
+	struct stat st;
+	if (stat(path, &st) != 0)
+		return ErrnoToFRESULT();
+	if (fno)
+	{
+		const char* name = strrchr(path, '/');
+		name = name ? name + 1 : path;
+		memset(fno, 0, sizeof(FILINFO));
+		fno->fsize = st.st_size;
+		fno->fattrib = S_ISDIR(st.st_mode) ? AM_DIR : 0;
+		strncpy(fno->fname, name, sizeof(fno->fname) - 1);
+	}
+	return FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR* path)
+{
+	return remove(path) == 0 ? FR_OK : ErrnoToFRESULT();
+}
+
+FRESULT f_rename(const TCHAR* path_old, const TCHAR* path_new)
+{
+	return rename(path_old, path_new) == 0 ? FR_OK : ErrnoToFRESULT();
+}
+
+FRESULT f_utime(const TCHAR* path, const FILINFO* fno)
+{
+	return FR_OK;
+}
+
+FRESULT f_mkdir(const TCHAR* path)
+{
+	return mkdir(path, 0777) == 0 ? FR_OK : ErrnoToFRESULT();
+}
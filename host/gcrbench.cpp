@@ -0,0 +1,353 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+// Microbenchmark of the GCR kernels.
+// The reference versions are the original nibble at a time conversions from gcr.cpp and DiskImage::DecodeBlock,
+// and the bit at a time and byte at a time SYNC searches from DiskImage::FindSync and gcr.cpp's find_sync.
+
+#include <stdio.h>
+#include <string.h>
+#include "gcrbench.h"
+#include "hal.h"
+#include "gcr.h"
+
+#define TRACK_BYTES 7928	// Longest G64 track
+#define GROUPS ((TRACK_BYTES - 1) / 5)
+#define PASSES 2000
+#define SECTORS 21
+#define SECTOR_BYTES 361	// GCR bytes convert_sector_to_GCR lays down per sector
+
+static const u8 referenceEncode[16] =
+{
+	0x0a, 0x0b, 0x12, 0x13,
+	0x0e, 0x0f, 0x16, 0x17,
+	0x09, 0x19, 0x1a, 0x1b,
+	0x0d, 0x1d, 0x1e, 0x15
+};
+
+static const u8 referenceDecodeHigh[32] =
+{
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x80, 0x00, 0x10, 0xff, 0xc0, 0x40, 0x50,
+	0xff, 0xff, 0x20, 0x30, 0xff, 0xf0, 0x60, 0x70,
+	0xff, 0x90, 0xa0, 0xb0, 0xff, 0xd0, 0xe0, 0xff
+};
+
+static const u8 referenceDecodeLow[32] =
+{
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x08, 0x00, 0x01, 0xff, 0x0c, 0x04, 0x05,
+	0xff, 0xff, 0x02, 0x03, 0xff, 0x0f, 0x06, 0x07,
+	0xff, 0x09, 0x0a, 0x0b, 0xff, 0x0d, 0x0e, 0xff
+};
+
+static u8 plain[GROUPS * 4];
+static u8 track[TRACK_BYTES];
+static u8 reference[TRACK_BYTES];
+static u8 candidate[TRACK_BYTES];
+
+static inline u32 Random(u32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void ReferenceEncode(const u8* buffer, u8* ptr)
+{
+	ptr[0] = (referenceEncode[buffer[0] >> 4] << 3) | (referenceEncode[buffer[0] & 0x0f] >> 2);
+	ptr[1] = (referenceEncode[buffer[0] & 0x0f] << 6) | (referenceEncode[buffer[1] >> 4] << 1) | (referenceEncode[buffer[1] & 0x0f] >> 4);
+	ptr[2] = (referenceEncode[buffer[1] & 0x0f] << 4) | (referenceEncode[buffer[2] >> 4] >> 1);
+	ptr[3] = (referenceEncode[buffer[2] >> 4] << 7) | (referenceEncode[buffer[2] & 0x0f] << 2) | (referenceEncode[buffer[3] >> 4] >> 3);
+	ptr[4] = (referenceEncode[buffer[3] >> 4] << 5) | referenceEncode[buffer[3] & 0x0f];
+}
+
+static int ReferenceDecode(const u8* gcr, u8* out)
+{
+	unsigned index[8];
+	int bad = -1;
+
+	index[0] = gcr[0] >> 3;
+	index[1] = ((gcr[0] << 2) | (gcr[1] >> 6)) & 0x1f;
+	index[2] = (gcr[1] >> 1) & 0x1f;
+	index[3] = ((gcr[1] << 4) | (gcr[2] >> 4)) & 0x1f;
+	index[4] = ((gcr[2] << 1) | (gcr[3] >> 7)) & 0x1f;
+	index[5] = (gcr[3] >> 2) & 0x1f;
+	index[6] = ((gcr[3] << 3) | (gcr[4] >> 5)) & 0x1f;
+	index[7] = gcr[4] & 0x1f;
+
+	for (int i = 0; i < 4; ++i)
+	{
+		u8 high = referenceDecodeHigh[index[i * 2]];
+		u8 low = referenceDecodeLow[index[i * 2 + 1]];
+		if ((high == 0xff || low == 0xff) && bad < 0)
+			bad = i;
+		out[i] = high | low;
+	}
+	return bad < 0 ? 4 : bad;
+}
+
+// DiskImage::DecodeBlock as it was, without the wrap round the end of the track.
+static void ReferenceDecodeShifted(const u8* gcr, int shift, u8* out, int groups)
+{
+	u8 group[5];
+	u8 byte = gcr[0] << shift;
+
+	for (int i = 0; i < groups; ++i, out += 4)
+	{
+		for (int j = 0; j < 5; ++j)
+		{
+			gcr++;
+			if (shift)
+			{
+				group[j] = byte | ((gcr[0] << shift) >> 8);
+				byte = gcr[0] << shift;
+			}
+			else
+			{
+				group[j] = byte;
+				byte = gcr[0];
+			}
+		}
+		ReferenceDecode(group, out);
+	}
+}
+
+static int ReferenceFindSync(const u8* track, unsigned length, int bitIndex, int maxBits)
+{
+	int readShiftRegister = 0;
+	u8 byte = track[bitIndex >> 3] << (bitIndex & 7);
+
+	while (maxBits--)
+	{
+		if (byte & 0x80)
+		{
+			readShiftRegister = (readShiftRegister << 1) | 1;
+		}
+		else
+		{
+			if (~readShiftRegister & 0x3ff)
+				readShiftRegister <<= 1;
+			else
+				return bitIndex;
+		}
+		if (~bitIndex & 7)
+		{
+			bitIndex++;
+			byte <<= 1;
+		}
+		else
+		{
+			bitIndex++;
+			if (bitIndex >= int(length << 3))
+				bitIndex = 0;
+			byte = track[bitIndex >> 3];
+		}
+	}
+	return -1;
+}
+
+static int ReferenceFindSyncBytes(u8** gcr, u8* end)
+{
+	while (1)
+	{
+		if ((*gcr) + 1 >= end)
+		{
+			*gcr = end;
+			return 0;
+		}
+		if (((*gcr)[0] & 0x03) == 0x03 && (*gcr)[1] == 0xff)
+			break;
+		(*gcr)++;
+	}
+
+	(*gcr)++;
+	while (*gcr < end && **gcr == 0xff)
+		(*gcr)++;
+	return (*gcr < end);
+}
+
+static void Report(const char* name, u64 referenceTime, u64 candidateTime, double count, const char* unit)
+{
+	printf("%-16s reference %7.2fns/%s  new %7.2fns/%s  x%.2f\r\n", name,
+		referenceTime * 1000.0 / count, unit, candidateTime * 1000.0 / count, unit,
+		candidateTime ? (double)referenceTime / candidateTime : 0.0);
+}
+
+static bool Compare(const char* name, const u8* a, const u8* b, unsigned length)
+{
+	for (unsigned i = 0; i < length; ++i)
+	{
+		if (a[i] != b[i])
+		{
+			printf("gcrbench: %s differs at byte %u (%02x != %02x)\r\n", name, i, a[i], b[i]);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool RunGCRBenchmark(u32 seed)
+{
+	u32 random = seed ? seed : 1;
+	u64 before, referenceTime, candidateTime;
+	int pass, group, shift;
+
+	for (unsigned i = 0; i < sizeof(plain); ++i)
+		plain[i] = (u8)Random(random);
+
+	// Encode
+	referenceTime = candidateTime = 0;
+	for (pass = 0; pass < PASSES; ++pass)
+	{
+		plain[pass % sizeof(plain)] = (u8)Random(random);
+
+		before = HAL_GetMicroSeconds();
+		for (group = 0; group < GROUPS; ++group)
+			ReferenceEncode(plain + group * 4, reference + group * 5);
+		referenceTime += HAL_GetMicroSeconds() - before;
+
+		before = HAL_GetMicroSeconds();
+		convert_bytes_to_GCR(plain, candidate, GROUPS);
+		candidateTime += HAL_GetMicroSeconds() - before;
+
+		if (!Compare("encode", reference, candidate, GROUPS * 5))
+			return false;
+	}
+	Report("encode", referenceTime, candidateTime, (double)GROUPS * PASSES, "group");
+
+	// The track to decode is the encoded data with random bytes dropped in so bad GCR codes are seen too.
+	memcpy(track, candidate, GROUPS * 5);
+	for (unsigned i = GROUPS * 5; i < TRACK_BYTES; ++i)
+		track[i] = (u8)Random(random);
+	for (unsigned i = 0; i < TRACK_BYTES / 16; ++i)
+		track[Random(random) % TRACK_BYTES] = (u8)Random(random);
+
+	// Decode a group at a time, as the gcr.cpp sector extraction does
+	referenceTime = candidateTime = 0;
+	for (pass = 0; pass < PASSES; ++pass)
+	{
+		int referenceConverted = 0;
+		int candidateConverted = 0;
+
+		before = HAL_GetMicroSeconds();
+		for (group = 0; group < GROUPS; ++group)
+			referenceConverted += ReferenceDecode(track + group * 5, reference + group * 4);
+		referenceTime += HAL_GetMicroSeconds() - before;
+
+		before = HAL_GetMicroSeconds();
+		for (group = 0; group < GROUPS; ++group)
+			candidateConverted += convert_4bytes_from_GCR(track + group * 5, candidate + group * 4);
+		candidateTime += HAL_GetMicroSeconds() - before;
+
+		if (!Compare("decode", reference, candidate, GROUPS * 4))
+			return false;
+		if (referenceConverted != candidateConverted)
+		{
+			printf("gcrbench: decode bad GCR counts differ (%d != %d)\r\n", referenceConverted, candidateConverted);
+			return false;
+		}
+		track[Random(random) % TRACK_BYTES] = (u8)Random(random);
+	}
+	Report("decode", referenceTime, candidateTime, (double)GROUPS * PASSES, "group");
+
+	// Decode from every bit position, as DiskImage::DecodeBlock does
+	referenceTime = candidateTime = 0;
+	for (pass = 0; pass < PASSES; ++pass)
+	{
+		shift = pass & 7;
+
+		before = HAL_GetMicroSeconds();
+		ReferenceDecodeShifted(track, shift, reference, GROUPS);
+		referenceTime += HAL_GetMicroSeconds() - before;
+
+		before = HAL_GetMicroSeconds();
+		convert_bytes_from_GCR(track, shift, candidate, GROUPS);
+		candidateTime += HAL_GetMicroSeconds() - before;
+
+		if (!Compare("shifted decode", reference, candidate, GROUPS * 4))
+			return false;
+	}
+	Report("shifted decode", referenceTime, candidateTime, (double)GROUPS * PASSES, "group");
+
+	// A track of sectors with random data, rotated by a random number of bits each pass.
+	u8 diskID[3] = { 0x41, 0x42, 0 };
+	memset(track, 0x55, TRACK_BYTES);
+	for (int sector = 0; sector < SECTORS; ++sector)
+		convert_sector_to_GCR(plain + sector, track + sector * SECTOR_BYTES, 1, sector, diskID, SECTOR_OK, SECTOR_BYTES);
+
+	// Walk every SYNC round the track bit by bit, as DiskImage::IndexSectors does
+	referenceTime = candidateTime = 0;
+	for (pass = 0; pass < PASSES; ++pass)
+	{
+		int start = Random(random) % (TRACK_BYTES * 8);
+		int referenceIndex[SECTORS * 2];
+		int candidateIndex[SECTORS * 2];
+		int sync, index;
+
+		before = HAL_GetMicroSeconds();
+		for (sync = 0, index = start; sync < SECTORS * 2; ++sync)
+			index = referenceIndex[sync] = ReferenceFindSync(track, TRACK_BYTES, index, TRACK_BYTES * 8);
+		referenceTime += HAL_GetMicroSeconds() - before;
+
+		before = HAL_GetMicroSeconds();
+		for (sync = 0, index = start; sync < SECTORS * 2; ++sync)
+			index = candidateIndex[sync] = find_sync_bits(track, TRACK_BYTES, index, TRACK_BYTES * 8, 0);
+		candidateTime += HAL_GetMicroSeconds() - before;
+
+		for (sync = 0; sync < SECTORS * 2; ++sync)
+		{
+			if (referenceIndex[sync] != candidateIndex[sync])
+			{
+				printf("gcrbench: sync search from %d differs (%d != %d)\r\n", start, referenceIndex[sync], candidateIndex[sync]);
+				return false;
+			}
+		}
+	}
+	Report("sync search", referenceTime, candidateTime, (double)PASSES * SECTORS * 2, "sync");
+
+	// And byte by byte, as the gcr.cpp NIB analysis does
+	referenceTime = candidateTime = 0;
+	for (pass = 0; pass < PASSES; ++pass)
+	{
+		u8* referencePosition = track + Random(random) % TRACK_BYTES;
+		u8* candidatePosition = referencePosition;
+		int syncs = 0;
+
+		before = HAL_GetMicroSeconds();
+		while (ReferenceFindSyncBytes(&referencePosition, track + TRACK_BYTES))
+			syncs++;
+		referenceTime += HAL_GetMicroSeconds() - before;
+
+		before = HAL_GetMicroSeconds();
+		while (find_sync(&candidatePosition, track + TRACK_BYTES))
+			syncs--;
+		candidateTime += HAL_GetMicroSeconds() - before;
+
+		if (syncs)
+		{
+			printf("gcrbench: byte sync search found %d more syncs\r\n", syncs);
+			return false;
+		}
+	}
+	Report("byte sync search", referenceTime, candidateTime, (double)PASSES * TRACK_BYTES, "byte");
+
+	printf("gcrbench: kernels match\r\n");
+	return true;
+}
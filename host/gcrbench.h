@@ -0,0 +1,28 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef GCRBENCH_H
+#define GCRBENCH_H
+
+#include "types.h"
+
+// Times the many group GCR encode and decode kernels and the word at a time SYNC searches in gcr.cpp against the code they replaced.
+// Both are fed the same random data (valid GCR and not) and must produce the same results. Returns false at the first difference.
+bool RunGCRBenchmark(u32 seed);
+
+#endif
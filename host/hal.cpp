@@ -0,0 +1,162 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#include "hal.h"
+#include <string.h>
+#include <time.h>
+#include "InputMappings.h"
+extern "C"
+{
+#include "rpi-gpio.h"
+#include "rpiHardware.h"
+}
+
+static u32 DefaultReadGPIOLevels(void*)
+{
+	return 0xffffffff;
+}
+
+static void DefaultWriteGPIO(void*, unsigned int, u32)
+{
+}
+
+static u64 DefaultReadMicroSeconds(void*)
+{
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static HostHAL hal = { DefaultReadGPIOLevels, DefaultWriteGPIO, DefaultReadMicroSeconds, 0 };
+
+// Backing store for the GPIO block so code that touches RPI_GpioBase directly (eg pull up setup) still works.
+static u32 gpioRegisters[sizeof(rpi_gpio_t) / sizeof(u32)];
+rpi_gpio_t* RPI_GpioBase = (rpi_gpio_t*)gpioRegisters;
+
+static u32 gpioOutputs = 0;
+
+void HAL_Install(const HostHAL* newHAL)
+{
+	hal.ReadGPIOLevels = (newHAL && newHAL->ReadGPIOLevels) ? newHAL->ReadGPIOLevels : DefaultReadGPIOLevels;
+	hal.WriteGPIO = (newHAL && newHAL->WriteGPIO) ? newHAL->WriteGPIO : DefaultWriteGPIO;
+	hal.ReadMicroSeconds = (newHAL && newHAL->ReadMicroSeconds) ? newHAL->ReadMicroSeconds : DefaultReadMicroSeconds;
+	hal.context = newHAL ? newHAL->context : 0;
+}
+
+void HAL_Reset()
+{
+	HAL_Install(0);
+	memset(&gpioRegisters, 0, sizeof(gpioRegisters));
+	gpioOutputs = 0;
+}
+
+u32 HAL_GetGPIOOutputs()
+{
+	return gpioOutputs;
+}
+
+u64 HAL_GetMicroSeconds()
+{
+	return hal.ReadMicroSeconds(hal.context);
+}
+
+extern "C"
+{
+	u32 HAL_Read32(unsigned int nAddress)
+	{
+		switch (nAddress)
+		{
+			case ARM_GPIO_GPLEV0:
+				return hal.ReadGPIOLevels(hal.context);
+			case ARM_SYSTIMER_CLO:
+				return (u32)hal.ReadMicroSeconds(hal.context);
+			case ARM_SYSTIMER_CHI:
+				return (u32)(hal.ReadMicroSeconds(hal.context) >> 32);
+			default:
+				if (nAddress >= RPI_GPIO_BASE && nAddress < RPI_GPIO_BASE + sizeof(rpi_gpio_t))
+					return gpioRegisters[(nAddress - RPI_GPIO_BASE) >> 2];
+				break;
+		}
+		return 0;
+	}
+
+	void HAL_Write32(unsigned int nAddress, u32 nValue)
+	{
+		if (nAddress >= RPI_GPIO_BASE && nAddress < RPI_GPIO_BASE + sizeof(rpi_gpio_t))
+		{
+			switch (nAddress)
+			{
+				case ARM_GPIO_GPSET0:
+					gpioOutputs |= nValue;
+					break;
+				case ARM_GPIO_GPCLR0:
+					gpioOutputs &= ~nValue;
+					break;
+				default:
+					gpioRegisters[(nAddress - RPI_GPIO_BASE) >> 2] = nValue;
+					break;
+			}
+			hal.WriteGPIO(hal.context, nAddress, nValue);
+		}
+	}
+
+	void RPI_SetGpioPinFunction(rpi_gpio_pin_t gpio, rpi_gpio_alt_function_t func)
+	{
+		u32 value = gpioRegisters[gpio / 10];
+		value &= ~(FS_MASK << ((gpio % 10) * 3));
+		value |= (func << ((gpio % 10) * 3));
+		HAL_Write32(ARM_GPIO_GPFSEL0 + (gpio / 10) * 4, value);
+	}
+
+	void RPI_SetGpioOutput(rpi_gpio_pin_t gpio)
+	{
+		RPI_SetGpioPinFunction(gpio, FS_OUTPUT);
+	}
+
+	void RPI_SetGpioInput(rpi_gpio_pin_t gpio)
+	{
+		RPI_SetGpioPinFunction(gpio, FS_INPUT);
+	}
+
+	u32 HAL_ReadCycleCounter(void)
+	{
+		timespec ts;
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		return (u32)((u64)ts.tv_sec * 1000000000 + ts.tv_nsec);
+	}
+
+	void SetACTLed(int value)
+	{
+	}
+
+	void usDelay(unsigned nMicroSeconds)
+	{
+		u64 before = hal.ReadMicroSeconds(hal.context);
+		while (hal.ReadMicroSeconds(hal.context) - before < nMicroSeconds)
+		{
+		}
+	}
+}
+
+// These normally live in InputMappings.cpp which pulls in the USB keyboard.
+// IEC_Bus only needs the button indices.
+u8 InputMappings::INPUT_BUTTON_ENTER = 0;
+u8 InputMappings::INPUT_BUTTON_UP = 1;
+u8 InputMappings::INPUT_BUTTON_DOWN = 2;
+u8 InputMappings::INPUT_BUTTON_BACK = 3;
+u8 InputMappings::INPUT_BUTTON_INSERT = 4;
@@ -0,0 +1,53 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HAL_H
+#define HAL_H
+
+#include "types.h"
+
+// Hardware abstraction used by the host build.
+// On the Pi IEC_Bus and the 1MHz sync talk straight to the GPIO and system timer registers via read32/write32.
+// On the host rpiHardware.h routes those accesses to HAL_Read32/HAL_Write32 which emulate the registers
+// and forward the interesting ones to whatever HostHAL has been plugged in.
+struct HostHAL
+{
+	// Returns the level of GPIO bank 0 (ie what IEC_Bus reads from ARM_GPIO_GPLEV0).
+	// Remember the IEC lines are active low so a released bus reads as all ones.
+	u32 (*ReadGPIOLevels)(void* context);
+	// Called for every write to the GPIO block (GPSET0, GPCLR0 and the GPFSEL registers).
+	void (*WriteGPIO)(void* context, unsigned int address, u32 value);
+	// Free running micro second counter (ie ARM_SYSTIMER_CLO/CHI).
+	u64 (*ReadMicroSeconds)(void* context);
+	void* context;
+};
+
+// Plug in a HAL. Any callback left as 0 falls back to the default behaviour;
+// a released IEC bus with no buttons pressed, writes ignored and the host's monotonic clock.
+void HAL_Install(const HostHAL* hal);
+void HAL_Reset();
+
+// The state of the GPIO outputs as last written by the emulator.
+u32 HAL_GetGPIOOutputs();
+
+u64 HAL_GetMicroSeconds();
+
+// read_cycle_counter() on the host is the monotonic clock in nano seconds (ie a 1000MHz ARM).
+#define HAL_CYCLE_COUNTER_1MHZ 1000
+
+#endif
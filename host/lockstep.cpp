@@ -0,0 +1,609 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+// Lockstep comparison of the 6502 dispatch engines.
+// Each engine gets its own copy of a 64K RAM filled with random bytes and every bus access is logged.
+// After every cycle the logs, registers and SYNC must match exactly.
+//
+// And of the 1541 drive engines.
+// Each one is run in turn from power on and every cycle recorded then compared, which also times them on their own.
+
+#include <stdio.h>
+#include <string.h>
+#include "lockstep.h"
+#include "hal.h"
+#include "m6502.h"
+#include "m6502switch.h"
+#include "m6522.h"
+#include "m8520.h"
+#include "Drive.h"
+
+#define PROGRAM_CYCLES 0x10000	// Cycles to run before loading a new random program.
+#define MAX_ACCESSES 8
+
+struct TraceMemory
+{
+	u8 memory[0x10000];
+	u32 accesses[MAX_ACCESSES];	// write << 24 | address << 8 | value
+	unsigned count;
+
+	inline void Log(u16 address, u8 value, bool write)
+	{
+		if (count < MAX_ACCESSES)
+			accesses[count] = (write << 24) | (address << 8) | value;
+		count++;
+	}
+};
+
+static TraceMemory reference;
+static TraceMemory candidate;
+
+static u8 ReadReference(u16 address)
+{
+	u8 value = reference.memory[address];
+	reference.Log(address, value, false);
+	return value;
+}
+
+static void WriteReference(u16 address, const u8 value)
+{
+	reference.memory[address] = value;
+	reference.Log(address, value, true);
+}
+
+static u8 ReadCandidate(u16 address)
+{
+	u8 value = candidate.memory[address];
+	candidate.Log(address, value, false);
+	return value;
+}
+
+static void WriteCandidate(u16 address, const u8 value)
+{
+	candidate.memory[address] = value;
+	candidate.Log(address, value, true);
+}
+
+static inline u32 Random(u32& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+static void LoadProgram(TraceMemory& trace, u32& random)
+{
+	for (unsigned address = 0; address < sizeof(trace.memory); ++address)
+		trace.memory[address] = (u8)Random(random);
+}
+
+// Drive the IRQ and SO lines from the random stream.
+template <class CPU>
+static inline void RandomEvents(CPU& cpu, u32& random, bool& irq)
+{
+	u32 events = Random(random);
+	if ((events & 0x1f) == 0)
+	{
+		irq = !irq;
+		if (irq)
+			cpu.IRQ.Assert();
+		else
+			cpu.IRQ.Release();
+	}
+	if ((events & 0x3ff00) == 0)
+		cpu.SO();
+}
+
+// Run one engine on its own through the same programs and events as the comparison and time it.
+// The time taken to generate the programs is not included.
+template <class CPU>
+static u64 TimeEngine(CPU& cpu, TraceMemory& trace, u64 cycles, u32 seed)
+{
+	u32 random = seed ? seed : 1;
+	bool irq = false;
+	u64 elapsed = 0;
+	u64 cycle = 0;
+
+	while (cycle < cycles)
+	{
+		u64 blockCycles = cycles - cycle < PROGRAM_CYCLES ? cycles - cycle : PROGRAM_CYCLES;
+
+		LoadProgram(trace, random);
+		u64 before = HAL_GetMicroSeconds();
+		cpu.Reset();
+		for (u64 i = 0; i < blockCycles; ++i)
+		{
+			RandomEvents(cpu, random, irq);
+			trace.count = 0;
+			cpu.Step();
+		}
+		elapsed += HAL_GetMicroSeconds() - before;
+		cycle += blockCycles;
+	}
+	return elapsed;
+}
+
+static void DumpAccesses(const char* name, const TraceMemory& trace)
+{
+	printf("  %s %u accesses:", name, trace.count);
+	for (unsigned i = 0; i < trace.count && i < MAX_ACCESSES; ++i)
+		printf(" %c%04x=%02x", (trace.accesses[i] >> 24) ? 'w' : 'r', (trace.accesses[i] >> 8) & 0xffff, trace.accesses[i] & 0xff);
+	printf("\r\n");
+}
+
+template <class CPU>
+static void DumpRegs(const char* name, CPU& cpu)
+{
+	u16 pc;
+	u8 sp, a, x, y, status;
+
+	cpu.GetRegs(pc, sp, a, x, y, status);
+	printf("  %s PC=%04x SP=%02x A=%02x X=%02x Y=%02x P=%02x SYNC=%d\r\n", name, pc, sp, a, x, y, status, cpu.SYNC());
+}
+
+static bool Compare(M6502& referenceCPU, M6502Switch<M6502FunctionBus>& candidateCPU, u64 cycle)
+{
+	u16 pc[2];
+	u8 sp[2], a[2], x[2], y[2], status[2];
+
+	referenceCPU.GetRegs(pc[0], sp[0], a[0], x[0], y[0], status[0]);
+	candidateCPU.GetRegs(pc[1], sp[1], a[1], x[1], y[1], status[1]);
+
+	if (reference.count == candidate.count
+		&& memcmp(reference.accesses, candidate.accesses, (reference.count < MAX_ACCESSES ? reference.count : MAX_ACCESSES) * sizeof(u32)) == 0
+		&& pc[0] == pc[1] && sp[0] == sp[1] && a[0] == a[1] && x[0] == x[1] && y[0] == y[1] && status[0] == status[1]
+		&& referenceCPU.SYNC() == candidateCPU.SYNC())
+		return true;
+
+	printf("lockstep: engines differ at cycle %llu\r\n", (unsigned long long)cycle);
+	DumpAccesses("M6502      ", reference);
+	DumpAccesses("M6502Switch", candidate);
+	DumpRegs("M6502      ", referenceCPU);
+	DumpRegs("M6502Switch", candidateCPU);
+	return false;
+}
+
+bool RunLockstep(u64 cycles, u32 seed)
+{
+	static M6502 referenceCPU;
+	static M6502Switch<M6502FunctionBus> candidateCPU;
+	bool opcodeExecuted[256];
+	unsigned opcodesCovered = 0;
+	unsigned programs = 0;
+	u32 random = seed ? seed : 1;
+	bool irq = false;
+	u64 cycle;
+
+	memset(opcodeExecuted, 0, sizeof(opcodeExecuted));
+
+	reference.count = 0;
+	candidate.count = 0;
+	referenceCPU.SetBusFunctions(ReadReference, WriteReference);
+	candidateCPU.GetBus().readFn = ReadCandidate;
+	candidateCPU.GetBus().writeFn = WriteCandidate;
+	candidateCPU.PowerOn();
+
+	for (cycle = 0; cycle < cycles; ++cycle)
+	{
+		if ((cycle % PROGRAM_CYCLES) == 0)
+		{
+			// A new random program (and random reset/IRQ vectors)
+			LoadProgram(reference, random);
+			memcpy(candidate.memory, reference.memory, sizeof(candidate.memory));
+			programs++;
+
+			reference.count = 0;
+			candidate.count = 0;
+			referenceCPU.Reset();
+			candidateCPU.Reset();
+			if (!Compare(referenceCPU, candidateCPU, cycle))
+				return false;
+		}
+
+		u32 eventRandom = random;
+		bool eventIRQ = irq;
+		RandomEvents(referenceCPU, random, irq);
+		RandomEvents(candidateCPU, eventRandom, eventIRQ);
+
+		bool fetch = referenceCPU.SYNC();
+
+		reference.count = 0;
+		candidate.count = 0;
+		referenceCPU.Step();
+		candidateCPU.Step();
+		if (!Compare(referenceCPU, candidateCPU, cycle))
+			return false;
+
+		if (fetch && referenceCPU.SYNC() == false && !opcodeExecuted[reference.accesses[0] & 0xff])
+		{
+			opcodeExecuted[reference.accesses[0] & 0xff] = true;
+			opcodesCovered++;
+		}
+	}
+
+	printf("lockstep: %llu cycles %u programs %u/256 opcodes identical\r\n", (unsigned long long)cycles, programs, opcodesCovered);
+
+	u64 referenceUS = TimeEngine(referenceCPU, reference, cycles, seed);
+	u64 candidateUS = TimeEngine(candidateCPU, candidate, cycles, seed);
+	printf("lockstep: M6502 %llu us (%.1f ns/cycle) M6502Switch %llu us (%.1f ns/cycle)\r\n",
+		(unsigned long long)referenceUS, referenceUS * 1000.0 / cycles, (unsigned long long)candidateUS, candidateUS * 1000.0 / cycles);
+	return true;
+}
+
+// Feed two VIAs the same random register accesses, port inputs and CA/CB edges.
+// The reference runs every cycle in full and the candidate counts off its quiet cycles.
+static inline bool RandomVIAEvents(m6522& via, u32& random, u8* readValue)
+{
+	u32 events = Random(random);
+	u8 value = (u8)(events >> 16);
+	unsigned reg = (events >> 12) & 0xf;
+	bool read = false;
+
+	switch (events & 0x1ff)
+	{
+		case 0:
+		case 1:
+			// Keep the shift register off most of the time so the timers get long quiet runs.
+			if (reg == 11 && (events >> 28))	// ACR
+				value &= ~0x1c;
+			via.Write(reg, value);
+		break;
+		case 2:
+		case 3:
+			*readValue = via.Read(reg);
+			read = true;
+		break;
+		case 4:
+			via.GetPortA()->SetInput(value);
+		break;
+		case 5:
+			via.GetPortB()->SetInput(value);
+		break;
+		case 6:
+			via.InputCA1((events >> 24) & 1);
+		break;
+		case 7:
+			via.InputCA2((events >> 24) & 1);
+		break;
+		case 8:
+			via.InputCB1((events >> 24) & 1);
+		break;
+		case 9:
+			via.InputCB2((events >> 24) & 1);
+		break;
+	}
+	return read;
+}
+
+static bool CompareVIAs(m6522& referenceVIA, Interrupt& referenceIRQ, m6522& candidateVIA, Interrupt& candidateIRQ, bool peek, u64 cycle)
+{
+	bool same = referenceIRQ.IsAsserted() == candidateIRQ.IsAsserted()
+		&& referenceVIA.GetCA2() == candidateVIA.GetCA2()
+		&& referenceVIA.GetCB2() == candidateVIA.GetCB2()
+		&& referenceVIA.GetPortA()->GetOutput() == candidateVIA.GetPortA()->GetOutput()
+		&& referenceVIA.GetPortB()->GetOutput() == candidateVIA.GetPortB()->GetOutput();
+	u8 registers[2][16];
+
+	if (peek)
+	{
+		for (unsigned reg = 0; reg < 16; ++reg)
+		{
+			registers[0][reg] = referenceVIA.Peek(reg);
+			registers[1][reg] = candidateVIA.Peek(reg);
+		}
+		same = same && memcmp(registers[0], registers[1], 16) == 0;
+	}
+	if (same)
+		return true;
+
+	printf("via lockstep: VIAs differ at cycle %llu\r\n", (unsigned long long)cycle);
+	printf("  per cycle IRQ=%d CA2=%d CB2=%d PA=%02x PB=%02x\r\n", referenceIRQ.IsAsserted(), referenceVIA.GetCA2(), referenceVIA.GetCB2(), referenceVIA.GetPortA()->GetOutput(), referenceVIA.GetPortB()->GetOutput());
+	printf("  quiet     IRQ=%d CA2=%d CB2=%d PA=%02x PB=%02x\r\n", candidateIRQ.IsAsserted(), candidateVIA.GetCA2(), candidateVIA.GetCB2(), candidateVIA.GetPortA()->GetOutput(), candidateVIA.GetPortB()->GetOutput());
+	if (peek)
+	{
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			printf("  %s", i ? "quiet    " : "per cycle");
+			for (unsigned reg = 0; reg < 16; ++reg)
+				printf(" %02x", registers[i][reg]);
+			printf("\r\n");
+		}
+	}
+	return false;
+}
+
+bool RunVIALockstep(u64 cycles, u32 seed)
+{
+	static m6522 referenceVIA;
+	static m6522 candidateVIA;
+	static Interrupt referenceIRQ;
+	static Interrupt candidateIRQ;
+	u32 random = seed ? seed : 1;
+	u64 reads = 0;
+
+	referenceVIA.ConnectIRQ(&referenceIRQ);
+	candidateVIA.ConnectIRQ(&candidateIRQ);
+	referenceVIA.SetQuietCyclesEnabled(false);
+
+	for (u64 cycle = 0; cycle < cycles; ++cycle)
+	{
+		u32 eventRandom = random;
+		u8 referenceValue = 0;
+		u8 candidateValue = 0;
+		bool read = RandomVIAEvents(referenceVIA, random, &referenceValue);
+		RandomVIAEvents(candidateVIA, eventRandom, &candidateValue);
+		if (read)
+		{
+			reads++;
+			if (referenceValue != candidateValue)
+			{
+				printf("via lockstep: read returned %02x (per cycle) and %02x (quiet) at cycle %llu\r\n", referenceValue, candidateValue, (unsigned long long)cycle);
+				return false;
+			}
+		}
+
+		referenceVIA.Execute();
+		candidateVIA.Execute();
+
+		// Peeking catches the candidate's counters up so only do it now and again to let it run quiet.
+		if (!CompareVIAs(referenceVIA, referenceIRQ, candidateVIA, candidateIRQ, (Random(random) & 0xfff) == 0, cycle))
+			return false;
+	}
+
+	printf("via lockstep: %llu cycles %llu reads identical\r\n", (unsigned long long)cycles, (unsigned long long)reads);
+	return true;
+}
+
+// The same for the 1581's CIA with the FLAG, CNT, SP and TOD pins driven at random.
+static inline bool RandomCIAEvents(m8520& cia, u32& random, u8* readValue)
+{
+	u32 events = Random(random);
+	u8 value = (u8)(events >> 16);
+	unsigned reg = (events >> 12) & 0xf;
+	bool read = false;
+
+	switch (events & 0x1ff)
+	{
+		case 0:
+		case 1:
+			cia.Write(reg, value);
+		break;
+		case 2:
+		case 3:
+			*readValue = cia.Read(reg);
+			read = true;
+		break;
+		case 4:
+			cia.GetPortA()->SetInput(value);
+		break;
+		case 5:
+			cia.GetPortB()->SetInput(value);
+		break;
+		case 6:
+			cia.SetPinFLAG((events >> 24) & 1);
+		break;
+		case 7:
+		case 8:
+			cia.SetPinCNT((events >> 24) & 1);
+		break;
+		case 9:
+			cia.SetPinSP((events >> 24) & 1);
+		break;
+		case 10:
+			cia.SetPinTOD((events >> 24) & 1);
+		break;
+	}
+	return read;
+}
+
+static bool CompareCIAs(m8520& referenceCIA, Interrupt& referenceIRQ, m8520& candidateCIA, Interrupt& candidateIRQ, bool peek, u64 cycle)
+{
+	bool same = referenceIRQ.IsAsserted() == candidateIRQ.IsAsserted()
+		&& referenceCIA.IsPCAsserted() == candidateCIA.IsPCAsserted()
+		&& referenceCIA.GetPinCNT() == candidateCIA.GetPinCNT()
+		&& referenceCIA.GetPinSP() == candidateCIA.GetPinSP()
+		&& referenceCIA.GetPortA()->GetOutput() == candidateCIA.GetPortA()->GetOutput()
+		&& referenceCIA.GetPortB()->GetOutput() == candidateCIA.GetPortB()->GetOutput();
+	u8 registers[2][16];
+
+	if (peek)
+	{
+		for (unsigned reg = 0; reg < 16; ++reg)
+		{
+			registers[0][reg] = referenceCIA.Peek(reg);
+			registers[1][reg] = candidateCIA.Peek(reg);
+		}
+		same = same && memcmp(registers[0], registers[1], 16) == 0;
+	}
+	if (same)
+		return true;
+
+	printf("cia lockstep: CIAs differ at cycle %llu\r\n", (unsigned long long)cycle);
+	printf("  per cycle IRQ=%d PC=%d CNT=%d SP=%d PA=%02x PB=%02x\r\n", referenceIRQ.IsAsserted(), referenceCIA.IsPCAsserted(), referenceCIA.GetPinCNT(), referenceCIA.GetPinSP(), referenceCIA.GetPortA()->GetOutput(), referenceCIA.GetPortB()->GetOutput());
+	printf("  quiet     IRQ=%d PC=%d CNT=%d SP=%d PA=%02x PB=%02x\r\n", candidateIRQ.IsAsserted(), candidateCIA.IsPCAsserted(), candidateCIA.GetPinCNT(), candidateCIA.GetPinSP(), candidateCIA.GetPortA()->GetOutput(), candidateCIA.GetPortB()->GetOutput());
+	if (peek)
+	{
+		for (unsigned i = 0; i < 2; ++i)
+		{
+			printf("  %s", i ? "quiet    " : "per cycle");
+			for (unsigned reg = 0; reg < 16; ++reg)
+				printf(" %02x", registers[i][reg]);
+			printf("\r\n");
+		}
+	}
+	return false;
+}
+
+bool RunCIALockstep(u64 cycles, u32 seed)
+{
+	static m8520 referenceCIA;
+	static m8520 candidateCIA;
+	static Interrupt referenceIRQ;
+	static Interrupt candidateIRQ;
+	u32 random = seed ? seed : 1;
+	u64 reads = 0;
+
+	referenceCIA.ConnectIRQ(&referenceIRQ);
+	candidateCIA.ConnectIRQ(&candidateIRQ);
+	referenceCIA.SetQuietCyclesEnabled(false);
+
+	for (u64 cycle = 0; cycle < cycles; ++cycle)
+	{
+		u32 eventRandom = random;
+		u8 referenceValue = 0;
+		u8 candidateValue = 0;
+		bool read = RandomCIAEvents(referenceCIA, random, &referenceValue);
+		RandomCIAEvents(candidateCIA, eventRandom, &candidateValue);
+		if (read)
+		{
+			reads++;
+			if (referenceValue != candidateValue)
+			{
+				printf("cia lockstep: read returned %02x (per cycle) and %02x (quiet) at cycle %llu\r\n", referenceValue, candidateValue, (unsigned long long)cycle);
+				return false;
+			}
+		}
+
+		referenceCIA.Execute();
+		candidateCIA.Execute();
+
+		if (!CompareCIAs(referenceCIA, referenceIRQ, candidateCIA, candidateIRQ, (Random(random) & 0xfff) == 0, cycle))
+			return false;
+	}
+
+	printf("cia lockstep: %llu cycles %llu reads identical\r\n", (unsigned long long)cycles, (unsigned long long)reads);
+	return true;
+}
+
+#if !defined(EXPERIMENTALZERO)
+// What the rest of the 1541 sees of the drive on a cycle.
+static inline u64 DriveState(Drive& drive, m6522& via, bool dataReady)
+{
+	return (u64)drive.GetHeadBitOffset()
+		| ((u64)drive.Track() << 16)
+		| ((u64)via.GetPortA()->GetInput() << 24)
+		| ((u64)(via.GetPortB()->GetInput() & 0x90) << 32)	// SYNC and write protect
+		| ((u64)via.GetCA1() << 40)
+		| ((u64)dataReady << 41);
+}
+
+// Step the head, change density, switch the motor and read/write mode and write random bytes the way the 1541 ROM would through VIA2.
+static inline void RandomDriveEvents(Drive& drive, m6522& via, u32& random)
+{
+	u32 events = Random(random);
+	u8 portB = via.GetPortB()->GetOutput();
+
+	if ((events & 0xfff) == 0)
+	{
+		// Step the head one half track in or out (staying on the image's 35 tracks)
+		bool stepIn = (events & 0x1000) && drive.Track() < 68;
+		u8 phase = (portB + (stepIn ? 1 : -1)) & 3;
+		via.Write(0, (portB & ~3) | phase);
+	}
+	else if ((events & 0x3ffff) == 0x1000)
+	{
+		via.Write(0, (portB & ~0x60) | ((events >> 18) & 0x60));
+	}
+	else if ((events & 0xfffff) == 0x2000)
+	{
+		via.Write(0, portB ^ 0x04);	// Motor
+	}
+	else if ((events & 0x3ffff) == 0x3000)
+	{
+		// Read (0xee) or write (0xce) with BYTE READY on or off
+		u8 pcr = ((events >> 18) & 1) ? 0xce : 0xee;
+		if ((events >> 19) & 1)
+			pcr &= ~0x02;
+		via.Write(12, pcr);
+		via.Write(3, (pcr == 0xce) ? 0xff : 0x00);
+	}
+	if ((events & 0x3f0000) == 0)
+		via.Write(1, (u8)(events >> 24));
+}
+
+// Like Pi1541 these live in zero initialised storage as the drive relies on it.
+static m6522 drivesVIA[2];
+static Drive drives[2];
+
+static u64* RecordDrive(DiskImage* diskImage, bool fluxEngine, u64 cycles, u32 seed, u64& elapsed)
+{
+	u64* states = new u64[cycles];
+	m6522* via = &drivesVIA[fluxEngine];
+	Drive* drive = &drives[fluxEngine];
+	u32 random = seed ? seed : 1;
+
+	drive->SetVIA(via);
+	drive->SetFluxEngine(fluxEngine);
+	drive->Reset();
+	drive->Insert(diskImage);
+
+	via->Write(2, 0x6f);	// DDRB
+	via->Write(0, 0x6c);	// Motor on, LED on, density 3
+	via->Write(12, 0xee);	// Read with BYTE READY
+
+	u64 before = HAL_GetMicroSeconds();
+	for (u64 cycle = 0; cycle < cycles; ++cycle)
+	{
+		RandomDriveEvents(*drive, *via, random);
+		bool dataReady = drive->Update();
+		states[cycle] = DriveState(*drive, *via, dataReady);
+	}
+	elapsed = HAL_GetMicroSeconds() - before;
+
+	return states;
+}
+
+bool RunDriveLockstep(DiskImage* referenceImage, DiskImage* candidateImage, u64 cycles, u32 seed)
+{
+	u64 referenceUS;
+	u64 candidateUS;
+	u64* reference = RecordDrive(referenceImage, false, cycles, seed, referenceUS);
+	u64* candidate = RecordDrive(candidateImage, true, cycles, seed, candidateUS);
+	bool same = true;
+
+	for (u64 cycle = 0; cycle < cycles; ++cycle)
+	{
+		if (reference[cycle] != candidate[cycle])
+		{
+			printf("drive lockstep: engines differ at cycle %llu\r\n", (unsigned long long)cycle);
+			for (u64 i = cycle >= 4 ? cycle - 4 : 0; i <= cycle; ++i)
+				printf("  %llu loop %011llx flux %011llx\r\n", (unsigned long long)i, (unsigned long long)reference[i], (unsigned long long)candidate[i]);
+			same = false;
+			break;
+		}
+	}
+	if (same)
+	{
+		printf("drive lockstep: %llu cycles identical\r\n", (unsigned long long)cycles);
+		printf("drive lockstep: loop %llu us (%.1f ns/cycle) flux %llu us (%.1f ns/cycle)\r\n",
+			(unsigned long long)referenceUS, referenceUS * 1000.0 / cycles, (unsigned long long)candidateUS, candidateUS * 1000.0 / cycles);
+	}
+
+	delete[] reference;
+	delete[] candidate;
+	return same;
+}
+#else
+bool RunDriveLockstep(DiskImage* referenceImage, DiskImage* candidateImage, u64 cycles, u32 seed)
+{
+	printf("drive lockstep: the flux event engine is not built with EXPERIMENTALZERO\r\n");
+	return false;
+}
+#endif
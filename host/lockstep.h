@@ -0,0 +1,44 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "types.h"
+
+// Steps M6502 and M6502Switch side by side through random programs with random IRQ and SO assertions.
+// Every cycle's bus accesses and registers are compared. Returns false at the first difference.
+bool RunLockstep(u64 cycles, u32 seed);
+
+// Runs a VIA every cycle in full alongside one that counts off its quiet cycles.
+// Both get the same random register reads and writes, port inputs and CA/CB edges.
+// Reads, IRQ, CA2/CB2 and the port outputs must match on every cycle and all the registers now and again.
+bool RunVIALockstep(u64 cycles, u32 seed);
+
+// The same for the 1581's CIA. The FLAG, CNT, SP and TOD pins are driven at random as well.
+// Reads, IRQ, PC, CNT, SP and the port outputs must match on every cycle.
+bool RunCIALockstep(u64 cycles, u32 seed);
+
+class DiskImage;
+
+// Runs the 1541 drive's per cycle loop and its flux event engine through the same random head steps, density, motor and read/write changes.
+// Each engine gets its own copy of the disk. The byte latched on port A, SYNC, BYTE READY and the head position must match on every cycle.
+bool RunDriveLockstep(DiskImage* referenceImage, DiskImage* candidateImage, u64 cycles, u32 seed);
+
+#endif
@@ -0,0 +1,418 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+//
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+// Headless runner for the host build.
+// Mounts an image, boots the emulated drive and runs the same per cycle sequence as Emulate1541/Emulate1581
+// (without syncing to 1MHz) so the emulation core can be profiled with perf, cachegrind etc.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hal.h"
+#include "Pi1541.h"
+#include "Pi1581.h"
+#include "DiskImage.h"
+#include "ROMs.h"
+#include "options.h"
+#include "iec_bus.h"
+#include "TimingStats.h"
+#include "lockstep.h"
+#include "gcrbench.h"
+extern "C"
+{
+#include "rpiHardware.h"
+}
+
+#define FAST_BOOT_CYCLES 1003061
+#define DEFAULT_CYCLES 10000000
+
+// The globals the emulation core expects main.cpp to provide.
+ROMs roms;
+u8 s_u8Memory[0xc000];
+Pi1541 pi1541;
+Pi1581 pi1581;
+Options options;
+u16 pc;
+
+
+static FILINFO fileInfo;
+static char optionsBuffer[32 * 1024];
+
+static void Usage(const char* name)
+{
+	printf("Usage: %s [options] image\r\n", name);
+	printf("       %s -lockstep [-cycles <n>] [-seed <n>]\r\n", name);
+	printf("       %s -vialockstep [-cycles <n>] [-seed <n>]\r\n", name);
+	printf("       %s -cialockstep [-cycles <n>] [-seed <n>]\r\n", name);
+	printf("       %s -drivelockstep [-cycles <n>] [-seed <n>] image\r\n", name);
+	printf("       %s -gcrbench [-seed <n>]\r\n", name);
+	printf("       %s -nbztracks <file> image\r\n", name);
+	printf("  -rom <file>     1541 ROM (default d1541.rom) or 1581 ROM when mounting a D81 (default 1581-rom.318045-02.bin)\r\n");
+	printf("  -cycles <n>     number of 1MHz cycles to emulate after the fast boot (default %d)\r\n", DEFAULT_CYCLES);
+	printf("  -device <n>     device ID (default 8)\r\n");
+	printf("  -options <file> options.txt to use (eg for ExtraRAM or RAMBOard)\r\n");
+	printf("  -write          allow the image to be written back on exit\r\n");
+	printf("  -benchmark      also time every cycle and report the worst case\r\n");
+	printf("  -lockstep       compare the M6502 and M6502Switch engines cycle by cycle on random programs\r\n");
+	printf("  -vialockstep    compare the VIA's quiet cycles with running every cycle in full on random register traffic\r\n");
+	printf("  -cialockstep    the same for the 1581's CIA\r\n");
+	printf("  -drivelockstep  compare the 1541 drive's per cycle loop and flux event engine cycle by cycle reading and writing image\r\n");
+	printf("  -gcrbench       time the GCR encode and decode kernels against the nibble at a time code and check they agree\r\n");
+	printf("  -seed <n>       random seed for the lockstep checks and -gcrbench (default 1)\r\n");
+	printf("  -flux           run the 1541 drive with the flux event engine\r\n");
+	printf("  -nbztracks <f>  save a 1541 image as an NBZ with a track index (each track compressed on its own) and exit\r\n");
+}
+
+static bool LoadFile(const char* name, unsigned char* buffer, unsigned size, unsigned& bytesRead)
+{
+	FIL fp;
+	bytesRead = 0;
+	if (f_open(&fp, name, FA_READ) != FR_OK)
+	{
+		printf("Failed to open %s\r\n", name);
+		return false;
+	}
+	f_read(&fp, buffer, size, &bytesRead);
+	f_close(&fp);
+	return true;
+}
+
+static DiskImage* MountImage(const char* name, bool readOnly)
+{
+	unsigned bytesRead;
+	bool success;
+
+	if (strlen(name) >= sizeof(fileInfo.fname))
+		return 0;
+	memset(&fileInfo, 0, sizeof(fileInfo));
+	strcpy(fileInfo.fname, name);
+
+	// Like the caddy, only T64 and PRG files are loaded whole first. The disk images are streamed from the file.
+	FIL fp;
+	if (f_open(&fp, name, FA_READ) != FR_OK)
+	{
+		printf("Failed to open %s\r\n", name);
+		return 0;
+	}
+	bytesRead = f_size(&fp);
+	fileInfo.fsize = bytesRead;
+	ImageSource source(&fp, bytesRead);
+
+	DiskImage* diskImage = new DiskImage();
+	u64 before = HAL_GetMicroSeconds();
+	DiskImage::DiskType diskType = DiskImage::GetDiskImageTypeViaExtention(name);
+	if (diskType == DiskImage::T64 || diskType == DiskImage::PRG)
+		f_read(&fp, DiskImage::readBuffer, READBUFFER_SIZE, &bytesRead);
+	switch (diskType)
+	{
+		case DiskImage::D64:
+			success = diskImage->OpenD64(&fileInfo, source);
+			break;
+		case DiskImage::G64:
+			success = diskImage->OpenG64(&fileInfo, source);
+			break;
+		case DiskImage::NIB:
+			success = diskImage->OpenNIB(&fileInfo, source);
+			readOnly = true;
+			break;
+		case DiskImage::NBZ:
+			success = diskImage->OpenNBZ(&fileInfo, source);
+			readOnly = true;
+			break;
+		case DiskImage::D81:
+			success = diskImage->OpenD81(&fileInfo, source);
+			break;
+		case DiskImage::T64:
+			success = diskImage->OpenT64(&fileInfo, DiskImage::readBuffer, bytesRead);
+			break;
+		case DiskImage::PRG:
+			success = diskImage->OpenPRG(&fileInfo, DiskImage::readBuffer, bytesRead);
+			break;
+		default:
+			success = false;
+			break;
+	}
+	f_close(&fp);
+	// The caddy reserves the spare tracks as it hands an image to the drive.
+	if (success)
+		success = diskImage->ReserveSpareTracks();
+	if (!success)
+	{
+		printf("Failed to mount %s\r\n", name);
+		delete diskImage;
+		return 0;
+	}
+	u64 elapsed = HAL_GetMicroSeconds() - before;
+	printf("Mounted %s in %llu us (%u bytes of tracks)\r\n", name, elapsed, diskImage->TrackMemoryUsed());
+	diskImage->SetReadOnly(readOnly);
+	return diskImage;
+}
+
+static u32 worstCycle;
+static u16 worstPC;
+static TimingStats timingStats;
+
+static inline void TimeCycle(u32& ctBefore)
+{
+	u32 ctAfter = read_cycle_counter();
+	u32 ct = ctAfter - ctBefore;
+	timingStats.Cycle(ct, pc);
+	if (ct > worstCycle)
+	{
+		worstCycle = ct;
+		worstPC = pc;
+	}
+	ctBefore = ctAfter;
+}
+
+static void Report(const char* drive, u64 cycles, u64 elapsed, bool benchmark)
+{
+	printf("%s %llu cycles in %llu us (%.2fx realtime)\r\n", drive, cycles, elapsed, elapsed ? (double)cycles / (double)elapsed : 0.0);
+	if (benchmark)
+	{
+		TimingStatsSnapshot snapshot;
+
+		printf("%.0f cycles/s, worst cycle %u ns at PC=%04x\r\n", elapsed ? (double)cycles * 1000000.0 / (double)elapsed : 0.0, (u32)(((u64)worstCycle * 1000) / HAL_CYCLE_COUNTER_1MHZ), worstPC);
+		timingStats.Publish();
+		if (timingStats.Read(snapshot))
+			TimingStats::Dump(drive, snapshot);
+	}
+}
+
+static void Run1541(u64 cycles, bool benchmark)
+{
+	u64 cycle;
+	u32 ctBefore;
+	pi1541.MapMemory(options.GetExtraRAM(), options.GetRAMBOard());
+	pi1541.m6502.PowerOn();
+
+	IEC_Bus::VIA = &pi1541.VIA[0];
+	IEC_Bus::port = pi1541.VIA[0].GetPortB();
+	pi1541.Reset();	// will call IEC_Bus::Reset();
+
+	IEC_Bus::LetSRQBePulledHigh();
+
+	for (cycle = 0; cycle < FAST_BOOT_CYCLES; ++cycle)
+	{
+		IEC_Bus::ReadEmulationMode1541();
+		pi1541.m6502.Step();
+		pi1541.Update();
+	}
+
+	timingStats.Reset(HAL_CYCLE_COUNTER_1MHZ);
+	u64 before = HAL_GetMicroSeconds();
+	ctBefore = read_cycle_counter();
+	for (cycle = 0; cycle < cycles; ++cycle)
+	{
+		IEC_Bus::ReadEmulationMode1541();
+		if (pi1541.m6502.SYNC())
+			pc = pi1541.m6502.GetPC();
+		pi1541.m6502.Step();
+		IEC_Bus::RefreshOuts1541();
+		IEC_Bus::OutputLED = pi1541.drive.IsLEDOn();
+		IEC_Bus::ReadGPIOUserInput();
+		pi1541.Update();
+		if (benchmark)
+			TimeCycle(ctBefore);
+	}
+	u64 elapsed = HAL_GetMicroSeconds() - before;
+
+	Report("1541", cycles, elapsed, benchmark);
+	printf("PC=%04x track=%d.%d motor=%d LED=%d RAM=%08x\r\n", pi1541.m6502.GetPC(), (pi1541.drive.Track() >> 1) + 1, (pi1541.drive.Track() & 1) ? 5 : 0, pi1541.drive.IsMotorOn(), pi1541.drive.IsLEDOn(), HashBuffer(s_u8Memory, sizeof(s_u8Memory)));
+}
+
+static void Run1581(u64 cycles, bool benchmark)
+{
+	u64 cycle;
+	u32 ctBefore;
+	pi1581.MapMemory();
+	pi1581.m6502.PowerOn();
+
+	IEC_Bus::CIA = &pi1581.CIA;
+	IEC_Bus::port = pi1581.CIA.GetPortB();
+	pi1581.Reset();	// will call IEC_Bus::Reset();
+
+	timingStats.Reset(HAL_CYCLE_COUNTER_1MHZ);
+	u64 before = HAL_GetMicroSeconds();
+	ctBefore = read_cycle_counter();
+	for (cycle = 0; cycle < cycles; ++cycle)
+	{
+		IEC_Bus::ReadEmulationMode1581();
+		for (int cycle2MHz = 0; cycle2MHz < 2; ++cycle2MHz)
+		{
+			if (pi1581.m6502.SYNC())
+				pc = pi1581.m6502.GetPC();
+			pi1581.m6502.Step();
+			pi1581.Update();
+		}
+		IEC_Bus::RefreshOuts1581();
+		IEC_Bus::OutputLED = pi1581.IsLEDOn();
+		IEC_Bus::ReadGPIOUserInput();
+		if (benchmark)
+			TimeCycle(ctBefore);
+	}
+	u64 elapsed = HAL_GetMicroSeconds() - before;
+
+	Report("1581", cycles, elapsed, benchmark);
+	printf("PC=%04x track=%d LED=%d RAM=%08x\r\n", pi1581.m6502.GetPC(), pi1581.wd177x.GetCurrentTrack(), pi1581.IsLEDOn(), HashBuffer(s_u8Memory, sizeof(s_u8Memory)));
+}
+
+int main(int argc, char* argv[])
+{
+	const char* ROMName = 0;
+	const char* imageName = 0;
+	const char* optionsName = 0;
+	const char* nbzTracksName = 0;
+	u64 cycles = DEFAULT_CYCLES;
+	u8 deviceID = 8;
+	bool readOnly = true;
+	bool benchmark = false;
+	bool lockstep = false;
+	bool viaLockstep = false;
+	bool ciaLockstep = false;
+	bool driveLockstep = false;
+	bool gcrBenchmark = false;
+	bool fluxEngine = false;
+	u32 seed = 1;
+	unsigned bytesRead;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-rom") == 0 && i + 1 < argc)
+			ROMName = argv[++i];
+		else if (strcmp(argv[i], "-cycles") == 0 && i + 1 < argc)
+			cycles = strtoull(argv[++i], 0, 0);
+		else if (strcmp(argv[i], "-device") == 0 && i + 1 < argc)
+			deviceID = (u8)strtoul(argv[++i], 0, 0);
+		else if (strcmp(argv[i], "-options") == 0 && i + 1 < argc)
+			optionsName = argv[++i];
+		else if (strcmp(argv[i], "-write") == 0)
+			readOnly = false;
+		else if (strcmp(argv[i], "-benchmark") == 0)
+			benchmark = true;
+		else if (strcmp(argv[i], "-lockstep") == 0)
+			lockstep = true;
+		else if (strcmp(argv[i], "-vialockstep") == 0)
+			viaLockstep = true;
+		else if (strcmp(argv[i], "-cialockstep") == 0)
+			ciaLockstep = true;
+		else if (strcmp(argv[i], "-drivelockstep") == 0)
+			driveLockstep = true;
+		else if (strcmp(argv[i], "-gcrbench") == 0)
+			gcrBenchmark = true;
+		else if (strcmp(argv[i], "-flux") == 0)
+			fluxEngine = true;
+		else if (strcmp(argv[i], "-seed") == 0 && i + 1 < argc)
+			seed = strtoul(argv[++i], 0, 0);
+		else if (strcmp(argv[i], "-nbztracks") == 0 && i + 1 < argc)
+			nbzTracksName = argv[++i];
+		else if (argv[i][0] != '-' && !imageName)
+			imageName = argv[i];
+		else
+		{
+			Usage(argv[0]);
+			return 1;
+		}
+	}
+	if (lockstep)
+		return RunLockstep(cycles, seed) ? 0 : 1;
+	if (viaLockstep)
+		return RunVIALockstep(cycles, seed) ? 0 : 1;
+	if (ciaLockstep)
+		return RunCIALockstep(cycles, seed) ? 0 : 1;
+	if (gcrBenchmark)
+		return RunGCRBenchmark(seed) ? 0 : 1;
+
+	if (!imageName)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	HAL_Reset();
+
+	if (optionsName)
+	{
+		if (!LoadFile(optionsName, (unsigned char*)optionsBuffer, sizeof(optionsBuffer) - 1, bytesRead))
+			return 1;
+		optionsBuffer[bytesRead] = 0;
+		options.Process(optionsBuffer);
+	}
+	DiskImage::SetGCRCacheFolder(options.GetGCRCacheFolder());
+
+	DiskImage* diskImage = MountImage(imageName, readOnly);
+	if (!diskImage)
+		return 1;
+
+	if (nbzTracksName)
+	{
+		bool saved = diskImage->SaveNBZ(nbzTracksName, true);
+		if (!saved)
+			printf("Cannot save %s as an NBZ\r\n", imageName);
+		diskImage->Close();
+		delete diskImage;
+		return saved ? 0 : 1;
+	}
+
+	if (driveLockstep)
+	{
+		DiskImage* candidateImage = MountImage(imageName, readOnly);
+		if (!candidateImage)
+			return 1;
+		return RunDriveLockstep(diskImage, candidateImage, cycles, seed) ? 0 : 1;
+	}
+
+	bool is1581 = diskImage->IsD81();
+	if (is1581)
+	{
+		if (!LoadFile(ROMName ? ROMName : "1581-rom.318045-02.bin", roms.ROMImage1581, ROMs::ROM1581_SIZE, bytesRead))
+			return 1;
+	}
+	else
+	{
+		if (!LoadFile(ROMName ? ROMName : "d1541.rom", roms.ROMImages[0], ROMs::ROM_SIZE, bytesRead))
+			return 1;
+		roms.ROMValid[0] = true;
+	}
+	roms.currentROMIndex = 0;
+	roms.lastManualSelectedROMIndex = 0;
+
+	pi1541.Initialise();
+	pi1541.drive.SetVIA(&pi1541.VIA[1]);
+#if !defined(EXPERIMENTALZERO)
+	pi1541.drive.SetFluxEngine(fluxEngine);
+#endif
+	pi1541.VIA[0].GetPortB()->SetPortOut(0, IEC_Bus::PortB_OnPortOut);
+	pi1541.SetDeviceID(deviceID);
+	pi1581.SetDeviceID(deviceID);
+
+	if (is1581)
+	{
+		pi1581.Insert(diskImage);
+		Run1581(cycles, benchmark);
+	}
+	else
+	{
+		pi1541.drive.Insert(diskImage);
+		Run1541(cycles, benchmark);
+	}
+
+	diskImage->Close();
+	delete diskImage;
+	return 0;
+}
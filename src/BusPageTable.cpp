@@ -0,0 +1,67 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "BusPageTable.h"
+
+u8 BusPageTable::discardedWrites[256];
+
+static u8 ReadEmptyBus(u16 address)
+{
+	return address >> 8;
+}
+
+void BusPageTable::Clear()
+{
+	for (unsigned page = 0; page < 256; ++page)
+	{
+		readPages[page] = 0;
+		readFns[page] = ReadEmptyBus;
+		writePages[page] = discardedWrites;
+		writeFns[page] = 0;
+	}
+}
+
+void BusPageTable::MapRead(unsigned firstPage, unsigned pageCount, const u8* memory, u16 mask)
+{
+	for (unsigned page = firstPage; page < firstPage + pageCount; ++page)
+		readPages[page] = memory + ((page << 8) & mask);
+}
+
+void BusPageTable::MapWrite(unsigned firstPage, unsigned pageCount, u8* memory, u16 mask)
+{
+	for (unsigned page = firstPage; page < firstPage + pageCount; ++page)
+		writePages[page] = memory + ((page << 8) & mask);
+}
+
+void BusPageTable::IgnoreWrites(unsigned firstPage, unsigned pageCount)
+{
+	for (unsigned page = firstPage; page < firstPage + pageCount; ++page)
+		writePages[page] = discardedWrites;
+}
+
+void BusPageTable::MapDevice(unsigned firstPage, unsigned pageCount, DataBusReadFn read, DataBusWriteFn write)
+{
+	for (unsigned page = firstPage; page < firstPage + pageCount; ++page)
+	{
+		readPages[page] = 0;
+		readFns[page] = read;
+		writePages[page] = 0;
+		writeFns[page] = write;
+	}
+}
@@ -0,0 +1,77 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef BUSPAGETABLE_H
+#define BUSPAGETABLE_H
+
+#include "types.h"
+#include "m6502.h"
+
+// Decodes the 6502's address bus using a table of 256 pages.
+// Pages of RAM and ROM point straight at the memory behind them so accessing them never has to decode the address.
+// Pages containing a chip call a function instead.
+// The table is built when an image is mounted (from the options and selected ROM) so configurations like the RAM board cost nothing extra per access.
+class BusPageTable
+{
+public:
+	BusPageTable() { Clear(); }
+
+	// Every page reads as an empty bus (ie the high byte of the address) and ignores writes.
+	void Clear();
+
+	// Map pages onto memory. The mask is applied to each page's address to find its offset into the memory so mirrors can be mapped.
+	void MapRead(unsigned firstPage, unsigned pageCount, const u8* memory, u16 mask);
+	void MapWrite(unsigned firstPage, unsigned pageCount, u8* memory, u16 mask);
+	inline void MapRAM(unsigned firstPage, unsigned pageCount, u8* memory, u16 mask)
+	{
+		MapRead(firstPage, pageCount, memory, mask);
+		MapWrite(firstPage, pageCount, memory, mask);
+	}
+	// Writes to these pages go nowhere (eg ROM)
+	void IgnoreWrites(unsigned firstPage, unsigned pageCount);
+
+	void MapDevice(unsigned firstPage, unsigned pageCount, DataBusReadFn read, DataBusWriteFn write);
+
+	inline u8 Read(u16 address) const
+	{
+		const u8* page = readPages[address >> 8];
+		if (page)
+			return page[address & 0xff];
+		return readFns[address >> 8](address);
+	}
+
+	inline void Write(u16 address, const u8 value)
+	{
+		u8* page = writePages[address >> 8];
+		if (page)
+			page[address & 0xff] = value;
+		else
+			writeFns[address >> 8](address, value);
+	}
+
+private:
+	const u8* readPages[256];
+	u8* writePages[256];
+	DataBusReadFn readFns[256];
+	DataBusWriteFn writeFns[256];
+
+	static u8 discardedWrites[256];
+};
+
+#endif
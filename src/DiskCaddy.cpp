@@ -24,6 +24,7 @@
 extern "C"
 {
 #include "rpi-gpio.h"	// For SetACTLed
+#include "rpiHardware.h"
 }
 
 extern u8 deviceID;
@@ -46,6 +47,7 @@ bool DiskCaddy::Empty()
 	bool anyDirty = false;
 
 #if not defined(EXPERIMENTALZERO)
+	imagesLock.Acquire();
 	if (screen)
 		screen->Clear(RGBA(0x40, 0x31, 0x8D, 0xFF));
 #endif
@@ -115,6 +117,14 @@ bool DiskCaddy::Empty()
 	disks.clear();
 	selectedIndex = 0;
 	oldCaddyIndex = 0;
+#if not defined(EXPERIMENTALZERO)
+	readyIndex = NO_IMAGE;
+	previousIndex = NO_IMAGE;
+	prefetchedIndex = NO_IMAGE;
+	preparedImages.clear();
+	imagePending = false;
+	imagesLock.Release();
+#endif
 	return anyDirty;
 }
 
@@ -155,29 +165,32 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 			screenLCD->PrintText(false, x, y, buffer, RGBA(0xff, 0xff, 0xff, 0xff), red);
 			screenLCD->SwapBuffers();
 		}
-		u32 bytesRead;
+		u32 bytesRead = f_size(&fp);
+		DiskImage::DiskType diskType = DiskImage::GetDiskImageTypeViaExtention(fileInfo->fname);
+		// Disk images are read a track at a time as they are converted. Only T64 and PRG files are loaded whole first.
+		ImageSource source(&fp, bytesRead);
+		bool streamed = diskType != DiskImage::T64 && diskType != DiskImage::PRG;
+
 		SetACTLed(true);
-		f_read(&fp, DiskImage::readBuffer, READBUFFER_SIZE, &bytesRead);
-		SetACTLed(false);
-		f_close(&fp);
+		if (!streamed)
+			f_read(&fp, DiskImage::readBuffer, READBUFFER_SIZE, &bytesRead);
 
-		DiskImage::DiskType diskType = DiskImage::GetDiskImageTypeViaExtention(fileInfo->fname);
 		switch (diskType)
 		{
 			case DiskImage::D64:
-				success = InsertD64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				success = InsertD64(fileInfo, source, readOnly);
 				break;
 			case DiskImage::G64:
-				success = InsertG64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				success = InsertG64(fileInfo, source, readOnly);
 				break;
 			case DiskImage::NIB:
-				success = InsertNIB(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				success = InsertNIB(fileInfo, source, readOnly);
 				break;
 			case DiskImage::NBZ:
-				success = InsertNBZ(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				success = InsertNBZ(fileInfo, source, readOnly);
 				break;
 			case DiskImage::D81:
-				success = InsertD81(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
+				success = InsertD81(fileInfo, source, readOnly);
 				break;
 			case DiskImage::T64:
 				success = InsertT64(fileInfo, (unsigned char*)DiskImage::readBuffer, bytesRead, readOnly);
@@ -189,9 +202,13 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 				success = false;
 				break;
 		}
+		SetACTLed(false);
+		f_close(&fp);
+
 		if (success)
 		{
 			DEBUG_LOG("Mounted into caddy %s - %d\r\n", fileInfo->fname, bytesRead);
+			PackImages();
 		}
 	}
 	else
@@ -201,14 +218,17 @@ bool DiskCaddy::Insert(const FILINFO* fileInfo, bool readOnly)
 	}
 
 	oldCaddyIndex = 0;
+#if not defined(EXPERIMENTALZERO)
+	prefetchedIndex = NO_IMAGE;
+#endif
 
 	return success;
 }
 
-bool DiskCaddy::InsertD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+bool DiskCaddy::InsertD64(const FILINFO* fileInfo, ImageSource& source, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
-	if (diskImage->OpenD64(fileInfo, diskImageData, size))
+	if (diskImage->OpenD64(fileInfo, source))
 	{
 		diskImage->SetReadOnly(readOnly);
 		disks.push_back(diskImage);
@@ -219,10 +239,10 @@ bool DiskCaddy::InsertD64(const FILINFO* fileInfo, unsigned char* diskImageData,
 	return false;
 }
 
-bool DiskCaddy::InsertG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+bool DiskCaddy::InsertG64(const FILINFO* fileInfo, ImageSource& source, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
-	if (diskImage->OpenG64(fileInfo, diskImageData, size))
+	if (diskImage->OpenG64(fileInfo, source))
 	{
 		diskImage->SetReadOnly(readOnly);
 		disks.push_back(diskImage);
@@ -234,10 +254,10 @@ bool DiskCaddy::InsertG64(const FILINFO* fileInfo, unsigned char* diskImageData,
 	return false;
 }
 
-bool DiskCaddy::InsertNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+bool DiskCaddy::InsertNIB(const FILINFO* fileInfo, ImageSource& source, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
-	if (diskImage->OpenNIB(fileInfo, diskImageData, size))
+	if (diskImage->OpenNIB(fileInfo, source))
 	{
 		// At the moment we cannot write out NIB files.
 		diskImage->SetReadOnly(true);// readOnly);
@@ -249,10 +269,10 @@ bool DiskCaddy::InsertNIB(const FILINFO* fileInfo, unsigned char* diskImageData,
 	return false;
 }
 
-bool DiskCaddy::InsertNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+bool DiskCaddy::InsertNBZ(const FILINFO* fileInfo, ImageSource& source, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
-	if (diskImage->OpenNBZ(fileInfo, diskImageData, size))
+	if (diskImage->OpenNBZ(fileInfo, source))
 	{
 		// At the moment we cannot write out NIB files.
 		diskImage->SetReadOnly(true);// readOnly);
@@ -264,10 +284,10 @@ bool DiskCaddy::InsertNBZ(const FILINFO* fileInfo, unsigned char* diskImageData,
 	return false;
 }
 
-bool DiskCaddy::InsertD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly)
+bool DiskCaddy::InsertD81(const FILINFO* fileInfo, ImageSource& source, bool readOnly)
 {
 	DiskImage* diskImage = new DiskImage();
-	if (diskImage->OpenD81(fileInfo, diskImageData, size))
+	if (diskImage->OpenD81(fileInfo, source))
 	{
 		diskImage->SetReadOnly(readOnly);
 		disks.push_back(diskImage);
@@ -306,6 +326,129 @@ bool DiskCaddy::InsertPRG(const FILINFO* fileInfo, unsigned char* diskImageData,
 	return false;
 }
 
+// Only the selected image is expanded for the drive; the rest of the caddy is kept packed until it is selected.
+void DiskCaddy::PackImages()
+{
+	unsigned index;
+
+	for (index = 0; index < disks.size(); ++index)
+	{
+		if (index != selectedIndex)
+			disks[index]->Pack();
+	}
+#if not defined(EXPERIMENTALZERO)
+	bool prepared = disks[selectedIndex]->Unpack() && disks[selectedIndex]->ReserveSpareTracks();
+	preparedImages.assign(disks.size(), false);
+	preparedImages[selectedIndex] = prepared;
+#else
+	if (disks[selectedIndex]->Unpack())
+		disks[selectedIndex]->ReserveSpareTracks();
+#endif
+}
+
+#if not defined(EXPERIMENTALZERO)
+// Called from the emulating core so it never waits for core0 or does its work.
+// If core0 has not prepared the image yet (or the swap jumped across the caddy) 0 is returned and the drive stays empty until it has.
+DiskImage* DiskCaddy::TakeImage(u32 index)
+{
+	if (index != readyIndex)
+	{
+		previousIndex = readyIndex;
+		DataMemBarrier();
+		readyIndex = index;
+	}
+	// Claim the image before looking at it. core0 withdraws an image before it looks at the claims so one always sees the other.
+	DataMemBarrier();
+	imagePending = !preparedImages[index];
+	return imagePending ? 0 : disks[index];
+}
+
+bool DiskCaddy::IsPrefetched(u32 index, u32 selected) const
+{
+	u32 numberOfImages = disks.size();
+
+	return index == selected || index == (selected + 1) % numberOfImages || index == (selected + numberOfImages - 1) % numberOfImages;
+}
+
+void DiskCaddy::Prefetch()
+{
+	u32 selected = selectedIndex;
+	unsigned pass;
+	unsigned index;
+
+	// Replace any spare tracks the drive has used.
+	imagesLock.Acquire();
+	if (readyIndex < disks.size() && preparedImages[readyIndex])
+		disks[readyIndex]->ReserveSpareTracks();
+	imagesLock.Release();
+
+	if (selected == prefetchedIndex)
+		return;
+
+	// Expand (and GCR convert) the images either side of the selection first as they are the next swap, then pack the rest.
+	// The lock is only held for one image at a time. The emulating core never takes it; it only takes images flagged as prepared.
+	for (pass = 0; pass < 2; ++pass)
+	{
+		for (index = 0; ; ++index)
+		{
+			imagesLock.Acquire();
+			if (index >= disks.size())
+			{
+				imagesLock.Release();
+				break;
+			}
+			DiskImage* diskImage = disks[index];
+			if (IsPrefetched(index, selected) || index == readyIndex)
+			{
+				// An image the emulating core is waiting for is prepared even though it has already claimed it as it cannot take it until it is flagged.
+				if (pass == 0 && !preparedImages[index] && diskImage->Unpack() && diskImage->ReserveSpareTracks())
+				{
+					DataMemBarrier();
+					preparedImages[index] = true;
+				}
+				// Then its tracks are converted (taking turns with the drive if it is in it) so the drive does not have to as its head reaches them.
+				if (pass == 0 && preparedImages[index])
+					diskImage->PrepareTracks();
+			}
+			else if (pass == 1 && index != previousIndex)
+			{
+				bool prepared = preparedImages[index] != 0;
+
+				preparedImages[index] = false;
+				DataMemBarrier();
+				if (index == readyIndex || index == previousIndex)
+					preparedImages[index] = prepared;
+				else
+					diskImage->Pack();
+			}
+			imagesLock.Release();
+		}
+	}
+	prefetchedIndex = selected;
+}
+
+// While flushing is allowed the emulating core never adds, removes or packs images so the caddy can be walked without imagesLock.
+void DiskCaddy::Flush()
+{
+	unsigned index;
+
+	flushLock.Acquire();
+	if (flushAllowed)
+	{
+		for (index = 0; index < disks.size(); ++index)
+			disks[index]->Flush();
+	}
+	flushLock.Release();
+}
+
+void DiskCaddy::DisallowFlush()
+{
+	flushAllowed = false;
+	flushLock.Acquire();
+	flushLock.Release();
+}
+#endif
+
 void DiskCaddy::Display()
 {
 	unsigned numberOfImages = GetNumberOfImages();
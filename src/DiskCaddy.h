@@ -23,6 +23,9 @@
 #include "DiskImage.h"
 #include "Screen.h"
 #include "ROMs.h"
+#if not defined(EXPERIMENTALZERO)
+#include "SpinLock.h"
+#endif
 
 class DiskCaddy
 {
@@ -30,6 +33,11 @@ public:
 	DiskCaddy()
 		: selectedIndex(0)
 #if not defined(EXPERIMENTALZERO)
+		, readyIndex(NO_IMAGE)
+		, previousIndex(NO_IMAGE)
+		, prefetchedIndex(NO_IMAGE)
+		, imagePending(false)
+		, flushAllowed(false)
 		, screen(0)
 #endif
 		, screenLCD(0)
@@ -55,7 +63,14 @@ public:
 		Update();
 #endif
 		if (selectedIndex < disks.size())
+		{
+#if defined(EXPERIMENTALZERO)
+			PackImages();
 			return disks[selectedIndex];
+#else
+			return TakeImage(selectedIndex);
+#endif
+		}
 
 		return 0;
 	}
@@ -99,22 +114,58 @@ public:
 
 	void Display();
 	bool Update();
+#if not defined(EXPERIMENTALZERO)
+	// Called from core0. Expands the selected image's neighbours and packs the rest so a disk swap on the emulating core is only a pointer change.
+	// It also converts the tracks of the image in the drive and its neighbours.
+	void Prefetch();
+
+	// Called from core0. Writes what the drive has changed back to the SD card while the emulating core lets it.
+	void Flush();
+	// The emulating core only allows flushing while it is in its emulation loop as it does not use the SD card there.
+	// DisallowFlush waits for a flush in progress to finish so the SD card is free again once it returns.
+	void AllowFlush() { flushAllowed = true; }
+	void DisallowFlush();
+
+	// True while the selected image is still being prepared by core0 and the drive has been left empty.
+	// The emulating core keeps calling GetCurrentDisk() until it gets the image.
+	bool IsImagePending() const { return imagePending; }
+#endif
 
 private:
-	bool InsertD64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertG64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertNIB(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertNBZ(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
-	bool InsertD81(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
+	bool InsertD64(const FILINFO* fileInfo, ImageSource& source, bool readOnly);
+	bool InsertG64(const FILINFO* fileInfo, ImageSource& source, bool readOnly);
+	bool InsertNIB(const FILINFO* fileInfo, ImageSource& source, bool readOnly);
+	bool InsertNBZ(const FILINFO* fileInfo, ImageSource& source, bool readOnly);
+	bool InsertD81(const FILINFO* fileInfo, ImageSource& source, bool readOnly);
 	bool InsertT64(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
 	bool InsertPRG(const FILINFO* fileInfo, unsigned char* diskImageData, unsigned size, bool readOnly);
 
 	void ShowSelectedImage(u32 index);
 
+	void PackImages();
+#if not defined(EXPERIMENTALZERO)
+	DiskImage* TakeImage(u32 index);
+	bool IsPrefetched(u32 index, u32 selected) const;
+#endif
+
 	std::vector<DiskImage*> disks;
 	u32 selectedIndex;
 	u32 oldCaddyIndex;
 #if not defined(EXPERIMENTALZERO)
+	static const u32 NO_IMAGE = 0xffffffff;
+
+	// Serialises core0's packing and prefetching with the caddy being filled or emptied. The emulating core never takes it while emulating.
+	SpinLock imagesLock;
+	// The image claimed for the drive and the one it replaced (the drive may still be reading it until the swap completes).
+	// core0 never packs either.
+	volatile u32 readyIndex;
+	volatile u32 previousIndex;
+	volatile u32 prefetchedIndex;
+	// Set by core0 once an image is unpacked with all its tracks converted. Only then can the emulating core take it.
+	std::vector<u8> preparedImages;
+	bool imagePending;
+	SpinLock flushLock;
+	volatile bool flushAllowed;
 	ScreenBase* screen;
 #endif
 	ScreenBase* screenLCD;
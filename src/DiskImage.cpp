@@ -23,16 +23,18 @@
 #include "gcr.h"
 #include "debug.h"
 #include <string.h>
+#include <stdio.h>
 #include <ctype.h>
 #include "lz.h"
+#include "WorkQueue.h"
 #include "Petscii.h"
 #include <malloc.h>
 extern "C"
 {
 #include "rpi-gpio.h"
+#include "rpiHardware.h"
 }
 
-extern u32 HashBuffer(const void* pBuffer, u32 length);
 
 #define MAX_DIRECTORY_SECTORS 18
 #define DIRECTORY_SIZE 32
@@ -42,6 +44,23 @@ extern u32 HashBuffer(const void* pBuffer, u32 length);
 
 #define DIRECTRY_ENTRY_FILE_TYPE_PRG 0x82
 
+//--------------------------------------------------------------------------------------
+// This is an implementation of FNV-1a
+// (http://www.isthe.com/chongo/tech/comp/fnv/)
+//--------------------------------------------------------------------------------------
+u32 HashBuffer(const void* pBuffer, u32 length, u32 hash)
+{
+	u8*	pu8Buffer = (u8*)pBuffer;
+
+	while (length)
+	{
+		hash ^= *pu8Buffer++;
+		hash *= 16777619U;
+		--length;
+	}
+	return hash;
+}
+
 static const u8 blankD64DIRBAM[] =
 {
 	0x12, 0x01, 0x41, 0x00, 0x15, 0xff, 0xff, 0x1f, 0x15, 0xff, 0xff, 0x1f, 0x15, 0xff, 0xff, 0x1f,
@@ -64,8 +83,129 @@ static const u8 blankD64DIRBAM[] =
 };
 
 unsigned char DiskImage::readBuffer[READBUFFER_SIZE];
+unsigned char DiskImage::emptyTrack[MAX_TRACK_LENGTH];
+unsigned char DiskImage::emptySyncBits[(MAX_TRACK_LENGTH >> 3) + 1];
+
+// A D81 track packs both heads (each with the WD177x's spare byte) followed by both heads' sync bits.
+static const unsigned PACK_BUFFER_SIZE = 2 * (MAX_TRACK_LENGTH + 1) + 2 * ((MAX_TRACK_LENGTH >> 3) + 1);
+static unsigned char packBuffer[PACK_BUFFER_SIZE];
+static unsigned char packedBuffer[PACK_BUFFER_SIZE + (PACK_BUFFER_SIZE >> 8) + 1];
+// LZ_CompressFast's working area. Static so packing never touches the heap.
+static unsigned int packWork[PACK_BUFFER_SIZE + 65536];
+// Packed tracks are small so they come from smaller blocks.
+static const unsigned PACKED_BLOCK_SIZE = 0x4000;
+
+// An NBZ with a track index has each of its NIB's tracks compressed on their own rather than the whole NIB in one go.
+// Mounting one only copies the compressed tracks; each is decompressed and extracted the first time it is needed.
+// The file is this header, the NIB's header and then each track's compressed data in the order the NIB header lists them.
+struct NBZTrackIndexHeader
+{
+	char signature[8];
+	u32 version;
+	u32 trackOffsets[HALF_TRACK_COUNT + 1];	// From the start of the file. A track's data runs up to the next one's offset.
+};
+
+static const char NBZ_TRACK_INDEX_SIGNATURE[8] = { 'P', 'I', '1', '5', '4', '1', 'N', 'Z' };
+static const u32 NBZ_TRACK_INDEX_VERSION = 1;
+
+// Big enough for a NIB holding every half track, or that NIB compressed whole or a track at a time (LZ can grow data by 1/256th plus a byte).
+static const unsigned NIB_MAX_SIZE = 0x100 + HALF_TRACK_COUNT * NIB_TRACK_LENGTH;
+static const unsigned NBZ_MAX_SIZE = sizeof(NBZTrackIndexHeader) + 0x100 + HALF_TRACK_COUNT * (NIB_TRACK_LENGTH + (NIB_TRACK_LENGTH >> 8) + 1);
+static unsigned char compressionBuffer[NBZ_MAX_SIZE];
+// LZ_CompressFast's working area when saving an NBZ.
+static unsigned int nibWork[NIB_MAX_SIZE + 65536];
+
+// Holds one track's worth of a streamed image (a D81 track, both heads, is the largest).
+static unsigned char streamBuffer[2 * 10 * D81_SECTOR_LENGTH];
+// Tracks are copied here before they are written back as the drive may still be writing to them.
+static unsigned char flushBuffer[MAX_TRACK_LENGTH];
+
+bool ImageSource::Read(unsigned offset, void* dest, unsigned length)
+{
+	unsigned available = offset < size ? size - offset : 0;
+
+	if (length > available)
+	{
+		memset((unsigned char*)dest + available, 0, length - available);
+		length = available;
+	}
+	if (length == 0)
+		return true;
+
+	if (data)
+	{
+		memcpy(dest, data + offset, length);
+		return true;
+	}
+
+	// A short gap (eg the padding between a G64's tracks) is read and hashed first so the hash still covers the file in order.
+	// Anything further ahead is left for Hash to read if it is ever needed.
+	while (hashing && hashed < offset && offset - hashed < MAX_TRACK_LENGTH)
+	{
+		unsigned char gap[512];
+		unsigned gapLength = offset - hashed < sizeof(gap) ? offset - hashed : sizeof(gap);
+
+		if (!ReadFile(hashed, gap, gapLength))
+			return false;
+		hash = HashBuffer(gap, gapLength, hash);
+		hashed += gapLength;
+	}
+
+	if (!ReadFile(offset, dest, length))
+		return false;
+	if (hashing && offset <= hashed && offset + length > hashed)
+	{
+		hash = HashBuffer((unsigned char*)dest + (hashed - offset), offset + length - hashed, hash);
+		hashed = offset + length;
+	}
+	return true;
+}
+
+bool ImageSource::ReadFile(unsigned offset, void* dest, unsigned length)
+{
+	u32 bytesRead;
+
+	if (offset != f_tell(fp) && f_lseek(fp, offset) != FR_OK)
+		return false;
+	return f_read(fp, dest, length, &bytesRead) == FR_OK && bytesRead == length;
+}
+
+u32 ImageSource::Hash()
+{
+	if (data)
+		return HashBuffer(data, size);
+
+	hashing = true;
+	while (hashed < size)
+	{
+		unsigned length = size - hashed < sizeof(streamBuffer) ? size - hashed : sizeof(streamBuffer);
+		if (!Read(hashed, streamBuffer, length))
+			break;
+	}
+	return hash;
+}
+
+const char* DiskImage::gcrCacheFolder = 0;
 
-static unsigned char compressionBuffer[HALF_TRACK_COUNT * MAX_TRACK_LENGTH];
+// A GCR cache entry is this header followed by the data of each track that has its own data, in track order.
+struct GCRCacheHeader
+{
+	char signature[8];
+	u32 version;
+	u32 hash;			// Of the image file as read, along with its size and time stamp.
+	u32 size;
+	u32 timeStamp;
+	u32 imageSize;		// Of the NIB data (an NBZ's is only known after it is decompressed).
+	u32 dataLength;
+	unsigned short trackLengths[HALF_TRACK_COUNT];
+	unsigned char trackDensity[HALF_TRACK_COUNT];
+	unsigned char trackFlags[HALF_TRACK_COUNT];
+};
+
+static const char GCR_CACHE_SIGNATURE[8] = { 'P', 'I', '1', '5', '4', '1', 'G', 'C' };
+static const u32 GCR_CACHE_VERSION = 1;
+static const unsigned char GCR_CACHE_TRACK_USED = 1;
+static const unsigned char GCR_CACHE_TRACK_DATA = 2;
 
 static const unsigned short SECTOR_LENGTH = 256;
 static const unsigned short SECTOR_LENGTH_WITH_CHECKSUM = 260;
@@ -144,49 +284,297 @@ DiskImage::DiskImage()
 	, dirty(false)
 	, attachedImageSize(0)
 	, fileInfo(0)
+	, packedArena(PACKED_BLOCK_SIZE)
+	, packed(false)
+	, flushFailed(false)
+	, nbzTrackIndex(false)
 {
-	memset(tracks, 0x55, sizeof(tracks));
+	memset(emptyTrack, GCR_GAP_BYTE, sizeof(emptyTrack));
+	ReleaseTracks();
+	ReleasePackedTracks();
+	memset(trackLengths, 0, sizeof(trackLengths));
+	memset(trackDensity, 0, sizeof(trackDensity));
 	memset(trackUsed, 0, sizeof(trackUsed));
+	memset(trackDirty, 0, sizeof(trackDirty));
+	memset(trackFlushed, 0, sizeof(trackFlushed));
+	for (unsigned track = 0; track < HALF_TRACK_COUNT; ++track)
+		trackWrites[track] = 0;
+}
+
+void DiskImage::ReleaseTracks()
+{
+	trackArena.Release();
+	memset(sectorIndexValid, 0, sizeof(sectorIndexValid));
+	for (unsigned track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		tracks[track] = emptyTrack;
+		pendingTracks[track] = 0;
+		tracksD81[track][0] = emptyTrack;
+		tracksD81[track][1] = emptyTrack;
+		trackD81SyncBits[track][0] = emptySyncBits;
+		trackD81SyncBits[track][1] = emptySyncBits;
+	}
+	for (unsigned index = 0; index < SPARE_TRACK_COUNT; ++index)
+		spareTracks[index] = 0;
+}
+
+void DiskImage::ReleasePackedTracks()
+{
+	packedArena.Release();
+	memset(packedTracks, 0, sizeof(packedTracks));
+	memset(packedSizes, 0, sizeof(packedSizes));
+	memset(packedPending, 0, sizeof(packedPending));
+	packed = false;
+}
+
+bool DiskImage::Pack()
+{
+	if (packed)
+		return true;
+
+	for (unsigned track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		unsigned length = 0;
+
+		if (IsD81())
+		{
+			if (tracksD81[track][0] != emptyTrack)
+			{
+				unsigned headLength = trackLengths[track] + 1;
+				memcpy(packBuffer, tracksD81[track][0], headLength);
+				memcpy(packBuffer + headLength, tracksD81[track][1], headLength);
+				length = headLength * 2;
+				memcpy(packBuffer + length, trackD81SyncBits[track][0], sizeof(emptySyncBits));
+				length += sizeof(emptySyncBits);
+				memcpy(packBuffer + length, trackD81SyncBits[track][1], sizeof(emptySyncBits));
+				length += sizeof(emptySyncBits);
+			}
+		}
+		else if (pendingTracks[track])
+		{
+			length = PendingTrackLength(track);
+			memcpy(packBuffer, pendingTracks[track], length);
+			packedPending[track] = true;
+		}
+		else if (tracks[track] != emptyTrack)
+		{
+			length = trackLengths[track];
+			memcpy(packBuffer, tracks[track], length);
+		}
+
+		if (length)
+		{
+			int size = LZ_CompressFast(packBuffer, packedBuffer, length, packWork);
+			unsigned char* data = size > 0 ? packedArena.Allocate(size) : 0;
+			if (data == 0)
+			{
+				DEBUG_LOG("Cannot pack track %d\r\n", track);
+				ReleasePackedTracks();
+				return false;
+			}
+			memcpy(data, packedBuffer, size);
+			packedTracks[track] = data;
+			packedSizes[track] = size;
+		}
+	}
+
+	ReleaseTracks();
+	packed = true;
+	return true;
+}
+
+bool DiskImage::Unpack()
+{
+	bool unpacked = true;
+
+	if (!packed)
+		return true;
+
+	for (unsigned track = 0; track < HALF_TRACK_COUNT && unpacked; ++track)
+	{
+		if (packedTracks[track] == 0)
+			continue;
+
+		if (IsD81())
+		{
+			unsigned headLength = trackLengths[track] + 1;
+			unsigned length = LZ_Uncompress(packedTracks[track], packBuffer, packedSizes[track]);
+			unpacked = length == (headLength + sizeof(emptySyncBits)) * 2;
+
+			for (unsigned headIndex = 0; headIndex < 2 && unpacked; ++headIndex)
+			{
+				unsigned char* dest = AllocateTrackD81(track, headIndex);
+				unpacked = dest != 0;
+				if (unpacked)
+				{
+					memcpy(dest, packBuffer + headIndex * headLength, headLength);
+					memcpy(trackD81SyncBits[track][headIndex], packBuffer + headLength * 2 + headIndex * sizeof(emptySyncBits), sizeof(emptySyncBits));
+					trackArena.Shrink(dest, headLength);
+				}
+			}
+		}
+		else if (packedPending[track])
+		{
+			unsigned length = PendingTrackLength(track);
+			unsigned char* dest = trackArena.Allocate(PendingTrackAllocation(track));
+			unpacked = dest != 0 && (unsigned)LZ_Uncompress(packedTracks[track], dest, packedSizes[track]) == length;
+			if (unpacked)
+				pendingTracks[track] = dest;
+		}
+		else
+		{
+			unsigned char* dest = trackArena.Allocate(trackLengths[track]);
+			unpacked = dest != 0 && LZ_Uncompress(packedTracks[track], dest, packedSizes[track]) == trackLengths[track];
+			if (unpacked)
+				tracks[track] = dest;
+		}
+	}
+
+	if (!unpacked)
+	{
+		// Stay packed so nothing is lost.
+		DEBUG_LOG("Cannot unpack %s\r\n", fileInfo ? fileInfo->fname : "");
+		ReleaseTracks();
+		return false;
+	}
+
+	ReleasePackedTracks();
+	return true;
+}
+
+// Gives a track its own memory, starting with what it read as before (normally the empty track).
+unsigned char* DiskImage::AllocateTrack(unsigned track, unsigned length)
+{
+	if (length > MAX_TRACK_LENGTH)
+		length = MAX_TRACK_LENGTH;
+
+	unsigned char* data = trackArena.Allocate(length);
+	if (data == 0)
+	{
+		DEBUG_LOG("Out of memory for track %d\r\n", track);
+		return 0;
+	}
+	memcpy(data, tracks[track], length);
+	tracks[track] = data;
+	return data;
+}
+
+// Keeps a few unformatted tracks ready for the drive to take the first time it writes to a track the image does not have (eg a half track).
+// The caddy calls it while mounting and core0 tops the spares up while emulating, so the emulating core normally never allocates.
+bool DiskImage::ReserveSpareTracks()
+{
+	bool reserved = true;
+
+	// The WD177x writes straight into the D81's tracks, which are all allocated when it is opened.
+	if (IsD81())
+		return true;
+
+#if defined(HAS_MULTICORE)
+	trackLock.Acquire();
+#endif
+	for (unsigned index = 0; index < SPARE_TRACK_COUNT && reserved; ++index)
+	{
+		if (spareTracks[index] == 0)
+		{
+			unsigned char* data = trackArena.Allocate(MAX_TRACK_LENGTH);
+			reserved = data != 0;
+			if (reserved)
+			{
+				memcpy(data, emptyTrack, MAX_TRACK_LENGTH);
+				DataMemBarrier();
+				spareTracks[index] = data;
+			}
+		}
+	}
+#if defined(HAS_MULTICORE)
+	trackLock.Release();
+#endif
+	if (!reserved)
+		DEBUG_LOG("Out of memory for spare tracks\r\n");
+	return reserved;
+}
+
+// Called from the emulating core. Only if core0 has not yet replaced the spares it has used does it allocate the track itself.
+bool DiskImage::TakeSpareTrack(unsigned track)
+{
+	for (unsigned index = 0; index < SPARE_TRACK_COUNT; ++index)
+	{
+		unsigned char* data = spareTracks[index];
+		if (data)
+		{
+			spareTracks[index] = 0;
+			tracks[track] = data;
+			return true;
+		}
+	}
+
+#if defined(HAS_MULTICORE)
+	trackLock.Acquire();
+#endif
+	bool allocated = AllocateTrack(track, trackLengths[track]) != 0;
+#if defined(HAS_MULTICORE)
+	trackLock.Release();
+#endif
+	return allocated;
+}
+
+// The head's data is allocated last so it can be shrunk to fit once the track has been encoded.
+unsigned char* DiskImage::AllocateTrackD81(unsigned track, unsigned headIndex)
+{
+	unsigned char* syncBits = trackArena.Allocate(sizeof(emptySyncBits));
+	unsigned char* data = syncBits ? trackArena.Allocate(MAX_TRACK_LENGTH) : 0;
+	if (data == 0)
+	{
+		DEBUG_LOG("Out of memory for track %d\r\n", track);
+		return 0;
+	}
+	memset(syncBits, 0, sizeof(emptySyncBits));
+	memset(data, 0x4e, MAX_TRACK_LENGTH);
+	trackD81SyncBits[track][headIndex] = syncBits;
+	tracksD81[track][headIndex] = data;
+	return data;
 }
 
 void DiskImage::Close()
 {
+	// Packed images need their tracks back to be written out.
+	if (packed && dirty)
+		Unpack();
+
 	switch (diskType)
 	{
 		case D64:
 			CloseD64();
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 		case G64:
 			CloseG64();
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 		case NIB:
 			CloseNIB();
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 		case NBZ:
 			CloseNBZ();
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 		case D71:
 			CloseD71();
-			memset(tracksD81, 0x55, sizeof(tracksD81));
 		break;
 		case D81:
 			CloseD81();
-			memset(tracksD81, 0, sizeof(tracksD81));
 		break;
 		case T64:
 			CloseT64();
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 		default:
-			memset(tracks, 0x55, sizeof(tracks));
 		break;
 	}
+	ReleaseTracks();
+	ReleasePackedTracks();
 	memset(trackLengths, 0, sizeof(trackLengths));
 	memset(trackUsed, 0, sizeof(trackUsed));
+	memset(trackDirty, 0, sizeof(trackDirty));
+	memset(trackFlushed, 0, sizeof(trackFlushed));
+	flushFailed = false;
+	nbzTrackIndex = false;
 	diskType = NONE;
 	fileInfo = 0;
 	hash = 0;
@@ -194,12 +582,8 @@ void DiskImage::Close()
 
 void DiskImage::DumpTrack(unsigned track)
 {
-
-#if defined(EXPERIMENTALZERO)
-	unsigned char* src = &tracks[track << 13];
-#else
+	PrepareTrack(track);
 	unsigned char* src = tracks[track];
-#endif
 	unsigned trackLength = trackLengths[track];
 	DEBUG_LOG("track = %d trackLength = %d\r\n", track, trackLength);
 	for (unsigned index = 0; index < trackLength; ++index)
@@ -210,13 +594,18 @@ void DiskImage::DumpTrack(unsigned track)
 
 bool DiskImage::OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
 {
-	unsigned char errorinfo[MAXBLOCKSONDISK];
+	ImageSource source(diskImage, size);
+	return OpenD64(fileInfo, source);
+}
+
+bool DiskImage::OpenD64(const FILINFO* fileInfo, ImageSource& source)
+{
+	unsigned char errorinfo[MAXBLOCKSONDISK + 2 * 17];	// Room for non-standard 42 track images
 	unsigned last_track;
 	unsigned sector_ref;
 	unsigned sectors;
-	unsigned speedZoneIndex;
-	unsigned sectorSize;
-	unsigned char error;
+	unsigned size = source.Size();
+	bool read = true;
 
 	Close();
 
@@ -234,14 +623,14 @@ bool DiskImage::OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 	switch (size)
 	{
 		case (BLOCKSONDISK * 257):		// 35 track image with errorinfo
-			memcpy(errorinfo, diskImage + (BLOCKSONDISK * 256), BLOCKSONDISK);
+			read = source.Read(BLOCKSONDISK * 256, errorinfo, BLOCKSONDISK);
 			/* FALLTHROUGH */
 		case (BLOCKSONDISK * 256):		// 35 track image w/o errorinfo
 			last_track = 35;
 			break;
 
 		case (MAXBLOCKSONDISK * 257):	// 40 track image with errorinfo
-			memcpy(errorinfo, diskImage + (MAXBLOCKSONDISK * 256), MAXBLOCKSONDISK);
+			read = source.Read(MAXBLOCKSONDISK * 256, errorinfo, MAXBLOCKSONDISK);
 			/* FALLTHROUGH */
 		case (MAXBLOCKSONDISK * 256):	// 40 track image w/o errorinfo
 			last_track = 40;
@@ -252,15 +641,17 @@ bool DiskImage::OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 			break;
 	}
 
+	if (!read || !source.Read(0x165A2, diskID, sizeof(diskID)))
+	{
+		Close();
+		return false;
+	}
+
 	sector_ref = 0;
 	for (unsigned halfTrackIndex = 0; halfTrackIndex < last_track * 2; ++halfTrackIndex)
 	{
 		unsigned char track = (halfTrackIndex >> 1);
-#if defined(EXPERIMENTALZERO)
-		unsigned char* dest = &tracks[halfTrackIndex << 13];
-#else
-		unsigned char* dest = tracks[halfTrackIndex];
-#endif
+		unsigned char* dest;
 
 	trackLengths[halfTrackIndex] = trackSize[GetSpeedZoneIndexD64(track)];
 
@@ -268,19 +659,21 @@ bool DiskImage::OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 		{
 			if (offset < size)	// This will allow for >35 tracks.
 			{
-				trackUsed[halfTrackIndex] = true;
-				//DEBUG_LOG("Track %d used\r\n", halfTrackIndex);
-				speedZoneIndex = GetSpeedZoneIndexD64(track);
-				sectors = sectorsPerTrack[speedZoneIndex];
-				sectorSize = GCR_SYNC_LENGTH + GCR_HEADER_LENGTH + GCR_HEADER_GAP_LENGTH + GCR_SYNC_LENGTH + GCR_SECTOR_DATA_LENGTH + gapSize[speedZoneIndex];
-
-				for (unsigned sectorNo = 0; sectorNo < sectors; ++sectorNo)
+				// Keep the sectors so the track can be converted when it is first needed.
+				// The sectors are read straight from the file into the memory the track is converted in.
+				sectors = SectorsPerTrackD64(track);
+				dest = trackArena.Allocate(PendingTrackAllocation(halfTrackIndex));
+				if (dest == 0 || !source.Read(offset, dest, sectors * SECTOR_LENGTH))
 				{
-					error = errorinfo[sector_ref++];
-					convert_sector_to_GCR(diskImage + offset, dest, track + 1, sectorNo, diskImage + 0x165A2, error, sectorSize);
-					dest += sectorSize;
-					offset += SECTOR_LENGTH;
+					Close();
+					return false;
 				}
+				pendingTracks[halfTrackIndex] = dest;
+				trackUsed[halfTrackIndex] = true;
+				//DEBUG_LOG("Track %d used\r\n", halfTrackIndex);
+				memcpy(dest + sectors * SECTOR_LENGTH, errorinfo + sector_ref, sectors);
+				offset += sectors * SECTOR_LENGTH;
+				sector_ref += sectors;
 			}
 			else
 			{
@@ -296,9 +689,276 @@ bool DiskImage::OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 	}
 
 	diskType = D64;
+
+	// The directory track is the first one anything will want.
+	PrepareTrack(34);
+	return true;
+}
+
+unsigned DiskImage::PendingTrackLength(unsigned track) const
+{
+	// An NBZ's pending tracks are its compressed NIB tracks.
+	if (diskType == NBZ)
+		return pendingSizes[track];
+	return SectorsPerTrackD64(track >> 1) * (SECTOR_LENGTH + 1);
+}
+
+// A D64 track is converted in the memory that holds its sectors so that memory is given a track's length up front.
+unsigned DiskImage::PendingTrackAllocation(unsigned track) const
+{
+	unsigned length = PendingTrackLength(track);
+
+	if (diskType != NBZ && length < trackLengths[track])
+		length = trackLengths[track];
+	return length;
+}
+
+void DiskImage::PrepareTrack(unsigned track)
+{
+	if (pendingTracks[track])
+		ConvertPendingTrack(track);
+	// core0 may have just converted it; make sure the track is seen along with the cleared pendingTracks.
+	DataMemBarrier();
+}
+
+// core0 converts the tracks of the image in the drive in the background while the drive may need one now, so they take turns.
+bool DiskImage::ConvertPendingTrack(unsigned track)
+{
+	bool converted = true;
+
+#if defined(HAS_MULTICORE)
+	trackLock.Acquire();
+#endif
+	if (pendingTracks[track])
+		converted = diskType == NBZ ? ConvertPendingNIBTrack(track) : ConvertPendingD64Track(track);
+#if defined(HAS_MULTICORE)
+	trackLock.Release();
+#endif
+	return converted;
+}
+
+// The GCR sectors are larger than the sectors they are built from so building them from the last sector back only ever overwrites sectors already converted.
+// The track only replaces the empty track once it is complete so it never reads as partly converted.
+bool DiskImage::ConvertPendingD64Track(unsigned track)
+{
+	unsigned speedZoneIndex = GetSpeedZoneIndexD64(track >> 1);
+	unsigned sectors = sectorsPerTrack[speedZoneIndex];
+	unsigned sectorSize = GCR_SYNC_LENGTH + GCR_HEADER_LENGTH + GCR_HEADER_GAP_LENGTH + GCR_SYNC_LENGTH + GCR_SECTOR_DATA_LENGTH + gapSize[speedZoneIndex];
+	unsigned char* dest = pendingTracks[track];
+	unsigned char errors[SECTOR_INDEX_SIZE];
+	unsigned char sector[SECTOR_LENGTH];
+
+	memcpy(errors, dest + sectors * SECTOR_LENGTH, sectors);
+	memset(dest + sectors * sectorSize, GCR_GAP_BYTE, trackLengths[track] - sectors * sectorSize);
+
+	for (unsigned sectorNo = sectors; sectorNo-- > 0; )
+	{
+		memcpy(sector, dest + sectorNo * SECTOR_LENGTH, SECTOR_LENGTH);
+		convert_sector_to_GCR(sector, dest + sectorNo * sectorSize, (track >> 1) + 1, sectorNo, diskID, errors[sectorNo], sectorSize);
+	}
+
+	DataMemBarrier();
+	tracks[track] = dest;
+	DataMemBarrier();
+	pendingTracks[track] = 0;
+	return true;
+}
+
+// The NIB track is decompressed into the second half of the allocation and extracted into the first, which is then shrunk to fit.
+// Nothing static is used as core0 can be preparing another image's tracks at the same time.
+bool DiskImage::ConvertPendingNIBTrack(unsigned track)
+{
+	int align;
+	unsigned char* dest = trackArena.Allocate(NIB_TRACK_LENGTH * 2);
+	if (dest == 0)
+	{
+		DEBUG_LOG("Out of memory for track %d\r\n", track);
+		return false;
+	}
+
+	unsigned char* nibdata = dest + NIB_TRACK_LENGTH;
+	if (LZ_UncompressBounded(pendingTracks[track], nibdata, pendingSizes[track], NIB_TRACK_LENGTH) != NIB_TRACK_LENGTH)
+	{
+		// Left unformatted rather than tried again.
+		DEBUG_LOG("Cannot decompress NBZ track %d\r\n", track);
+		trackArena.Shrink(dest, 0);
+		pendingTracks[track] = 0;
+		return false;
+	}
+
+	trackLengths[track] = extract_GCR_track(dest, nibdata, &align
+		, ALIGN_NONE
+		, capacity_min[trackDensity[track]],
+		capacity_max[trackDensity[track]]);
+	trackArena.Shrink(dest, trackLengths[track]);
+	DataMemBarrier();
+	tracks[track] = trackLengths[track] ? dest : emptyTrack;
+	DataMemBarrier();
+	pendingTracks[track] = 0;
 	return true;
 }
 
+void DiskImage::PrepareTracks()
+{
+	for (unsigned track = 0; track < HALF_TRACK_COUNT; ++track)
+		PrepareTrack(track);
+}
+
+static bool ReadAt(FIL* fp, unsigned offset, void* data, unsigned length)
+{
+	u32 bytesRead;
+	return f_lseek(fp, offset) == FR_OK && f_read(fp, data, length, &bytesRead) == FR_OK && bytesRead == length;
+}
+
+static bool WriteAt(FIL* fp, unsigned offset, const void* data, unsigned length)
+{
+	u32 bytesWritten;
+	return f_lseek(fp, offset) == FR_OK && f_write(fp, data, length, &bytesWritten) == FR_OK && bytesWritten == length;
+}
+
+// Copies a track to be written back into flushBuffer, returning false if it has not changed.
+// While flushing core1 can still be writing to the track, so its dirty flag is cleared before it is copied and a write that lands meanwhile marks it dirty again.
+// A copy that a write may have torn is not written at all; the track stays dirty and is tried again next time.
+// Closing writes back every track that has been flushed as well as the dirty ones.
+bool DiskImage::CopyTrack(unsigned track, bool flushing)
+{
+	u32 writes;
+
+	if (flushing)
+	{
+		if (!trackDirty[track])
+			return false;
+		trackDirty[track] = false;
+		trackFlushed[track] = true;
+		writes = trackWrites[track];
+		DataMemBarrier();
+		memcpy(flushBuffer, tracks[track], trackLengths[track]);
+		DataMemBarrier();
+		if (trackWrites[track] != writes)
+		{
+			trackDirty[track] = true;
+			return false;
+		}
+		return true;
+	}
+	else if (!trackDirty[track] && !trackFlushed[track])
+	{
+		return false;
+	}
+	memcpy(flushBuffer, tracks[track], trackLengths[track]);
+	return true;
+}
+
+bool DiskImage::FinishUpdate(FIL* fp, unsigned failedTrack, bool flushing, bool success)
+{
+	SetACTLed(false);
+	f_close(fp);
+
+	if (flushing)
+	{
+		if (failedTrack < HALF_TRACK_COUNT)
+			trackDirty[failedTrack] = true;
+	}
+	else if (success)
+	{
+		memset(trackDirty, 0, sizeof(trackDirty));
+		memset(trackFlushed, 0, sizeof(trackFlushed));
+	}
+	return success;
+}
+
+// WriteD64 packs the used tracks one after another so the file must be exactly that size for the tracks to still be where we expect.
+bool DiskImage::UpdateD64(bool flushing)
+{
+	unsigned trackOffsets[HALF_TRACK_COUNT];
+	int headerIndex[SECTOR_INDEX_SIZE];
+	int dataIndex[SECTOR_INDEX_SIZE];
+	BYTE trackData[SECTOR_INDEX_SIZE * SECTOR_LENGTH];
+	unsigned track, sector, sectors;
+	unsigned offset = 0;
+	FIL fp;
+
+	for (track = 0; track < HALF_TRACK_COUNT; track += 2)
+	{
+		trackOffsets[track] = offset;
+		if (trackUsed[track])
+			offset += sectorsPerTrack[GetSpeedZoneIndexD64(track >> 1)] * SECTOR_LENGTH;
+	}
+
+	if (f_open(&fp, fileInfo->fname, FA_READ | FA_WRITE) != FR_OK)
+		return false;
+
+	SetACTLed(true);
+	if (f_size(&fp) != offset)
+		return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, false);
+
+	for (track = 0; track < HALF_TRACK_COUNT; track += 2)
+	{
+		if (trackUsed[track] && CopyTrack(track, flushing))
+		{
+			DEBUG_LOG("Updating D64 track %d\r\n", (track >> 1) + 1);
+
+			// The copy is decoded rather than the track itself as it may still be changing.
+			memset(trackData, 0, sizeof(trackData));
+			IndexSectors(flushBuffer, trackLengths[track], headerIndex, dataIndex);
+			sectors = sectorsPerTrack[GetSpeedZoneIndexD64(track >> 1)];
+			for (sector = 0; sector < sectors; sector++)
+			{
+				// A sector that is missing or fails its checksum may be half way through being written so the track is left until the next flush.
+				if ((headerIndex[sector] < 0 || !DecodeSector(flushBuffer, trackLengths[track], dataIndex[sector], trackData + sector * SECTOR_LENGTH)) && flushing)
+					break;
+			}
+			if (sector < sectors)
+			{
+				DEBUG_LOG("D64 track %d has a bad sector, leaving it dirty\r\n", (track >> 1) + 1);
+				trackDirty[track] = true;
+				continue;
+			}
+			if (!WriteAt(&fp, trackOffsets[track], trackData, sectors * SECTOR_LENGTH))
+				return FinishUpdate(&fp, track, flushing, false);
+		}
+	}
+	return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, true);
+}
+
+bool DiskImage::Flush()
+{
+	unsigned track;
+	bool success;
+
+	if (readOnly || packed || flushFailed || fileInfo == 0)
+		return false;
+
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		if (trackDirty[track])
+			break;
+	}
+	if (track == HALF_TRACK_COUNT)
+		return true;
+
+	switch (diskType)
+	{
+		case D64:
+			success = UpdateD64(true);
+		break;
+		case G64:
+			success = UpdateG64(true);
+		break;
+		case NIB:
+			success = UpdateNIB(true);
+		break;
+		default:
+			success = false;
+		break;
+	}
+
+	// Once the file no longer matches the tracks (eg a newly formatted track) it is left for Close to rewrite. NBZs are always left for Close.
+	if (!success)
+		flushFailed = true;
+	return success;
+}
+
 bool DiskImage::WriteD64(char* name)
 {
 	BYTE id[3];
@@ -312,6 +972,9 @@ bool DiskImage::WriteD64(char* name)
 		return false;
 	}
 
+	if (fileInfo && UpdateD64(false))
+		return true;
+
 	FIL fp;
 	FRESULT res = f_open(&fp, fileInfo ? fileInfo->fname : name, FA_CREATE_ALWAYS | FA_WRITE);
 	if (res == FR_OK)
@@ -359,6 +1022,8 @@ bool DiskImage::WriteD64(char* name)
 		//f_utime(fileInfo->fname, fileInfo);
 		SetACTLed(false);
 
+		memset(trackDirty, 0, sizeof(trackDirty));
+		memset(trackFlushed, 0, sizeof(trackFlushed));
 		DEBUG_LOG("Converted %d blocks into D64 file\r\n", blocks_to_save);
 
 		return true;
@@ -425,14 +1090,14 @@ bool DiskImage::OpenD71(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 	}
 
 	sector_ref = 0;
+	// Only the first side can be reached by the drive.
+	if (last_track > HALF_TRACK_COUNT / 2)
+		last_track = HALF_TRACK_COUNT / 2;
+
 	for (unsigned halfTrackIndex = 0; halfTrackIndex < last_track * 2; ++halfTrackIndex)
 	{
 		unsigned char track = (halfTrackIndex >> 1);
-#if defined(EXPERIMENTALZERO)
-		unsigned char* dest = &tracks[halfTrackIndex << 13];
-#else
-		unsigned char* dest = tracks[halfTrackIndex];
-#endif
+		unsigned char* dest;
 
 		trackLengths[halfTrackIndex] = trackSize[GetSpeedZoneIndexD64(track)];
 
@@ -440,6 +1105,12 @@ bool DiskImage::OpenD71(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 		{
 			if (offset < size)
 			{
+				dest = AllocateTrack(halfTrackIndex, trackLengths[halfTrackIndex]);
+				if (dest == 0)
+				{
+					Close();
+					return false;
+				}
 				trackUsed[halfTrackIndex] = true;
 				speedZoneIndex = GetSpeedZoneIndexD64(track);
 				sectors = sectorsPerTrack[speedZoneIndex];
@@ -546,10 +1217,18 @@ void DiskImage::CloseD71()
 }
 
 bool DiskImage::OpenD81(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
+{
+	ImageSource source(diskImage, size);
+	return OpenD81(fileInfo, source);
+}
+
+bool DiskImage::OpenD81(const FILINFO* fileInfo, ImageSource& source)
 {
 	const unsigned physicalSectors = 10;
+	const unsigned trackSize = 2 * physicalSectors * D81_SECTOR_LENGTH;
 	unsigned char headIndex;
 	unsigned headPos;
+	unsigned size = source.Size();
 
 	Close();
 
@@ -562,16 +1241,20 @@ bool DiskImage::OpenD81(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 
 	attachedImageSize = size;
 
-	unsigned char* src = diskImage;
-
 	for (unsigned trackIndex = 0; trackIndex < D81_TRACK_COUNT; ++trackIndex)
 	{
 		unsigned offsetDest = 0;
 		unsigned index;
+		unsigned char* src = streamBuffer;
+
+		// Each track (both heads) is read just before it is encoded.
+		if (!source.Read(trackIndex * trackSize, streamBuffer, trackSize))
+		{
+			Close();
+			return false;
+		}
 
 		trackUsed[trackIndex] = true;
-		memset(trackD81SyncBits[trackIndex][0], 0, MAX_TRACK_LENGTH >> 3);
-		memset(trackD81SyncBits[trackIndex][1], 0, MAX_TRACK_LENGTH >> 3);
 //32x	4e
 // For 10 sectors
 //		12x	00	// SYNC
@@ -677,7 +1360,12 @@ bool DiskImage::OpenD81(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 		// (sectors 20 - 39 are on physical side 2)
 		for (headIndex = 0; headIndex < 2; ++headIndex)
 		{
-			unsigned char* dest = tracksD81[trackIndex][headIndex];
+			unsigned char* dest = AllocateTrackD81(trackIndex, headIndex);
+			if (dest == 0)
+			{
+				Close();
+				return false;
+			}
 			memset(dest, 0x4e, 32); dest += 32;
 			for (physicalSectorIndex = 0; physicalSectorIndex < physicalSectors; ++physicalSectorIndex)
 			{
@@ -732,6 +1420,7 @@ bool DiskImage::OpenD81(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 			}
 
 			trackLengths[trackIndex] = dest - tracksD81[trackIndex][headIndex];
+			trackArena.Shrink(tracksD81[trackIndex][headIndex], trackLengths[trackIndex] + 1);
 		}
 	}
 
@@ -849,35 +1538,50 @@ void DiskImage::CloseD81()
 
 bool DiskImage::OpenG64(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
 {
+	ImageSource source(diskImage, size);
+	return OpenG64(fileInfo, source);
+}
+
+// Each track is read straight into its own memory. The whole file is still hashed (see GetHash) as the tracks are read.
+bool DiskImage::OpenG64(const FILINFO* fileInfo, ImageSource& source)
+{
+	unsigned char header[12];
+	u32 trackOffsets[MAX_HALFTRACKS_1541];
+	u32 trackSpeeds[MAX_HALFTRACKS_1541];
+
 	Close();
 
 	this->fileInfo = fileInfo;
 
-	attachedImageSize = size;
+	attachedImageSize = source.Size();
 
-	if (memcmp(diskImage, "GCR-1541", 8) == 0)
+	source.HashAsRead();
+	if (source.Read(0, header, sizeof(header)) && memcmp(header, "GCR-1541", 8) == 0)
 	{
-		hash = HashBuffer(diskImage, size);
+		unsigned char numTracks = header[9];
+		//DEBUG_LOG("numTracks = %d\r\n", numTracks);
 
-		//DEBUG_LOG("Is G64 %08x\r\n", hash);
+		if (numTracks > MAX_HALFTRACKS_1541)
+			numTracks = MAX_HALFTRACKS_1541;
 
-		unsigned char numTracks = diskImage[9];
-		//DEBUG_LOG("numTracks = %d\r\n", numTracks);
+		if (!source.Read(sizeof(header), trackOffsets, sizeof(trackOffsets))
+			|| !source.Read(sizeof(header) + sizeof(trackOffsets), trackSpeeds, sizeof(trackSpeeds)))
+		{
+			Close();
+			return false;
+		}
 
-		unsigned char* data = diskImage + 12;
-		unsigned char* speedZoneData = diskImage + 0x15c;
 		unsigned short trackLength = 0;
 
 		unsigned track;
 
 		for (track = 0; track < numTracks; ++track)
 		{
-			unsigned offset = *(unsigned*)data;
-			data += 4;
+			unsigned offset = trackOffsets[track];
 
 			//DEBUG_LOG("Track = %d Offset = %x\r\n", track, offset);
 
-			trackDensity[track] = *(unsigned*)(speedZoneData + track * 4);
+			trackDensity[track] = trackSpeeds[track];
 
 			if (offset == 0)
 			{
@@ -886,22 +1590,30 @@ bool DiskImage::OpenG64(const FILINFO* fileInfo, unsigned char* diskImage, unsig
 			}
 			else
 			{
-				unsigned char* trackData = diskImage + offset;
-
-				trackLength = *(unsigned short*)(trackData);
+				if (!source.Read(offset, &trackLength, sizeof(trackLength)))
+				{
+					Close();
+					return false;
+				}
 				//DEBUG_LOG("trackLength = %d offset = %d\r\n", trackLength, offset);
-				trackData += 2;
+				if (trackLength > MAX_TRACK_LENGTH)
+					trackLength = MAX_TRACK_LENGTH;
 				trackLengths[track] = trackLength;
-#if defined(EXPERIMENTALZERO)
-				memcpy(&tracks[track << 13], trackData, trackLength);
-#else
-				memcpy(tracks[track], trackData, trackLength);
-#endif
+				unsigned char* dest = AllocateTrack(track, trackLength);
+				if (dest == 0 || !source.Read(offset + sizeof(trackLength), dest, trackLength))
+				{
+					Close();
+					return false;
+				}
 				trackUsed[track] = true;
 				//DEBUG_LOG("%d has data\r\n", track);
 			}
 		}
 
+		hash = source.Hash();
+
+		//DEBUG_LOG("Is G64 %08x\r\n", hash);
+
 		diskType = G64;
 		return true;
 	}
@@ -922,11 +1634,56 @@ static bool WriteDwords(FIL* fp, u32* values, u32 amount)
 	return true;
 }
 
+// A dirty track can be written over its old copy as long as the file already holds it at the same length and speed.
+bool DiskImage::UpdateG64(bool flushing)
+{
+	BYTE header[12];
+	u32 trackOffsets[MAX_HALFTRACKS_1541];
+	u32 trackSpeeds[MAX_HALFTRACKS_1541];
+	unsigned short trackLength;
+	unsigned track;
+	FIL fp;
+
+	if (f_open(&fp, fileInfo->fname, FA_READ | FA_WRITE) != FR_OK)
+		return false;
+
+	SetACTLed(true);
+	if (!ReadAt(&fp, 0, header, sizeof(header)) || memcmp(header, "GCR-1541", 8) != 0
+		|| !ReadAt(&fp, sizeof(header), trackOffsets, sizeof(trackOffsets))
+		|| !ReadAt(&fp, sizeof(header) + sizeof(trackOffsets), trackSpeeds, sizeof(trackSpeeds)))
+	{
+		return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, false);
+	}
+
+	for (track = 0; track < MAX_HALFTRACKS_1541; ++track)
+	{
+		if (!CopyTrack(track, flushing))
+			continue;
+
+		if (track >= header[9] || trackOffsets[track] == 0 || trackSpeeds[track] != trackDensity[track]
+			|| !ReadAt(&fp, trackOffsets[track], &trackLength, sizeof(trackLength)) || trackLength != trackLengths[track]
+			|| trackOffsets[track] + sizeof(trackLength) + trackLength > f_size(&fp))
+		{
+			return FinishUpdate(&fp, track, flushing, false);
+		}
+
+		DEBUG_LOG("Updating G64 track %d\r\n", track);
+		if (!WriteAt(&fp, trackOffsets[track] + sizeof(trackLength), flushBuffer, trackLength))
+			return FinishUpdate(&fp, track, flushing, false);
+	}
+	return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, true);
+}
+
 bool DiskImage::WriteG64(char* name)
 {
 	if (readOnly)
 		return true;
 
+	if (fileInfo && UpdateG64(false))
+		return true;
+
+	PrepareTracks();
+
 	FIL fp;
 	FRESULT res = f_open(&fp, fileInfo ? fileInfo->fname : name, FA_CREATE_ALWAYS | FA_WRITE);
 	if (res == FR_OK)
@@ -991,106 +1748,441 @@ bool DiskImage::WriteG64(char* name)
 
 			tempfillbyte = 0x55;
 
-			memset(&gcr_track[2], tempfillbyte, G64_TRACK_MAXLEN);
+			memset(&gcr_track[2], tempfillbyte, G64_TRACK_MAXLEN);
+
+			gcr_track[0] = (BYTE)(track_len % 256);
+			gcr_track[1] = (BYTE)(track_len / 256);
+			memcpy(buffer, tracks[track], track_len);
+
+			memcpy(gcr_track + 2, buffer, track_len);
+			bytesToWrite = G64_TRACK_MAXLEN + 2;
+			SetACTLed(true);
+			if (f_write(&fp, gcr_track, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
+			{
+				SetACTLed(false);
+				DEBUG_LOG("Cannot write track data.\r\n");
+				f_close(&fp);
+				return false;
+			}
+			SetACTLed(false);
+		}
+
+		f_close(&fp);
+		memset(trackDirty, 0, sizeof(trackDirty));
+		memset(trackFlushed, 0, sizeof(trackFlushed));
+		DEBUG_LOG("nSuccessfully saved G64\r\n");
+
+		return true;
+	}
+	else
+	{
+		DEBUG_LOG("Failed to open %s for write\r\n", fileInfo->fname);
+		return false;
+	}
+}
+
+void DiskImage::CloseG64()
+{
+	if (dirty)
+	{
+		WriteG64();
+
+		dirty = false;
+	}
+	attachedImageSize = 0;
+}
+
+bool DiskImage::OpenNIB(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
+{
+	ImageSource source(diskImage, size);
+	return OpenNIB(fileInfo, source);
+}
+
+bool DiskImage::OpenNIB(const FILINFO* fileInfo, ImageSource& source)
+{
+	unsigned char signature[13];
+	unsigned size = source.Size();
+
+	Close();
+
+	this->fileInfo = fileInfo;
+
+	attachedImageSize = size;
+
+	if (GCRCacheEnabled())
+		source.HashAsRead();
+	if (source.Read(0, signature, sizeof(signature)) && memcmp(signature, "MNIB-1541-RAW", 13) == 0)
+	{
+		// The file is only read through for its hash first if there is an entry to check it against.
+		// Otherwise it is hashed as it is converted so it is not read twice.
+		if (!GCRCacheExists(size) || !LoadGCRCache(source.Hash(), size))
+		{
+			if (!ConvertNIB(source))
+				return false;
+			if (GCRCacheEnabled())
+				SaveGCRCache(source.Hash(), size);
+		}
+		diskType = NIB;
+		return true;
+	}
+	return false;
+}
+
+// What the cores extracting a NIB's tracks share. Each index is one track, read into its own NIB_TRACK_LENGTH slot of data.
+struct NIBTracks
+{
+	DiskImage* diskImage;
+	unsigned char* data;
+	const int* track;
+};
+
+// The raw tracks are read here a batch at a time and extracted in place, one batch being read while the other is extracted.
+// Each finished track is then copied into an allocation of its own length so none of the raw data is left on the heap.
+static const unsigned NIB_BATCH_TRACKS = 4;
+static unsigned char nibBatches[2][NIB_BATCH_TRACKS * NIB_TRACK_LENGTH];
+
+// extract_GCR_track reads all of the NIB data before it writes the track so each track is extracted over its own data.
+void DiskImage::ExtractNIBTrack(void* context, unsigned index)
+{
+	NIBTracks* nib = (NIBTracks*)context;
+	DiskImage* diskImage = nib->diskImage;
+	unsigned char* data = nib->data + index * NIB_TRACK_LENGTH;
+	int track = nib->track[index];
+	int align;
+
+	diskImage->trackLengths[track] = extract_GCR_track(data, data, &align
+		//, ALIGN_GAP
+		, ALIGN_NONE
+		, capacity_min[diskImage->trackDensity[track]],
+		capacity_max[diskImage->trackDensity[track]]);
+}
+
+// The tracks of each batch are handed to any idle cores while this one reads the next batch.
+bool DiskImage::ConvertNIB(ImageSource& source)
+{
+	unsigned char header[NIB_HEADER_SIZE + 1];
+	int trackList[HALF_TRACK_COUNT];
+	NIBTracks nib;
+	int track, t_index = 0, h_index = 0;
+	int first, count, next, index;
+	unsigned batch = 0;
+	unsigned job;
+
+	if (!source.Read(0, header, sizeof(header)))
+	{
+		Close();
+		return false;
+	}
+
+	for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
+	{
+		trackLengths[track] = capacity_max[trackDensity[track]];
+		trackUsed[track] = false;
+	}
+
+	while (0x11 + h_index < (int)sizeof(header) && header[0x10 + h_index] && t_index < HALF_TRACK_COUNT)
+	{
+		track = header[0x10 + h_index] - 2;
+		unsigned char v = header[0x11 + h_index];
+		trackDensity[track] = (v & 0x03);
+
+		DEBUG_LOG("Converting NIB track %d (%d.%d)\r\n", track, track >> 1, track & 1 ? 5 : 0);
+
+		trackList[t_index] = track;
+		h_index += 2;
+		t_index++;
+	}
+
+	nib.diskImage = this;
+	count = t_index < (int)NIB_BATCH_TRACKS ? t_index : NIB_BATCH_TRACKS;
+	if (!source.Read(0x100, nibBatches[batch], count * NIB_TRACK_LENGTH))
+	{
+		Close();
+		return false;
+	}
+
+	for (first = 0; first < t_index; first = next, batch ^= 1)
+	{
+		nib.data = nibBatches[batch];
+		nib.track = trackList + first;
+		job = WorkQueue::Start(ExtractNIBTrack, &nib, count);
+
+		next = first + count;
+		count = t_index - next < (int)NIB_BATCH_TRACKS ? t_index - next : NIB_BATCH_TRACKS;
+		if (count && !source.Read(0x100 + next * NIB_TRACK_LENGTH, nibBatches[batch ^ 1], count * NIB_TRACK_LENGTH))
+		{
+			WorkQueue::Wait(job);
+			Close();
+			return false;
+		}
+
+		WorkQueue::Wait(job);
+
+		for (index = 0; index < next - first; ++index)
+		{
+			track = nib.track[index];
+			if (trackLengths[track])
+			{
+				tracks[track] = trackArena.Allocate(trackLengths[track]);
+				if (tracks[track] == 0)
+				{
+					DEBUG_LOG("Out of memory for track %d\r\n", track);
+					tracks[track] = emptyTrack;
+					Close();
+					return false;
+				}
+				memcpy(tracks[track], nib.data + index * NIB_TRACK_LENGTH, trackLengths[track]);
+			}
+			else
+			{
+				tracks[track] = emptyTrack;
+			}
+			trackUsed[track] = true;
+		}
+	}
+
+	DEBUG_LOG("Successfully parsed NIB data for %d tracks\n", t_index);
+	return true;
+}
+
+static u32 GCRCacheTimeStamp(const FILINFO* fileInfo)
+{
+	return fileInfo ? ((u32)fileInfo->fdate << 16) | fileInfo->ftime : 0;
+}
+
+// Entries are named after the image's file name, size and date so a mount can tell there is one before reading the image through for its hash.
+// The hash of the contents stored in the entry is what it is matched on.
+static void GCRCacheName(char* name, unsigned nameSize, const char* folder, const FILINFO* fileInfo, unsigned size)
+{
+	u32 timeStamp = GCRCacheTimeStamp(fileInfo);
+	u32 key = fileInfo ? HashBuffer(fileInfo->fname, strlen(fileInfo->fname)) : HashBuffer(0, 0);
+
+	key = HashBuffer(&size, sizeof(size), key);
+	key = HashBuffer(&timeStamp, sizeof(timeStamp), key);
+	snprintf(name, nameSize, "%s/%08x.gcr", folder, (unsigned)key);
+}
+
+bool DiskImage::GCRCacheEnabled()
+{
+	return gcrCacheFolder != 0 && gcrCacheFolder[0] != 0;
+}
+
+bool DiskImage::GCRCacheExists(unsigned size)
+{
+	FILINFO entryInfo;
+	char name[256];
+
+	if (!GCRCacheEnabled())
+		return false;
+
+	GCRCacheName(name, sizeof(name), gcrCacheFolder, fileInfo, size);
+	return f_stat(name, &entryInfo) == FR_OK;
+}
+
+// Looks for the image's finished GCR tracks in the cache folder and reads them straight into the track arena.
+// Returns false (leaving the image untouched) if there is no entry or it does not match the image exactly.
+bool DiskImage::LoadGCRCache(u32 imageHash, unsigned size)
+{
+	GCRCacheHeader header;
+	char name[256];
+	FIL fp;
+	u32 bytesRead;
+	unsigned track;
+	unsigned dataLength = 0;
+	unsigned char* data = 0;
+	bool loaded;
+
+	if (!GCRCacheEnabled())
+		return false;
 
-			gcr_track[0] = (BYTE)(track_len % 256);
-			gcr_track[1] = (BYTE)(track_len / 256);
-#if defined(EXPERIMENTALZERO)
-			memcpy(buffer, &tracks[track << 13], track_len);
-#else
-			memcpy(buffer, tracks[track], track_len);
-#endif
+	GCRCacheName(name, sizeof(name), gcrCacheFolder, fileInfo, size);
+	if (f_open(&fp, name, FA_READ) != FR_OK)
+		return false;
 
-			memcpy(gcr_track + 2, buffer, track_len);
-			bytesToWrite = G64_TRACK_MAXLEN + 2;
-			SetACTLed(true);
-			if (f_write(&fp, gcr_track, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-			{
-				SetACTLed(false);
-				DEBUG_LOG("Cannot write track data.\r\n");
-				f_close(&fp);
-				return false;
-			}
-			SetACTLed(false);
-		}
+	loaded = f_read(&fp, &header, sizeof(header), &bytesRead) == FR_OK && bytesRead == sizeof(header)
+		&& memcmp(header.signature, GCR_CACHE_SIGNATURE, sizeof(header.signature)) == 0
+		&& header.version == GCR_CACHE_VERSION
+		&& header.hash == imageHash
+		&& header.size == size
+		&& header.timeStamp == GCRCacheTimeStamp(fileInfo);
 
-		f_close(&fp);
-		DEBUG_LOG("nSuccessfully saved G64\r\n");
+	for (track = 0; track < HALF_TRACK_COUNT && loaded; ++track)
+	{
+		loaded = header.trackLengths[track] <= MAX_TRACK_LENGTH && header.trackDensity[track] < 4;
+		if (header.trackFlags[track] & GCR_CACHE_TRACK_DATA)
+			dataLength += header.trackLengths[track];
+	}
+	loaded = loaded && dataLength == header.dataLength;
 
-		return true;
+	if (loaded && dataLength)
+	{
+		data = trackArena.Allocate(dataLength);
+		loaded = data != 0 && f_read(&fp, data, dataLength, &bytesRead) == FR_OK && bytesRead == dataLength;
 	}
-	else
+	f_close(&fp);
+
+	if (!loaded)
 	{
-		DEBUG_LOG("Failed to open %s for write\r\n", fileInfo->fname);
+		DEBUG_LOG("GCR cache entry %s does not match\r\n", name);
+		ReleaseTracks();
 		return false;
 	}
+
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		trackLengths[track] = header.trackLengths[track];
+		trackDensity[track] = header.trackDensity[track];
+		trackUsed[track] = (header.trackFlags[track] & GCR_CACHE_TRACK_USED) != 0;
+		if (header.trackFlags[track] & GCR_CACHE_TRACK_DATA)
+		{
+			tracks[track] = data;
+			data += trackLengths[track];
+		}
+	}
+	attachedImageSize = header.imageSize;
+	DEBUG_LOG("Loaded %s from the GCR cache\r\n", fileInfo ? fileInfo->fname : "");
+	return true;
 }
 
-void DiskImage::CloseG64()
+// Writes the converted tracks out so the next mount of the same image can skip the conversion.
+// The cache is only an optimisation so any failure just leaves no entry behind.
+void DiskImage::SaveGCRCache(u32 imageHash, unsigned size)
 {
-	if (dirty)
+	GCRCacheHeader header;
+	char name[256];
+	FIL fp;
+	u32 bytesWritten;
+	unsigned track;
+	bool saved;
+
+	if (!GCRCacheEnabled())
+		return;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.signature, GCR_CACHE_SIGNATURE, sizeof(header.signature));
+	header.version = GCR_CACHE_VERSION;
+	header.hash = imageHash;
+	header.size = size;
+	header.timeStamp = GCRCacheTimeStamp(fileInfo);
+	header.imageSize = attachedImageSize;
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
 	{
-		WriteG64();
+		header.trackLengths[track] = trackLengths[track];
+		header.trackDensity[track] = trackDensity[track];
+		header.trackFlags[track] = trackUsed[track] ? GCR_CACHE_TRACK_USED : 0;
+		if (tracks[track] != emptyTrack)
+		{
+			header.trackFlags[track] |= GCR_CACHE_TRACK_DATA;
+			header.dataLength += trackLengths[track];
+		}
+	}
 
-		dirty = false;
+	f_mkdir(gcrCacheFolder);
+	GCRCacheName(name, sizeof(name), gcrCacheFolder, fileInfo, size);
+	if (f_open(&fp, name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+	{
+		DEBUG_LOG("Cannot create GCR cache entry %s\r\n", name);
+		return;
+	}
+
+	SetACTLed(true);
+	saved = f_write(&fp, &header, sizeof(header), &bytesWritten) == FR_OK && bytesWritten == sizeof(header);
+	for (track = 0; track < HALF_TRACK_COUNT && saved; ++track)
+	{
+		if (header.trackFlags[track] & GCR_CACHE_TRACK_DATA)
+			saved = f_write(&fp, tracks[track], trackLengths[track], &bytesWritten) == FR_OK && bytesWritten == trackLengths[track];
+	}
+	f_close(&fp);
+	SetACTLed(false);
+
+	if (!saved)
+	{
+		DEBUG_LOG("Cannot write GCR cache entry %s\r\n", name);
+		f_unlink(name);
 	}
-	attachedImageSize = 0;
 }
 
-bool DiskImage::OpenNIB(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
+// Each track in the header has its own NIB_TRACK_LENGTH slot, so a dirty track goes back into the slot it was read from.
+bool DiskImage::UpdateNIB(bool flushing)
 {
-	int track, t_index = 0, h_index = 0;
-	Close();
+	unsigned char header[NIB_HEADER_SIZE + 1];
+	unsigned track, entry, offset;
+	FIL fp;
 
-	this->fileInfo = fileInfo;
+	if (f_open(&fp, fileInfo->fname, FA_READ | FA_WRITE) != FR_OK)
+		return false;
 
-	attachedImageSize = size;
+	SetACTLed(true);
+	if (!ReadAt(&fp, 0, header, sizeof(header)) || memcmp(header, "MNIB-1541-RAW", 13) != 0)
+		return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, false);
 
-	if (memcmp(diskImage, "MNIB-1541-RAW", 13) == 0)
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
 	{
+		if (!CopyTrack(track, flushing))
+			continue;
 
-		for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
+		for (entry = 0; 0x11 + entry * 2 < sizeof(header) && header[0x10 + entry * 2]; ++entry)
 		{
-			trackLengths[track] = capacity_max[trackDensity[track]];
-			trackUsed[track] = false;
+			if (header[0x10 + entry * 2] == track + 2)
+				break;
 		}
 
-		while (diskImage[0x10 + h_index])
+		offset = 0x100 + entry * NIB_TRACK_LENGTH;
+		if (0x11 + entry * 2 >= sizeof(header) || header[0x10 + entry * 2] != track + 2
+			|| (header[0x11 + entry * 2] & 3) != trackDensity[track]
+			|| offset + NIB_TRACK_LENGTH > f_size(&fp))
 		{
-			track = diskImage[0x10 + h_index] - 2;
-			unsigned char v = diskImage[0x11 + h_index];
-			trackDensity[track] = (v & 0x03);
-
-			DEBUG_LOG("Converting NIB track %d (%d.%d)\r\n", track, track >> 1, track & 1 ? 5 : 0);
-
-			unsigned char* nibdata = diskImage + (t_index * NIB_TRACK_LENGTH) + 0x100;
-			int align;
-#if defined(EXPERIMENTALZERO)
-			trackLengths[track] = extract_GCR_track(&tracks[track << 13], nibdata, &align
-				//, ALIGN_GAP
-				, ALIGN_NONE
-				, capacity_min[trackDensity[track]],
-				capacity_max[trackDensity[track]]);
-#else
-			trackLengths[track] = extract_GCR_track(tracks[track], nibdata, &align
-				//, ALIGN_GAP
-				, ALIGN_NONE
-				, capacity_min[trackDensity[track]],
-				capacity_max[trackDensity[track]]);
-#endif
+			return FinishUpdate(&fp, track, flushing, false);
+		}
 
-			trackUsed[track] = true;
+		DEBUG_LOG("Updating NIB track %d\r\n", track);
+		if (!WriteAt(&fp, offset, flushBuffer, trackLengths[track])
+			|| !WriteAt(&fp, offset + trackLengths[track], emptyTrack, NIB_TRACK_LENGTH - trackLengths[track]))
+		{
+			return FinishUpdate(&fp, track, flushing, false);
+		}
+	}
+	return FinishUpdate(&fp, HALF_TRACK_COUNT, flushing, true);
+}
+
+void DiskImage::MakeNIBHeader(unsigned char* header)
+{
+	int track;
+	int header_entry = 0;
+
+	memset(header, 0, 0x100);
 
-			h_index += 2;
-			t_index++;
+	sprintf((char*)header, "MNIB-1541-RAW%c%c%c", 1, 0, 0);
+
+	for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
+	{
+		if (trackUsed[track])
+		{
+			header[0x10 + (header_entry * 2)] = (BYTE)track + 2;
+			header[0x10 + (header_entry * 2) + 1] = trackDensity[track];
+
+			header_entry++;
 		}
+	}
+}
 
+// Lays the whole NIB file out in memory; the header then each used track padded out to a full NIB track.
+unsigned DiskImage::BuildNIB(unsigned char* nib)
+{
+	unsigned size = 0x100;
+	unsigned track;
 
-		DEBUG_LOG("Successfully parsed NIB data for %d tracks\n", t_index);
-		diskType = NIB;
-		return true;
+	MakeNIBHeader(nib);
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		if (trackUsed[track])
+		{
+			memcpy(nib + size, tracks[track], trackLengths[track]);
+			memcpy(nib + size + trackLengths[track], emptyTrack, NIB_TRACK_LENGTH - trackLengths[track]);
+			size += NIB_TRACK_LENGTH;
+		}
 	}
-	return false;
+	return size;
 }
 
 bool DiskImage::WriteNIB()
@@ -1098,6 +2190,9 @@ bool DiskImage::WriteNIB()
 	if (readOnly)
 		return true;
 
+	if (UpdateNIB(false))
+		return true;
+
 	FIL fp;
 	FRESULT res = f_open(&fp, fileInfo->fname, FA_CREATE_ALWAYS | FA_WRITE);
 	if (res == FR_OK)
@@ -1106,25 +2201,11 @@ bool DiskImage::WriteNIB()
 		u32 bytesWritten;
 
 		int track;
-		char header[0x100];
-		int header_entry = 0;
+		unsigned char header[0x100];
 
 		DEBUG_LOG("Converting to NIB format...\n");
 
-		memset(header, 0, sizeof(header));
-
-		sprintf(header, "MNIB-1541-RAW%c%c%c", 1, 0, 0);
-
-		for (track = 0; track < (MAX_TRACKS_1541 * 2); ++track)
-		{
-			if (trackUsed[track])
-			{
-				header[0x10 + (header_entry * 2)] = (BYTE)track + 2;
-				header[0x10 + (header_entry * 2) + 1] = trackDensity[track];
-
-				header_entry++;
-			}
-		}
+		MakeNIBHeader(header);
 
 		bytesToWrite = sizeof(header);
 		SetACTLed(true);
@@ -1134,16 +2215,18 @@ bool DiskImage::WriteNIB()
 		}
 		else
 		{
-			bytesToWrite = NIB_TRACK_LENGTH;
 			for (track = 0; track < HALF_TRACK_COUNT; ++track)
 			{
 				if (trackUsed[track])
 				{
-#if defined(EXPERIMENTALZERO)
-					if (f_write(&fp, &tracks[track << 13], bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-#else
+					// Tracks only hold their own length so pad them out to a full NIB track.
+					bytesToWrite = trackLengths[track];
 					if (f_write(&fp, tracks[track], bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-#endif
+					{
+						DEBUG_LOG("Cannot write track data.\r\n");
+					}
+					bytesToWrite = NIB_TRACK_LENGTH - trackLengths[track];
+					if (f_write(&fp, emptyTrack, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
 					{
 						DEBUG_LOG("Cannot write track data.\r\n");
 					}
@@ -1154,6 +2237,8 @@ bool DiskImage::WriteNIB()
 
 		f_close(&fp);
 
+		memset(trackDirty, 0, sizeof(trackDirty));
+		memset(trackFlushed, 0, sizeof(trackFlushed));
 		DEBUG_LOG("nSuccessfully saved NIB\r\n");
 
 		return true;
@@ -1178,64 +2263,187 @@ void DiskImage::CloseNIB()
 
 bool DiskImage::OpenNBZ(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size)
 {
+	ImageSource source(diskImage, size);
+	return OpenNBZ(fileInfo, source);
+}
+
+bool DiskImage::OpenNBZ(const FILINFO* fileInfo, ImageSource& source)
+{
+	unsigned char signature[sizeof(NBZ_TRACK_INDEX_SIGNATURE)];
+	unsigned char* compressed = (unsigned char*)nibWork;
+	unsigned size = source.Size();
+
 	Close();
 
-	if ((size = LZ_Uncompress(diskImage, compressionBuffer, size)))
+	this->fileInfo = fileInfo;
+
+	if (GCRCacheEnabled())
+		source.HashAsRead();
+	if (size >= sizeof(NBZTrackIndexHeader) && source.Read(0, signature, sizeof(signature)) && memcmp(signature, NBZ_TRACK_INDEX_SIGNATURE, sizeof(signature)) == 0)
+		return OpenNBZTrackIndex(source);
+
+	// Without a track index the image has to be decompressed as a whole.
+	// It is read into the compressor's working area, which is only needed while saving an NBZ.
+	if (size > sizeof(nibWork) || !source.Read(0, compressed, size))
+		return false;
+
+	// The cache is keyed on the compressed image so a hit skips the decompression as well.
+	u32 imageHash = GCRCacheEnabled() ? source.Hash() : 0;
+	if (GCRCacheExists(size) && LoadGCRCache(imageHash, size))
+	{
+		diskType = NBZ;
+		return true;
+	}
+
+	unsigned nibSize = LZ_UncompressBounded(compressed, compressionBuffer, size, NIB_MAX_SIZE);
+	if (nibSize && memcmp(compressionBuffer, "MNIB-1541-RAW", 13) == 0)
 	{
-		if (OpenNIB(fileInfo, compressionBuffer, size))
+		ImageSource nibSource(compressionBuffer, nibSize);
+		attachedImageSize = nibSize;
+		if (ConvertNIB(nibSource))
 		{
-			diskType = NIB;
+			SaveGCRCache(imageHash, size);
+			diskType = NBZ;
 			return true;
 		}
 	}
 	return false;
 }
 
-bool DiskImage::WriteNBZ()
+// Only the compressed tracks are read. They are converted as they are prepared, like a D64's.
+bool DiskImage::OpenNBZTrackIndex(ImageSource& source)
 {
-	bool success = false;
+	NBZTrackIndexHeader header;
+	unsigned char nibHeader[0x100];
+	const unsigned dataStart = sizeof(header) + 0x100;
+	unsigned size = source.Size();
+	int track, t_index = 0, h_index = 0;
+
+	if (size < dataStart || !source.Read(0, &header, sizeof(header)) || !source.Read(sizeof(header), nibHeader, sizeof(nibHeader))
+		|| header.version != NBZ_TRACK_INDEX_VERSION || memcmp(nibHeader, "MNIB-1541-RAW", 13) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	for (track = 0; track < HALF_TRACK_COUNT; ++track)
+	{
+		trackLengths[track] = capacity_max[trackDensity[track]];
+		trackUsed[track] = false;
+	}
+
+	while (0x11 + h_index < 0x100 && nibHeader[0x10 + h_index])
+	{
+		track = nibHeader[0x10 + h_index] - 2;
+		unsigned start = t_index < HALF_TRACK_COUNT ? header.trackOffsets[t_index] : 0;
+		unsigned end = t_index < HALF_TRACK_COUNT ? header.trackOffsets[t_index + 1] : 0;
+		unsigned char* dest = 0;
+
+		if (track >= 0 && track < HALF_TRACK_COUNT && start >= dataStart && start < end && end <= size && end - start <= NIB_TRACK_LENGTH + (NIB_TRACK_LENGTH >> 8) + 1)
+			dest = trackArena.Allocate(end - start);
+		if (dest == 0 || !source.Read(start, dest, end - start))
+		{
+			DEBUG_LOG("Bad NBZ track index entry %d\r\n", t_index);
+			Close();
+			return false;
+		}
+		pendingTracks[track] = dest;
+		pendingSizes[track] = end - start;
+		trackDensity[track] = nibHeader[0x11 + h_index] & 0x03;
+		trackLengths[track] = capacity_max[trackDensity[track]];
+		trackUsed[track] = true;
+
+		h_index += 2;
+		t_index++;
+	}
+
+	attachedImageSize = 0x100 + t_index * NIB_TRACK_LENGTH;
+	diskType = NBZ;
+	nbzTrackIndex = true;
+
+	// The directory track is the first one anything will want.
+	PrepareTrack(34);
+	return true;
+}
 
+bool DiskImage::WriteNBZ()
+{
 	if (readOnly)
 		return true;
 
+	if (!SaveNBZ(fileInfo->fname, nbzTrackIndex))
+		return false;
+
+	memset(trackDirty, 0, sizeof(trackDirty));
+	memset(trackFlushed, 0, sizeof(trackFlushed));
+	return true;
+}
+
+// The NIB is built in memory and compressed straight into the file rather than being written out as a NIB first and read back.
+bool DiskImage::SaveNBZ(const char* name, bool trackIndex)
+{
+	bool success = false;
+	unsigned nibSize;
+	unsigned size;
+
+	if (IsD81() || diskType == D71)
+		return false;
+
 	SetACTLed(true);
-	if (WriteNIB())
-	{
-		FIL fp;
-		FRESULT res = f_open(&fp, fileInfo->fname, FA_READ);
-		if (res == FR_OK)
-		{
-			u32 bytesRead;
-			f_read(&fp, readBuffer, READBUFFER_SIZE, &bytesRead);
-			f_close(&fp);
-			DEBUG_LOG("Reloaded %s - %d for compression\r\n", fileInfo->fname, bytesRead);
-			bytesRead = LZ_Compress(readBuffer, compressionBuffer, bytesRead);
+	PrepareTracks();
+	nibSize = BuildNIB(readBuffer);
+	if (trackIndex)
+		size = CompressNBZTracks(readBuffer, nibSize);
+	else
+		size = LZ_CompressFast(readBuffer, compressionBuffer, nibSize, nibWork);
+	DEBUG_LOG("Compressed %s - %d to %d\r\n", name, nibSize, size);
 
-			if (bytesRead)
-			{
-				res = f_open(&fp, fileInfo->fname, FA_CREATE_ALWAYS | FA_WRITE);
-				if (res == FR_OK)
-				{
-					u32 bytesToWrite = bytesRead;
-					u32 bytesWritten;
+	FIL fp;
+	FRESULT res = f_open(&fp, name, FA_CREATE_ALWAYS | FA_WRITE);
+	if (res == FR_OK)
+	{
+		u32 bytesToWrite = size;
+		u32 bytesWritten;
 
-					if (f_write(&fp, compressionBuffer, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
-					{
-						DEBUG_LOG("Cannot write NBZ data.\r\n");
-					}
-					else
-					{
-						success = true;
-					}
-					f_close(&fp);
-				}
-			}
+		if (f_write(&fp, compressionBuffer, bytesToWrite, &bytesWritten) != FR_OK || bytesToWrite != bytesWritten)
+		{
+			DEBUG_LOG("Cannot write NBZ data.\r\n");
+		}
+		else
+		{
+			success = true;
 		}
+		f_close(&fp);
+	}
+	else
+	{
+		DEBUG_LOG("Failed to open %s for write\r\n", name);
 	}
 	SetACTLed(false);
 	return success;
 }
 
+// Lays out an NBZ with a track index in compressionBuffer.
+unsigned DiskImage::CompressNBZTracks(unsigned char* nib, unsigned nibSize)
+{
+	NBZTrackIndexHeader header;
+	unsigned trackCount = (nibSize - 0x100) / NIB_TRACK_LENGTH;
+	unsigned size = sizeof(header) + 0x100;
+	unsigned index;
+
+	memcpy(header.signature, NBZ_TRACK_INDEX_SIGNATURE, sizeof(header.signature));
+	header.version = NBZ_TRACK_INDEX_VERSION;
+	memcpy(compressionBuffer + sizeof(header), nib, 0x100);
+	for (index = 0; index <= HALF_TRACK_COUNT; ++index)
+	{
+		header.trackOffsets[index] = size;
+		if (index < trackCount)
+			size += LZ_CompressFast(nib + 0x100 + index * NIB_TRACK_LENGTH, compressionBuffer + size, NIB_TRACK_LENGTH, nibWork);
+	}
+	memcpy(compressionBuffer, &header, sizeof(header));
+	return size;
+}
+
 void DiskImage::CloseNBZ()
 {
 	if (dirty)
@@ -1461,21 +2669,22 @@ bool DiskImage::IsLSTExtention(const char* diskImageName)
 }
 
 bool DiskImage::ConvertSector(unsigned track, unsigned sector, unsigned char* data)
+{
+	int bitIndex = FindSectorData(track, sector);
+
+	return DecodeSector(tracks[track], trackLengths[track], bitIndex, data);
+}
+
+bool DiskImage::DecodeSector(const unsigned char* track, unsigned length, int bitIndex, unsigned char* data)
 {
 	unsigned char buffer[SECTOR_LENGTH_WITH_CHECKSUM];
 	unsigned char checkSum;
 	int index;
-	int bitIndex;
-
-	bitIndex = FindSectorHeader(track, sector, 0);
-	if (bitIndex < 0)
-		return false;
 
-	bitIndex = FindSync(track, bitIndex, (SECTOR_LENGTH_WITH_CHECKSUM * 2) * 8);
 	if (bitIndex < 0)
 		return false;
 
-	DecodeBlock(track, bitIndex, buffer, SECTOR_LENGTH_WITH_CHECKSUM / 4);
+	DecodeBlock(track, length, bitIndex, buffer, SECTOR_LENGTH_WITH_CHECKSUM / 4);
 
 	checkSum = buffer[257];
 	for (index = 0; index < SECTOR_LENGTH; ++index)
@@ -1492,98 +2701,49 @@ bool DiskImage::ConvertSector(unsigned track, unsigned sector, unsigned char* da
 
 void DiskImage::DecodeBlock(unsigned track, int bitIndex, unsigned char* buf, int num)
 {
-	int shift, i, j;
-	unsigned char gcr[5];
-	unsigned char byte;
-	unsigned char* offset;
-#if defined(EXPERIMENTALZERO)
-	unsigned char* end = &tracks[track << 13] + trackLengths[track];
-#else
-	unsigned char* end = tracks[track] + trackLengths[track];
-#endif
+	DecodeBlock(tracks[track], trackLengths[track], bitIndex, buf, num);
+}
 
-	shift = bitIndex & 7;
-#if defined(EXPERIMENTALZERO)
-	offset = &tracks[track << 13] + (bitIndex >> 3);
-#else
-	offset = tracks[track] + (bitIndex >> 3);
-#endif
+void DiskImage::DecodeBlock(const unsigned char* track, unsigned length, int bitIndex, unsigned char* buf, int num)
+{
+	int shift = bitIndex & 7;
+	unsigned offset = bitIndex >> 3;
+	int groups = 0;
+	unsigned char gcr[6];
+	unsigned i;
+
+	if (length == 0)
+		length = 1;	// An empty track reads back its first byte over and over
 
-	byte = offset[0] << shift;
-	for (i = 0; i < num; i++, buf += 4)
+	// The groups that end before the track wraps are decoded straight from it.
+	if (offset + 1 < length)
 	{
-		for (j = 0; j < 5; j++)
-		{
-			offset++;
-			if (offset >= end)
-#if defined(EXPERIMENTALZERO)
-				offset = &tracks[track << 13];
-#else
-				offset = tracks[track];
-#endif
-		
-			if (shift)
-			{
-				gcr[j] = byte | ((offset[0] << shift) >> 8);
-				byte = offset[0] << shift;
-			}
-			else 
-			{
-				gcr[j] = byte;
-				byte = offset[0];
-			}
-		}
-		convert_4bytes_from_GCR(gcr, buf);
+		groups = (length - offset - 1) / 5;
+		if (groups > num)
+			groups = num;
+		convert_bytes_from_GCR(track + offset, shift, buf, groups);
+		offset += groups * 5;
+		buf += groups * 4;
+	}
+
+	// Any after that are gathered a byte at a time, wrapping round to the start of the track.
+	for (; groups < num; groups++, buf += 4)
+	{
+		for (i = 0; i < 6; i++)
+			gcr[i] = track[(offset + i) % length];
+		convert_bytes_from_GCR(gcr, shift, buf, 1);
+		offset = (offset + 5) % length;
 	}
 }
 
 int DiskImage::FindSync(unsigned track, int bitIndex, int maxBits, int* syncStartIndex)
 {
-	int readShiftRegister = 0;
-#if defined(EXPERIMENTALZERO)
-	unsigned char byte = tracks[(track << 13) + (bitIndex >> 3)] << (bitIndex & 7);
-#else
-	unsigned char byte = tracks[track][bitIndex >> 3] << (bitIndex & 7);
-#endif
-	bool prevBitZero = true;
-
-	while (maxBits--)
-	{
-		if (byte & 0x80)
-		{
-			if (syncStartIndex && prevBitZero)
-				*syncStartIndex = bitIndex;
-
-			prevBitZero = false;
-			readShiftRegister = (readShiftRegister << 1) | 1;
-		}
-		else
-		{
-			prevBitZero = true;
+	return FindSync(tracks[track], trackLengths[track], bitIndex, maxBits, syncStartIndex);
+}
 
-			if (~readShiftRegister & 0x3ff)
-				readShiftRegister <<= 1;
-			else
-				return bitIndex;
-		}
-		if (~bitIndex & 7)
-		{
-			bitIndex++;
-			byte <<= 1;
-		}
-		else
-		{
-			bitIndex++;
-			if (bitIndex >= int(BitsInTrack(track)))
-				bitIndex = 0;
-#if defined(EXPERIMENTALZERO)
-			byte = tracks[(track << 13)+(bitIndex >> 3)];
-#else
-			byte = tracks[track][bitIndex >> 3];
-#endif
-		}
-	}
-	return -1;
+int DiskImage::FindSync(const unsigned char* track, unsigned length, int bitIndex, int maxBits, int* syncStartIndex)
+{
+	return find_sync_bits(track, length, bitIndex, maxBits, syncStartIndex);
 }
 
 int DiskImage::FindSectorHeader(unsigned track, unsigned sector, unsigned char* id)
@@ -1592,6 +2752,23 @@ int DiskImage::FindSectorHeader(unsigned track, unsigned sector, unsigned char*
 	int bitIndex;
 	int bitIndexPrev;
 
+	PrepareTrack(track);
+
+	if (sector < SECTOR_INDEX_SIZE)
+	{
+		if (!sectorIndexValid[track])
+			IndexSectors(track);
+
+		bitIndex = sectorHeaderIndex[track][sector];
+		if (bitIndex >= 0 && id)
+		{
+			DecodeBlock(track, bitIndex, header, 2);
+			id[0] = header[5];
+			id[1] = header[4];
+		}
+		return bitIndex;
+	}
+
 	bitIndex = 0;
 	bitIndexPrev = -1;
 	for (;;)
@@ -1616,6 +2793,59 @@ int DiskImage::FindSectorHeader(unsigned track, unsigned sector, unsigned char*
 	return -1;
 }
 
+int DiskImage::FindSectorData(unsigned track, unsigned sector)
+{
+	int bitIndex = FindSectorHeader(track, sector, 0);
+
+	if (bitIndex < 0)
+		return -1;
+	if (sector < SECTOR_INDEX_SIZE)
+		return sectorDataIndex[track][sector];
+	return FindSync(track, bitIndex, (SECTOR_LENGTH_WITH_CHECKSUM * 2) * 8);
+}
+
+void DiskImage::IndexSectors(unsigned track)
+{
+	// Marked valid first so a write from the drive while the track is being scanned leaves it to be indexed again.
+	sectorIndexValid[track] = true;
+	DataMemBarrier();
+	IndexSectors(tracks[track], trackLengths[track], sectorHeaderIndex[track], sectorDataIndex[track]);
+}
+
+// Walks the track's syncs once the same way FindSectorHeader does, noting the first header found for each sector and the data block that follows it.
+void DiskImage::IndexSectors(const unsigned char* track, unsigned length, int* headerIndex, int* dataIndex)
+{
+	unsigned char header[8];
+	unsigned sector;
+	int bitIndex;
+	int bitIndexPrev;
+
+	for (sector = 0; sector < SECTOR_INDEX_SIZE; ++sector)
+	{
+		headerIndex[sector] = -1;
+		dataIndex[sector] = -1;
+	}
+
+	bitIndex = 0;
+	bitIndexPrev = -1;
+	for (;;)
+	{
+		bitIndex = FindSync(track, length, bitIndex, NIB_TRACK_LENGTH * 8);
+		if (bitIndexPrev == bitIndex)
+			break;
+		if (bitIndexPrev < 0)
+			bitIndexPrev = bitIndex;
+		DecodeBlock(track, length, bitIndex, header, 2);
+
+		sector = header[2];
+		if (header[0] == 0x08 && sector < SECTOR_INDEX_SIZE && headerIndex[sector] < 0)
+		{
+			headerIndex[sector] = bitIndex;
+			dataIndex[sector] = FindSync(track, length, bitIndex, (SECTOR_LENGTH_WITH_CHECKSUM * 2) * 8);
+		}
+	}
+}
+
 unsigned DiskImage::GetID(unsigned track, unsigned char* id)
 {
 	if (FindSectorHeader(track, 0, id) >= 0)
@@ -20,6 +20,11 @@
 #define DISKIMAGE_H
 #include "types.h"
 #include "ff.h"
+#include "TrackArena.h"
+#include "defs.h"
+#if defined(HAS_MULTICORE)
+#include "SpinLock.h"
+#endif
 
 #define READBUFFER_SIZE 1024 * 512 * 2 // Now need over 800K for D81s
 
@@ -42,6 +47,36 @@ static const unsigned short G64_MAX_TRACK_LENGTH = 7928;
 
 static const unsigned short D81_SECTOR_LENGTH = 512;
 
+// Pass the previous result as hash to continue a hash across several buffers.
+u32 HashBuffer(const void* pBuffer, u32 length, u32 hash = 0x811c9dc5U);
+
+// Where an image is opened from; either the whole file already in memory or the open file itself.
+// A file is read a track at a time as the image is converted so it never needs staging in DiskImage::readBuffer.
+class ImageSource
+{
+public:
+	ImageSource(const unsigned char* data, unsigned size) : data(data), fp(0), size(size), hashing(false), hash(HashBuffer(0, 0)), hashed(0) {}
+	ImageSource(FIL* fp, unsigned size) : data(0), fp(fp), size(size), hashing(false), hash(HashBuffer(0, 0)), hashed(0) {}
+
+	unsigned Size() const { return size; }
+
+	// Bytes past the end of the image read as 0. Returns false if the file could not be read.
+	bool Read(unsigned offset, void* dest, unsigned length);
+	// Once asked to, a file is hashed as it is read so Hash only has to read whatever has not been read yet.
+	void HashAsRead() { hashing = true; }
+	u32 Hash();
+
+private:
+	bool ReadFile(unsigned offset, void* dest, unsigned length);
+
+	const unsigned char* data;
+	FIL* fp;
+	unsigned size;
+	bool hashing;
+	u32 hash;
+	unsigned hashed;	// How much of the start of the file hash covers.
+};
+
 class DiskImage
 {
 public:
@@ -65,11 +100,16 @@ public:
 	static unsigned CreateNewDiskInRAM(const char* filenameNew, const char* ID, unsigned char* destBuffer = 0);
 
 	bool OpenD64(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
+	bool OpenD64(const FILINFO* fileInfo, ImageSource& source);
 	bool OpenG64(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
+	bool OpenG64(const FILINFO* fileInfo, ImageSource& source);
 	bool OpenNIB(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
+	bool OpenNIB(const FILINFO* fileInfo, ImageSource& source);
 	bool OpenNBZ(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
+	bool OpenNBZ(const FILINFO* fileInfo, ImageSource& source);
 	bool OpenD71(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
 	bool OpenD81(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
+	bool OpenD81(const FILINFO* fileInfo, ImageSource& source);
 	bool OpenT64(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
 	bool OpenPRG(const FILINFO* fileInfo, unsigned char* diskImage, unsigned size);
 
@@ -77,13 +117,14 @@ public:
 
 	bool GetDecodedSector(u32 track, u32 sector, u8* buffer);
 
+	// D64 tracks are converted to GCR after mounting so mounting is quick; core0 converts them in the background while emulating.
+	// Anything reading a track directly must still prepare it first. The drive does so when its head lands on one but only converts it as a last resort.
+	void PrepareTrack(unsigned track);
+	void PrepareTracks();
+
 	inline unsigned char GetNextByte(u32 track, u32 byte)
 	{
-#if defined(EXPERIMENTALZERO)
-		return tracks[(track << 13) + byte];
-#else
 		return tracks[track][byte];
-#endif
 	}
 
 
@@ -92,11 +133,7 @@ public:
 		//if (attachedImageSize == 0)
 		//	return 0;
 
-#if defined(EXPERIMENTALZERO)
-		return ((tracks[(track << 13) + byte] >> bit) & 1) != 0;
-#else
 		return ((tracks[track][byte] >> bit) & 1) != 0;
-#endif
 	}
 
 
@@ -105,33 +142,18 @@ public:
 		if (attachedImageSize == 0)
 			return;
 
-#if defined(EXPERIMENTALZERO)
-		u8 dataOld = tracks[(track << 13) + byte];
-		u8 bitMask = 1 << bit;
-		if (value)
-		{
-			TestDirty(track, (dataOld & bitMask) == 0);
-			tracks[(track << 13) + byte] |= bitMask;
-		}
-		else
-		{
-			TestDirty(track, (dataOld & bitMask) != 0);
-			tracks[(track << 13) + byte] &= ~bitMask;
-		}
-#else
 		u8 dataOld = tracks[track][byte];
 		u8 bitMask = 1 << bit;
 		if (value)
 		{
-			TestDirty(track, (dataOld & bitMask) == 0);
-			tracks[track][byte] |= bitMask;
+			if (TestDirty(track, (dataOld & bitMask) == 0))
+				tracks[track][byte] |= bitMask;
 		}
 		else
 		{
-			TestDirty(track, (dataOld & bitMask) != 0);
-			tracks[track][byte] &= ~bitMask;
+			if (TestDirty(track, (dataOld & bitMask) != 0))
+				tracks[track][byte] &= ~bitMask;
 		}
-#endif
 	}
 
 	static const unsigned char SectorsPerTrack[42];
@@ -187,21 +209,33 @@ public:
 
 	static void CRC(unsigned short& runningCRC, unsigned char data);
 
-	union
-	{
-#if defined(EXPERIMENTALZERO)
-		unsigned char tracks[HALF_TRACK_COUNT * MAX_TRACK_LENGTH];
-#else
-		unsigned char tracks[HALF_TRACK_COUNT][MAX_TRACK_LENGTH];
-#endif
-		unsigned char tracksD81[HALF_TRACK_COUNT][2][MAX_TRACK_LENGTH];
-	};
+	// Bytes of track data held for the mounted image.
+	unsigned TrackMemoryUsed() const { return trackArena.BytesUsed() + packedArena.BytesUsed(); }
+
+	// Images that are not in the drive can be packed; their tracks are compressed and the expanded memory given back until Unpack().
+	// A packed image reads as an unformatted disk but keeps its dirty state so it is still written back when closed.
+	bool Pack();
+	bool Unpack();
+	bool IsPacked() const { return packed; }
+
+	// Returns false if there is no memory left for them.
+	bool ReserveSpareTracks();
 
 	bool WriteD64(char* name = 0);
 	bool WriteG64(char* name = 0);
 
+	// Writes the tracks the drive has changed since the last flush back into the image file without stopping the emulation.
+	// It can run on core0 while core1 is still writing to the image. D64, G64 and NIB files are flushed; other types wait for Close().
+	bool Flush();
+
 	unsigned GetHash() const { return hash; }
 
+	// Converted NIB and NBZ images are kept in this folder so they only have to be converted the first time they are mounted. 0 disables the cache.
+	static void SetGCRCacheFolder(const char* folder) { gcrCacheFolder = folder; }
+
+	// Saves a 1541 image as an NBZ, with a track index if asked (see OpenNBZTrackIndex) so it mounts without decompressing the whole NIB.
+	bool SaveNBZ(const char* name, bool trackIndex);
+
 	inline static unsigned GetSpeedZoneIndexD64(unsigned track)
 	{
 		return (track < 30) + (track < 24) + (track < 17);
@@ -220,25 +254,66 @@ private:
 
 	bool WriteNIB();
 	bool WriteNBZ();
+	bool OpenNBZTrackIndex(ImageSource& source);
+	unsigned CompressNBZTracks(unsigned char* nib, unsigned nibSize);
+	void MakeNIBHeader(unsigned char* header);
+	unsigned BuildNIB(unsigned char* nib);
+
+	// Write just the dirty tracks back into the image file where they already are.
+	// They return false if the file's layout no longer fits the tracks and the whole image has to be rewritten.
+	bool UpdateD64(bool flushing);
+	bool UpdateG64(bool flushing);
+	bool UpdateNIB(bool flushing);
+	bool CopyTrack(unsigned track, bool flushing);
+	bool FinishUpdate(FIL* fp, unsigned failedTrack, bool flushing, bool success);
 	bool WriteD71();
 	bool WriteD81();
 	bool WriteT64(char* name = 0);
 
-	inline void TestDirty(u32 track, bool isDirty)
+	// Returns true if the track is changing and has memory of its own to be written to.
+	// It runs on the emulating core so a track written to for the first time takes one of the spares rather than being allocated.
+	inline bool TestDirty(u32 track, bool isDirty)
 	{
 		if (isDirty)
 		{
+			if (tracks[track] == emptyTrack)
+			{
+				PrepareTrack(track);
+				if (tracks[track] == emptyTrack && !TakeSpareTrack(track))
+					return false;
+			}
 			trackDirty[track] = true;
 			trackUsed[track] = true;
+			++trackWrites[track];
+			sectorIndexValid[track] = false;
 			dirty = true;
 		}
+		return isDirty;
 	}
 
+	bool ConvertPendingTrack(unsigned track);
+	bool ConvertPendingD64Track(unsigned track);
+	bool ConvertPendingNIBTrack(unsigned track);
+	unsigned PendingTrackLength(unsigned track) const;
+	unsigned PendingTrackAllocation(unsigned track) const;
+
+	unsigned char* AllocateTrack(unsigned track, unsigned length);
+	bool TakeSpareTrack(unsigned track);
+	unsigned char* AllocateTrackD81(unsigned track, unsigned headIndex);
+	void ReleaseTracks();
+	void ReleasePackedTracks();
+
 	bool ConvertSector(unsigned track, unsigned sector, unsigned char* buffer);
 	void DecodeBlock(unsigned track, int bitIndex, unsigned char* buf, int num);
+	static void DecodeBlock(const unsigned char* track, unsigned length, int bitIndex, unsigned char* buf, int num);
+	static bool DecodeSector(const unsigned char* track, unsigned length, int bitIndex, unsigned char* data);
 	unsigned GetID(unsigned track, unsigned char* id);
 	int FindSectorHeader(unsigned track, unsigned sector, unsigned char* id);
+	int FindSectorData(unsigned track, unsigned sector);
+	void IndexSectors(unsigned track);
+	static void IndexSectors(const unsigned char* track, unsigned length, int* headerIndex, int* dataIndex);
 	int FindSync(unsigned track, int bitIndex, int maxBits, int* syncStartIndex = 0);
+	static int FindSync(const unsigned char* track, unsigned length, int bitIndex, int maxBits, int* syncStartIndex = 0);
 
 	void OutputD81HeaderByte(unsigned char*& dest, unsigned char byte);
 	void OutputD81DataByte(unsigned char*& src, unsigned char*& dest);
@@ -250,6 +325,14 @@ private:
 	static bool RAMD64FindFreeSector(bool searchForwards, unsigned char* ramD64, int lastTrackUsed, int lastSectorUsed, int& track, int& sector);
 	static bool RAMD64AllocateSector(unsigned char* ramD64, int track, int sector);
 	static bool WriteRAMD64(unsigned char* diskImage, unsigned size);
+
+	bool ConvertNIB(ImageSource& source);
+	static void ExtractNIBTrack(void* context, unsigned index);
+	static bool GCRCacheEnabled();
+	bool GCRCacheExists(unsigned size);
+	bool LoadGCRCache(u32 imageHash, unsigned size);
+	void SaveGCRCache(u32 imageHash, unsigned size);
+	static const char* gcrCacheFolder;
 	
 	bool readOnly;
 	bool dirty;
@@ -258,13 +341,49 @@ private:
 	const FILINFO* fileInfo;
 	unsigned hash;
 
+	// Tracks only get memory from the arena once they hold data.
+	// Until then they share an unformatted track that is never written to.
+	TrackArena trackArena;
+	unsigned char* tracks[HALF_TRACK_COUNT];
+	unsigned char* tracksD81[HALF_TRACK_COUNT][2];
+	unsigned char* trackD81SyncBits[HALF_TRACK_COUNT][2];
+	static unsigned char emptyTrack[MAX_TRACK_LENGTH];
+	static unsigned char emptySyncBits[(MAX_TRACK_LENGTH >> 3) + 1];
+
+	// Unformatted tracks (each MAX_TRACK_LENGTH) waiting to be written to. core0 fills an empty slot; the emulating core empties a full one.
+	static const unsigned SPARE_TRACK_COUNT = 2;
+	unsigned char* volatile spareTracks[SPARE_TRACK_COUNT];
+#if defined(HAS_MULTICORE)
+	// Held while core0 and the emulating core could both be allocating from the drive's image's track arena.
+	SpinLock trackLock;
+#endif
+
+	// A D64 track waiting to be converted holds its sectors followed by each sector's error code.
+	// An NBZ's holds its compressed NIB track, pendingSizes long.
+	unsigned char* pendingTracks[HALF_TRACK_COUNT];
+	unsigned short pendingSizes[HALF_TRACK_COUNT];
+	unsigned char diskID[3];
+
+	TrackArena packedArena;
+	unsigned char* packedTracks[HALF_TRACK_COUNT];
+	unsigned packedSizes[HALF_TRACK_COUNT];
+	bool packedPending[HALF_TRACK_COUNT];
+	bool packed;
+
 	unsigned short trackLengths[HALF_TRACK_COUNT];
-	union
-	{
-		unsigned char trackDensity[HALF_TRACK_COUNT];
-		unsigned char trackD81SyncBits[HALF_TRACK_COUNT][2][MAX_TRACK_LENGTH >> 3];
-	};
+	unsigned char trackDensity[HALF_TRACK_COUNT];
 	bool trackDirty[HALF_TRACK_COUNT];
+	bool trackFlushed[HALF_TRACK_COUNT];
+	volatile u32 trackWrites[HALF_TRACK_COUNT];	// Counts the writes to each track so a flush can tell that one landed while it copied the track.
+	bool flushFailed;
+	bool nbzTrackIndex;	// Written back with a track index too.
+
+	// Where each sector's header and data block syncs end, found the first time any of the track's sectors is looked up.
+	// -1 if the sector is not on the track. Writing to the track throws its index away.
+	static const unsigned SECTOR_INDEX_SIZE = 21;
+	int sectorHeaderIndex[HALF_TRACK_COUNT][SECTOR_INDEX_SIZE];
+	int sectorDataIndex[HALF_TRACK_COUNT][SECTOR_INDEX_SIZE];
+	bool sectorIndexValid[HALF_TRACK_COUNT];
 	bool trackUsed[HALF_TRACK_COUNT];
 
 	unsigned short crc;
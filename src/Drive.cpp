@@ -348,9 +348,10 @@ Drive::Drive()
 	: diskImage(0)
 	, m_pVIA(0)
 {
-	srand(0x811c9dc5U);
-#if defined(EXPERIMENTALZERO)
 	localSeed = 0x811c9dc5U;
+#if !defined(EXPERIMENTALZERO)
+	fluxEngine = false;
+	cyclesForBit = 0;
 #endif
 	Reset();
 }
@@ -371,23 +372,26 @@ void Drive::Reset()
 	readShiftRegister = 0;
 	writeShiftRegister = 0;
 	UE3Counter = 0;
-#if defined(EXPERIMENTALZERO)
 	ResetEncoderDecoder(18 * 16, 4 * 16);
+#if defined(EXPERIMENTALZERO)
 	cyclesLeftForBit = ceil(cyclesPerBit - cyclesForBit);
-#else
-	ResetEncoderDecoder(18.0f, 22.0f);
 #endif
 	newDiskImageQueuedCylesRemaining = DISK_SWAP_CYCLES_DISK_EJECTING + DISK_SWAP_CYCLES_NO_DISK + DISK_SWAP_CYCLES_DISK_INSERTING;
-	m_pVIA->InputCA1(true);	// Reset in read mode
-	m_pVIA->InputCB1(true);
-	m_pVIA->InputCA2(true);
-	m_pVIA->InputCB2(true);
+	if (m_pVIA)	// Not connected yet when called from the constructor
+	{
+		m_pVIA->InputCA1(true);	// Reset in read mode
+		m_pVIA->InputCB1(true);
+		m_pVIA->InputCA2(true);
+		m_pVIA->InputCB2(true);
+	}
 }
 
 void Drive::Insert(DiskImage* diskImage)
 {
 	Eject();
 	this->diskImage = diskImage;
+	if (diskImage)
+		diskImage->PrepareTrack(headTrackPos);
 	newDiskImageQueuedCylesRemaining = DISK_SWAP_CYCLES_DISK_EJECTING + DISK_SWAP_CYCLES_NO_DISK + DISK_SWAP_CYCLES_DISK_INSERTING;
 }
 
@@ -453,7 +457,7 @@ bool Drive::Update()
 	if (newDiskImageQueuedCylesRemaining > 0)
 	{
 		newDiskImageQueuedCylesRemaining--;
-		if (newDiskImageQueuedCylesRemaining == 0) m_pVIA->GetPortB()->SetInput(0x10, !diskImage->GetReadOnly()); // X Write protect status of D2
+		if (newDiskImageQueuedCylesRemaining == 0) m_pVIA->GetPortB()->SetInput(0x10, !diskImage || !diskImage->GetReadOnly()); // X Write protect status of D2 (not write protected if the drive was left empty)
 		else if (newDiskImageQueuedCylesRemaining > DISK_SWAP_CYCLES_NO_DISK + DISK_SWAP_CYCLES_DISK_INSERTING) m_pVIA->GetPortB()->SetInput(0x10, false); // 0 Write protected (D1 ejecting)
 		else if (newDiskImageQueuedCylesRemaining > DISK_SWAP_CYCLES_DISK_INSERTING) m_pVIA->GetPortB()->SetInput(0x10, true); // 1 Not write protected (no disk)
 		else m_pVIA->GetPortB()->SetInput(0x10, false); // 0 Write protected (D2 inserting)
@@ -494,80 +498,87 @@ bool Drive::Update()
 			}
 		}
 #else
-		for (int cycles = 0; cycles < 16; ++cycles)
+		if (fluxEngine && !writing)
 		{
-			if (!writing)
-			{
-				if (++cyclesForBit >= cyclesPerBit)
-				{
-					cyclesForBit -= cyclesPerBit;
-					// Any 1 bit coming from the disk will come in the form of a flux reversal. (Non return to zero inverted emulation.)
-					if (GetNextBit())
-					{
-						// We have a genuine flux reversal.
-						// Pin 12 of UE5D is the BIT SYNC Input. When a positive pulse is applied to pin 12, the output of UE5D(pin 13) is applied to the load line (of UE7),
-						// causing the encoder/decoder clock to terminate the current cycle early and begin a new one.
-						ResetEncoderDecoder(18.0f, 20.0f); // Start seeing random flux reversals 18us-20us from now (ie since the last real flux reversal).
-					}
-				}
-				// The video amplifiers will often oscillate with no data in, but these oscillations are high enough in frequency that they "seldom" get past the valid pulse detector.
-				// Some do and some copy protections rely on this random behaviour so we need to emultate it.
-				// For example, 720 will read a byte from the disk multiple times and check that the values read each time were infact different. It does not matter what the values are just that they are different.
-				randomFluxReversalTime -= 0.0625f;	// One 16th of a micro second.
-				if (randomFluxReversalTime <= 0) ResetEncoderDecoder(2.0f, 25.0f); // Trigger a random noise generated zero crossing and start seeing more anywhere between 2us and 25us after this one.
-			}
-			if (++UE7Counter == 0x10) // The count carry (bit 4) clocks UF4.
+			DriveLoopReadFlux();
+		}
+		else
+		{
+			for (int cycles = 0; cycles < 16; ++cycles)
 			{
-				UE7Counter = CLOCK_SEL_AB;	// A and B inputs of UE7 come from the VIA's CLOCK SEL A/B outputs (ie PB5/6) ie preload the encoder/decoder clock for the current density settings.
-				// The decoder consists of UF4 and UE5A. The ecoder has two outputs, Pin 1 of UE5A is the serial data output and pin 2 of UF4 (output B) is the serial clock output.
-				++UF4Counter &= 0xf; // Clock and clamp UF4.
-				// The UD2 read shift register is clocked by serial clock (the rising edge of encoder/decoder's UF4 B output (serial clock))
-				//	- ie on counts 2, 6, 10 and 14 (2 is the only count that outputs a 1 into readShiftRegister as the MSB bits of the count NORed together for other values are 0)
-				if ((UF4Counter & 0x3) == 2)
+				if (!writing)
 				{
-					// A bit cell is four encoder/decoder clock pulses wide, as the 2nd bit of UF4 controls the serial clock (and takes 4 cycles to loop a two bit counter).
-					// If a flux reversal (or pulse into the decoder) occurs at the beginning of a cell, that cell is a 1 else that cell is a 0.
-					// If a flux reversal occurs, UF4's counter is cleared and the timing circuit is reset to start the encoder/decoder clock at the beginning of the VIA's current density setting.
-					// Pins 6 (output C) and 7 (output D) of UF4 are low, causing the output of UE5A, the serial data line, to go high.
-					// 2 encoder/decoder clock pulses later, the serial clock(pin 2 of UF4) goes high. When the serial clock line is high, the serial data line is valid and the shift register will shift in the data.
-					// The serial clock line remains high for another clock cycle.
-					// After four encoder/decoder clocks a bit cell is now complete.
-					// At this time, pins 2 (output A) and 3 (output B) of UF4 will again be low but as the count is counting up pin 6 (output C) will now be high.
-					// The high on pin 6 (output C) of UF4 causes the serial data line (pin 1 of UE5A) to go low as this is NORed with the low on pin 7 (output D).
-					// If a flux reversal occurs at the beginning of the next cell then everything resets and again we see a 1 on the serial data line 2 encoder/decoder cycles into that cell.
-					// If no flux reversal occurs at the beginning of the next cell, the serial data line will remain low when the serial clock line goes high again (two encoder/decoder clock cycles into the new cell).
-					// If there are no flux reversals for 2 cells then we see 0 on pin 6 (output C) and 1 on pin 7 (output D) of UF4 and this causes the serial data line (pin 1 of UE5A) to remain at 0.
-					// If there are no flux reversals for 3 cells then we see 1 on pin 6 (output C) and 1 on pin 7 (output D) of UF4 and this causes the serial data line (pin 1 of UE5A) to also remain at 0, after all, UE5A is a NOR gate.
-					// After 4 cells the counter inside UF4 loops back to 0 and we again see 0 on pin 6 (output C) and 0 on pin 7 (output C), causing the output of UE5A, the serial data line, to go to a 1, regardless of a true flux reversal!
-					readShiftRegister <<= 1;
-					readShiftRegister |= (UF4Counter == 2); // Emulate UE5A and only shift in a 1 when pins 6 (output C) and 7 (output D) (bits 2 and 3 of UF4Counter are 0. ie the first count of the bit cell)
-					if (writing) SetNextBit((writeShiftRegister & 0x80));
-					writeShiftRegister <<= 1;
-					// Note: SYNC can only trigger during reading as R/!W line is one of UC2's inputs.
-					if (!writing && ((readShiftRegister & 0x3ff) == 0x3ff))	// if the last 10 bits are 1s then SYNC
+					cyclesForBit += BIT_CYCLE;
+					if (cyclesForBit >= cyclesPerBit)
 					{
-						UE3Counter = 0;	// Phase lock on to byte boundary
-						m_pVIA->GetPortB()->SetInput(0x80, false);			// PB7 active low SYNC
-					}
-					else
-					{
-						if (!writing) m_pVIA->GetPortB()->SetInput(0x80, true); // SYNC not asserted if not following the SYNC bits
-						UE3Counter++;
+						cyclesForBit -= cyclesPerBit;
+						// Any 1 bit coming from the disk will come in the form of a flux reversal. (Non return to zero inverted emulation.)
+						if (GetNextBit())
+						{
+							// We have a genuine flux reversal.
+							// Pin 12 of UE5D is the BIT SYNC Input. When a positive pulse is applied to pin 12, the output of UE5D(pin 13) is applied to the load line (of UE7),
+							// causing the encoder/decoder clock to terminate the current cycle early and begin a new one.
+							ResetEncoderDecoder(18 * 16, 2 * 16); // Start seeing random flux reversals 18us-20us from now (ie since the last real flux reversal).
+						}
 					}
+					// The video amplifiers will often oscillate with no data in, but these oscillations are high enough in frequency that they "seldom" get past the valid pulse detector.
+					// Some do and some copy protections rely on this random behaviour so we need to emultate it.
+					// For example, 720 will read a byte from the disk multiple times and check that the values read each time were infact different. It does not matter what the values are just that they are different.
+					if (--fluxReversalCyclesLeft == 0) ResetEncoderDecoder(2 * 16, 23 * 16); // Trigger a random noise generated zero crossing and start seeing more anywhere between 2us and 25us after this one.
 				}
-				// UC5B (NOR used to invert UF4's output B serial clock) output high when UF4 counts 0,1,4,5,8,9,12 and 13
-				else if (((UF4Counter & 2) == 0) && (UE3Counter == 8))	// Phase locked on to byte boundary
+				if (++UE7Counter == 0x10) // The count carry (bit 4) clocks UF4.
 				{
-					UE3Counter = 0;
-					SO = (m_pVIA->GetFCR() & m6522::FCR_CA2_OUTPUT_MODE0) != 0;	// bit 2 of the FCR indicates "Byte Ready Active" turned on or not.
-					if (writing) 
+					UE7Counter = CLOCK_SEL_AB;	// A and B inputs of UE7 come from the VIA's CLOCK SEL A/B outputs (ie PB5/6) ie preload the encoder/decoder clock for the current density settings.
+					// The decoder consists of UF4 and UE5A. The ecoder has two outputs, Pin 1 of UE5A is the serial data output and pin 2 of UF4 (output B) is the serial clock output.
+					++UF4Counter &= 0xf; // Clock and clamp UF4.
+					// The UD2 read shift register is clocked by serial clock (the rising edge of encoder/decoder's UF4 B output (serial clock))
+					//	- ie on counts 2, 6, 10 and 14 (2 is the only count that outputs a 1 into readShiftRegister as the MSB bits of the count NORed together for other values are 0)
+					if ((UF4Counter & 0x3) == 2)
 					{
-						writeShiftRegister = m_pVIA->GetPortA()->GetOutput();
+						// A bit cell is four encoder/decoder clock pulses wide, as the 2nd bit of UF4 controls the serial clock (and takes 4 cycles to loop a two bit counter).
+						// If a flux reversal (or pulse into the decoder) occurs at the beginning of a cell, that cell is a 1 else that cell is a 0.
+						// If a flux reversal occurs, UF4's counter is cleared and the timing circuit is reset to start the encoder/decoder clock at the beginning of the VIA's current density setting.
+						// Pins 6 (output C) and 7 (output D) of UF4 are low, causing the output of UE5A, the serial data line, to go high.
+						// 2 encoder/decoder clock pulses later, the serial clock(pin 2 of UF4) goes high. When the serial clock line is high, the serial data line is valid and the shift register will shift in the data.
+						// The serial clock line remains high for another clock cycle.
+						// After four encoder/decoder clocks a bit cell is now complete.
+						// At this time, pins 2 (output A) and 3 (output B) of UF4 will again be low but as the count is counting up pin 6 (output C) will now be high.
+						// The high on pin 6 (output C) of UF4 causes the serial data line (pin 1 of UE5A) to go low as this is NORed with the low on pin 7 (output D).
+						// If a flux reversal occurs at the beginning of the next cell then everything resets and again we see a 1 on the serial data line 2 encoder/decoder cycles into that cell.
+						// If no flux reversal occurs at the beginning of the next cell, the serial data line will remain low when the serial clock line goes high again (two encoder/decoder clock cycles into the new cell).
+						// If there are no flux reversals for 2 cells then we see 0 on pin 6 (output C) and 1 on pin 7 (output D) of UF4 and this causes the serial data line (pin 1 of UE5A) to remain at 0.
+						// If there are no flux reversals for 3 cells then we see 1 on pin 6 (output C) and 1 on pin 7 (output D) of UF4 and this causes the serial data line (pin 1 of UE5A) to also remain at 0, after all, UE5A is a NOR gate.
+						// After 4 cells the counter inside UF4 loops back to 0 and we again see 0 on pin 6 (output C) and 0 on pin 7 (output C), causing the output of UE5A, the serial data line, to go to a 1, regardless of a true flux reversal!
+						readShiftRegister <<= 1;
+						readShiftRegister |= (UF4Counter == 2); // Emulate UE5A and only shift in a 1 when pins 6 (output C) and 7 (output D) (bits 2 and 3 of UF4Counter are 0. ie the first count of the bit cell)
+						if (writing) SetNextBit((writeShiftRegister & 0x80));
+						writeShiftRegister <<= 1;
+						// Note: SYNC can only trigger during reading as R/!W line is one of UC2's inputs.
+						if (!writing && ((readShiftRegister & 0x3ff) == 0x3ff))	// if the last 10 bits are 1s then SYNC
+						{
+							UE3Counter = 0;	// Phase lock on to byte boundary
+							m_pVIA->GetPortB()->SetInput(0x80, false);			// PB7 active low SYNC
+						}
+						else
+						{
+							if (!writing) m_pVIA->GetPortB()->SetInput(0x80, true); // SYNC not asserted if not following the SYNC bits
+							UE3Counter++;
+						}
 					}
-					else
+					// UC5B (NOR used to invert UF4's output B serial clock) output high when UF4 counts 0,1,4,5,8,9,12 and 13
+					else if (((UF4Counter & 2) == 0) && (UE3Counter == 8))	// Phase locked on to byte boundary
 					{
-						writeShiftRegister = (u8)(readShiftRegister & 0xff);
-						m_pVIA->GetPortA()->SetInput(writeShiftRegister);
+						UE3Counter = 0;
+						SO = (m_pVIA->GetFCR() & m6522::FCR_CA2_OUTPUT_MODE0) != 0;	// bit 2 of the FCR indicates "Byte Ready Active" turned on or not.
+						if (writing) 
+						{
+							writeShiftRegister = m_pVIA->GetPortA()->GetOutput();
+						}
+						else
+						{
+							writeShiftRegister = (u8)(readShiftRegister & 0xff);
+							m_pVIA->GetPortA()->SetInput(writeShiftRegister);
+						}
 					}
 				}
 			}
@@ -864,4 +875,78 @@ void Drive::DriveLoopWrite()
 		}
 	}
 }
+#else
+// Both engines share the same state so they can be swapped at any time.
+void Drive::SetFluxEngine(bool enable)
+{
+	fluxEngine = enable;
+}
+
+// The same 16 cycles of the read path as Update's loop, but jumping from one event to the next.
+// The only things that happen on a 16Mhz cycle are a bit cell boundary (and a flux reversal if the bit is a 1), a random flux reversal or a UE7 carry clocking UF4.
+// All three are counters so the number of cycles to the next one is known and everything in between can be skipped.
+// The bit cell boundaries drift with the fractional cycles left over from each bit so they can't be precomputed per track; they are worked out as they are reached instead.
+void Drive::DriveLoopReadFlux()
+{
+	unsigned cycles = 16;
+
+	while (cycles)
+	{
+		unsigned bitCycles = 1;
+		if (cyclesForBit < cyclesPerBit)
+			bitCycles = (cyclesPerBit - cyclesForBit + BIT_CYCLE - 1) >> BIT_CYCLE_SHIFT;
+		unsigned eventCycles = 16 - UE7Counter;
+		if (bitCycles < eventCycles)
+			eventCycles = bitCycles;
+		if (fluxReversalCyclesLeft < eventCycles)
+			eventCycles = fluxReversalCyclesLeft;
+		if (cycles < eventCycles)
+			eventCycles = cycles;
+		cycles -= eventCycles;
+
+		// Nothing happens until the last of these cycles.
+		cyclesForBit += eventCycles << BIT_CYCLE_SHIFT;
+		fluxReversalCyclesLeft -= eventCycles - 1;
+		UE7Counter += eventCycles - 1;
+
+		if (eventCycles == bitCycles)
+		{
+			cyclesForBit -= cyclesPerBit;
+			if (GetNextBit())
+				ResetEncoderDecoder(18 * 16, 2 * 16); // Start seeing random flux reversals 18us-20us from now (ie since the last real flux reversal).
+		}
+		if (--fluxReversalCyclesLeft == 0)
+			ResetEncoderDecoder(2 * 16, 23 * 16); // Trigger a random noise generated zero crossing and start seeing more anywhere between 2us and 25us after this one.
+
+		if (++UE7Counter == 0x10) // The count carry (bit 4) clocks UF4.
+		{
+			UE7Counter = CLOCK_SEL_AB;
+			++UF4Counter &= 0xf;
+			if ((UF4Counter & 0x3) == 2)
+			{
+				readShiftRegister <<= 1;
+				readShiftRegister |= (UF4Counter == 2);
+				writeShiftRegister <<= 1;
+				if ((readShiftRegister & 0x3ff) == 0x3ff)	// if the last 10 bits are 1s then SYNC
+				{
+					UE3Counter = 0;	// Phase lock on to byte boundary
+					m_pVIA->GetPortB()->SetInput(0x80, false);			// PB7 active low SYNC
+				}
+				else
+				{
+					m_pVIA->GetPortB()->SetInput(0x80, true);
+					UE3Counter++;
+				}
+			}
+			// UC5B (NOR used to invert UF4's output B serial clock) output high when UF4 counts 0,1,4,5,8,9,12 and 13
+			else if (((UF4Counter & 2) == 0) && (UE3Counter == 8))	// Phase locked on to byte boundary
+			{
+				UE3Counter = 0;
+				SO = (m_pVIA->GetFCR() & m6522::FCR_CA2_OUTPUT_MODE0) != 0;	// bit 2 of the FCR indicates "Byte Ready Active" turned on or not.
+				writeShiftRegister = (u8)(readShiftRegister & 0xff);
+				m_pVIA->GetPortA()->SetInput(writeShiftRegister);
+			}
+		}
+	}
+}
 #endif
\ No newline at end of file
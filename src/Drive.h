@@ -21,7 +21,6 @@
 
 #include "m6522.h"
 #include "DiskImage.h"
-#include <stdlib.h>
 
 #if defined(EXPERIMENTALZERO)
 inline int ceil(float num) {
@@ -54,6 +53,12 @@ public:
 	void DriveLoopReadNoFluxNoCycles();
 	void DriveLoopReadNoFlux();
 	void DriveLoopReadNoCycles();
+#else
+	void DriveLoopReadFlux();
+
+	// Selects the flux event engine for the read path (see DriveLoopReadFlux).
+	void SetFluxEngine(bool enable);
+	inline bool IsFluxEngine() const { return fluxEngine; }
 #endif
 
 	void Insert(DiskImage* diskImage);
@@ -68,40 +73,55 @@ public:
 
 	inline unsigned char GetLastHeadDirection() const { return lastHeadDirection; } // For simulated head movement sounds
 private:
+	// The random flux reversals come from an LCG (rather than rand()) so the drive always replays the same way.
+	// Returns anywhere between min and min + span 16Mhz cycles.
+	inline unsigned int RandomFluxReversalCycles(unsigned int min, unsigned int span)
+	{
+		localSeed = ((localSeed * 1103515245) + 12345) & 0x7fffffff;
+		return ((span * (localSeed >> 15)) >> 16) + min;
+	}
+
 #if defined(EXPERIMENTALZERO)
-	int32_t localSeed;
 	inline void ResetEncoderDecoder(unsigned int min, unsigned int /*max*/span)
 	{
 		UE7Counter = 16 - CLOCK_SEL_AB;	// A and B inputs of UE7 come from the VIA's CLOCK SEL A/B outputs (ie PB5/6)
 		UF4Counter = 0;
-		localSeed = ((localSeed * 1103515245) + 12345) & 0x7fffffff;
-		fluxReversalCyclesLeft = (span) * (localSeed >> 11) + min;
+		fluxReversalCyclesLeft = RandomFluxReversalCycles(min, span);
 	}
 #else
-	inline float GenerateRandomFluxReversalTime(float min, float max) { return ((max - min) * ((float)rand() / RAND_MAX)) + min; } // Inputs in micro seconds
+	// The bit cell clock is in 16.16 fixed point 16Mhz cycles.
+	static const unsigned BIT_CYCLE_SHIFT = 16;
+	static const u32 BIT_CYCLE = 1 << BIT_CYCLE_SHIFT;
 
-	inline void ResetEncoderDecoder(float min, float max)
+	inline void ResetEncoderDecoder(unsigned int min, unsigned int span)	// Inputs in 16Mhz cycles
 	{
 		UE7Counter = CLOCK_SEL_AB;	// A and B inputs of UE7 come from the VIA's CLOCK SEL A/B outputs (ie PB5/6)
 		UF4Counter = 0;
-		randomFluxReversalTime = GenerateRandomFluxReversalTime(min, max);
+		fluxReversalCyclesLeft = RandomFluxReversalCycles(min, span);
 	}
 #endif
 	inline void UpdateHeadSectorPosition()
 	{
 		// Disk spins at 300rpm = 5rps so to calculate how many 16Mhz cycles one rotation takes;-
 		// 16000000 / 5 = 3200000;
+#if defined(EXPERIMENTALZERO)
 		static const float CYCLES_16Mhz_PER_ROTATION = 3200000.0f;
+#else
+		static const u64 CYCLES_16Mhz_PER_ROTATION = 3200000;
+#endif
 
 		if (diskImage)
 		{
+			diskImage->PrepareTrack(headTrackPos);
 			bitsInTrack = diskImage->BitsInTrack(headTrackPos);
 			headBitOffset %= bitsInTrack;
-			cyclesPerBit = CYCLES_16Mhz_PER_ROTATION / (float)bitsInTrack;
 #if defined(EXPERIMENTALZERO)
+			cyclesPerBit = CYCLES_16Mhz_PER_ROTATION / (float)bitsInTrack;
 			cyclesPerBitInt = cyclesPerBit;
 			cyclesPerBitErrorConstant = (unsigned int)((cyclesPerBit - ((float)cyclesPerBitInt)) * static_cast<float>(0xffffffff));
 			cyclesForBitErrorCounter = (unsigned int)(((cyclesForBit)-(int)(cyclesForBit)) * static_cast<float>(0xffffffff));
+#else
+			cyclesPerBit = (u32)((CYCLES_16Mhz_PER_ROTATION << BIT_CYCLE_SHIFT) / bitsInTrack);
 #endif
 		}
 	}
@@ -183,30 +203,33 @@ private:
 	// CB2 (output)
 	//	- R/!W
 	m6522* m_pVIA;
+	u32 localSeed;
+	unsigned int fluxReversalCyclesLeft;
 #if defined(EXPERIMENTALZERO)
 	unsigned int cyclesLeftForBit;
-	unsigned int fluxReversalCyclesLeft;
 	unsigned int UE7Counter;
 	u32 writeShiftRegister;
 	unsigned int cyclesForBitErrorCounter;
 	unsigned int cyclesPerBitErrorConstant;
 	unsigned int cyclesPerBitInt;
+	float cyclesForBit;
+	float cyclesPerBit;
 #else
 	int UE7Counter;
 	u8 writeShiftRegister;
+	bool fluxEngine;
+	u32 cyclesForBit;	// 16.16 fixed point
+	u32 cyclesPerBit;
 #endif
-	float cyclesForBit;
 	u32 readShiftRegister;
 	unsigned headTrackPos;
 	u32 headBitOffset;
-	float randomFluxReversalTime;
 	int UF4Counter;
 	int UE3Counter;
 	int CLOCK_SEL_AB;
 	bool SO;
 	unsigned char lastHeadDirection;
 	u32 bitsInTrack;
-	float cyclesPerBit;
 	bool motor;
 	bool LED;
 };
@@ -1512,6 +1512,7 @@ void FileBrowser::DisplayDiskInfo(DiskImage* diskImage, const char* filenameForI
 		{
 			int yoffset = screenMain->ScaleY(400);
 			unsigned index;
+			diskImage->PrepareTrack(track);
 			unsigned length = diskImage->TrackLength(track);
 			unsigned countSync = 0;
 
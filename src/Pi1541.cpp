@@ -18,10 +18,8 @@
 
 #include "Pi1541.h"
 #include "debug.h"
-#include "options.h"
 #include "ROMs.h"
 
-extern Options options;
 extern Pi1541 pi1541;
 extern u8 s_u8Memory[0xc000];
 extern ROMs roms;
@@ -30,66 +28,35 @@ extern ROMs roms;
 // 6502 Address bus functions.
 // Move here out of Pi1541 to increase performance.
 ///////////////////////////////////////////////////////////////////////////////////////
-// In a 1541 address decoding and chip selects are performed by a 74LS42 ONE-OF-TEN DECODER
-// 74LS42 Ouputs a low to the !CS based on the four inputs provided by address bits 10-13
-// 1800 !cs2 on pin 9
-// 1c00 !cs2 on pin 7
+// The address decoding is done once by Pi1541::MapMemory and stored in the bus page table.
 u8 read6502(u16 address)
 {
-	u8 value = 0;
-	if (address & 0x8000)
-	{
-		switch (address & 0xe000) // keep bits 15,14,13
-		{
-			case 0x8000: // 0x8000-0x9fff
-				if (options.GetRAMBOard()) {
-					value = s_u8Memory[address]; // 74LS42 outputs low on pin 1 or pin 2
-					break;
-				}
-			case 0xa000: // 0xa000-0xbfff
-			case 0xc000: // 0xc000-0xdfff
-			case 0xe000: // 0xe000-0xffff
-				value = roms.Read(address);
-				break;
-		}
-	}
-	else
-	{
-		// Address lines 15, 12, 11 and 10 are fed into a 74LS42 for decoding
-		u16 addressLines12_11_10 = (address & 0x1c00) >> 10;
-		switch (addressLines12_11_10)
-		{
-			case 0:
-			case 1:
-				value = s_u8Memory[address & 0x7ff]; // 74LS42 outputs low on pin 1 or pin 2
-				break;
-			case 6:
-				value = pi1541.VIA[0].Read(address);	// 74LS42 outputs low on pin 7
-				break;
-			case 7:
-				value = pi1541.VIA[1].Read(address);	// 74LS42 outputs low on pin 9
-				break;
-			default:
-				value = address >> 8;	// Empty address bus
-				break;
-		}
-	}
-	return value;
+	return pi1541.m6502.GetBus().Read(address);
 }
 
-// Allows a mode where we have RAM at all addresses other than the ROM and the VIAs. (Maybe useful to someone?)
-u8 read6502ExtraRAM(u16 address)
+void write6502(u16 address, const u8 value)
 {
-	if (address & 0x8000)
-	{
-		return roms.Read(address);
-	}
-	else
-	{
-		u16 addressLines11And12 = address & 0x1800;
-		if (addressLines11And12 == 0x1800) return pi1541.VIA[(address & 0x400) != 0].Read(address);	// address line 10 indicates what VIA to index
-		return s_u8Memory[address & 0x7fff];
-	}
+	pi1541.m6502.GetBus().Write(address, value);
+}
+
+static u8 ReadVIA0(u16 address)
+{
+	return pi1541.VIA[0].Read(address);
+}
+
+static void WriteVIA0(u16 address, const u8 value)
+{
+	pi1541.VIA[0].Write(address, value);
+}
+
+static u8 ReadVIA1(u16 address)
+{
+	return pi1541.VIA[1].Read(address);
+}
+
+static void WriteVIA1(u16 address, const u8 value)
+{
+	pi1541.VIA[1].Write(address, value);
 }
 
 // Use for debugging (Reads VIA registers without the regular VIA read side effects)
@@ -113,53 +80,67 @@ u8 peek6502(u16 address)
 	return value;
 }
 
-void write6502(u16 address, const u8 value)
+// In a 1541 address decoding and chip selects are performed by a 74LS42 ONE-OF-TEN DECODER
+// 74LS42 Ouputs a low to the !CS based on the four inputs provided by address bits 10-13
+// 1800 !cs2 on pin 9
+// 1c00 !cs2 on pin 7
+// extraRAM allows a mode where we have RAM at all addresses other than the ROM and the VIAs. (Maybe useful to someone?)
+// RAMBoard emulates the 8k drive RAM expansion at 0x8000.
+void Pi1541::MapMemory(bool extraRAM, bool RAMBoard)
 {
-	if (address & 0x8000)
+	BusPageTable& bus = m6502.GetBus();
+	unsigned page;
+
+	bus.Clear();
+
+	// Address line 15 selects the ROM
+	bus.MapRead(0x80, 0x80, roms.ROMImages[roms.currentROMIndex], 0x3fff);
+	if (RAMBoard && !extraRAM)
+		bus.MapRAM(0x80, 0x20, s_u8Memory, 0xffff);	// 0x8000-0x9fff
+
+	for (page = 0; page < 0x80; ++page)
 	{
-		switch (address & 0xe000) // keep bits 15,14,13
+		if (extraRAM)
 		{
-			case 0x8000: // 0x8000-0x9fff
-				if (options.GetRAMBOard()) {
-					s_u8Memory[address] = value; // 74LS42 outputs low on pin 1 or pin 2
-					break;
-				}
-			case 0xa000: // 0xa000-0xbfff
-			case 0xc000: // 0xc000-0xdfff
-			case 0xe000: // 0xe000-0xffff
-				return;
+			u16 addressLines11And12 = (page << 8) & 0x1800;
+			if (addressLines11And12 == 0x1800)
+			{
+				// address line 10 indicates what VIA to index
+				if (page & 0x04)
+					bus.MapDevice(page, 1, ReadVIA1, WriteVIA1);
+				else
+					bus.MapDevice(page, 1, ReadVIA0, WriteVIA0);
+			}
+			else
+			{
+				bus.MapRead(page, 1, s_u8Memory, 0x7fff);
+				if (addressLines11And12 == 0)
+					bus.MapWrite(page, 1, s_u8Memory, 0x7fff);
+			}
 		}
-	}
-	else
-	{
-		// Address lines 15, 12, 11 and 10 are fed into a 74LS42 for decoding
-		u16 addressLines12_11_10 = (address & 0x1c00) >> 10;
-		switch (addressLines12_11_10)
+		else
 		{
-			case 0:
-			case 1:
-				s_u8Memory[address & 0x7ff] = value; // 74LS42 outputs low on pin 1 or pin 2
-				break;
-			case 6:
-				pi1541.VIA[0].Write(address, value);	// 74LS42 outputs low on pin 7
-				break;
-			case 7:
-				pi1541.VIA[1].Write(address, value);	// 74LS42 outputs low on pin 9
-				break;
-			default:
-				break;
+			// Address lines 15, 12, 11 and 10 are fed into a 74LS42 for decoding
+			u16 addressLines12_11_10 = ((page << 8) & 0x1c00) >> 10;
+			switch (addressLines12_11_10)
+			{
+				case 0:
+				case 1:
+					bus.MapRAM(page, 1, s_u8Memory, 0x7ff); // 74LS42 outputs low on pin 1 or pin 2
+					break;
+				case 6:
+					bus.MapDevice(page, 1, ReadVIA0, WriteVIA0);	// 74LS42 outputs low on pin 7
+					break;
+				case 7:
+					bus.MapDevice(page, 1, ReadVIA1, WriteVIA1);	// 74LS42 outputs low on pin 9
+					break;
+				default:
+					break;	// Empty address bus
+			}
 		}
 	}
 }
 
-void write6502ExtraRAM(u16 address, const u8 value)
-{
-	if (address & 0x8000) return; // address line 15 selects the ROM
-	u16 addressLines11And12 = address & 0x1800;
-	if (addressLines11And12 == 0) s_u8Memory[address & 0x7fff] = value;
-	else if (addressLines11And12 == 0x1800) pi1541.VIA[(address & 0x400) != 0].Write(address, value);	// address line 10 indicates what VIA to index
-}
-
 Pi1541::Pi1541()
 {
 	VIA[0].ConnectIRQ(&m6502.IRQ);
@@ -172,14 +153,6 @@ void Pi1541::Initialise()
 	VIA[1].ConnectIRQ(&m6502.IRQ);
 }
 
-//void Pi1541::ConfigureOfExtraRAM(bool extraRAM)
-//{
-//	if (extraRAM)
-//		m6502.SetBusFunctions(this, Read6502ExtraRAM, Write6502ExtraRAM);
-//	else
-//		m6502.SetBusFunctions(this, Read6502, Write6502);
-//}
-
 void Pi1541::Update()
 {
 	if (drive.Update())
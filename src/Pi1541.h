@@ -21,7 +21,9 @@
 
 #include "Drive.h"
 #include "m6502.h"
+#include "m6502switch.h"
 #include "iec_bus.h"
+#include "BusPageTable.h"
 
 class Pi1541
 {
@@ -35,12 +37,18 @@ public:
 
 	void Reset();
 
-	//void ConfigureOfExtraRAM(bool extraRAM);
+	// Build the CPU's bus page table from the memory configuration and the currently selected ROM.
+	void MapMemory(bool extraRAM, bool RAMBoard);
 
 	Drive drive;
 	m6522 VIA[2];
 
-	M6502 m6502;
+	// The CPU is specialised on the page table so the bus decode inlines into each cycle.
+#if defined(M6502_SWITCH_DISPATCH)
+	M6502Switch<BusPageTable> m6502;
+#else
+	M6502Core<BusPageTable> m6502;
+#endif
 
 	enum PortPins
 	{
@@ -95,28 +95,7 @@ u8 read6502_1581(u16 address)
 {
 	u8 value = 0;
 #if defined(PI1581SUPPORT)
-	if (address & 0x8000)
-	{
-		value = roms.Read1581(address);
-	}
-	else if (address >= 0x6000)
-	{
-		value = pi1581.wd177x.Read(address);
-		//DEBUG_LOG("177x r %04x %02x %04x\r\n", address, value, pc);
-	}
-	else if (address >= 0x4000)
-	{
-		value = pi1581.CIA.Read(address);
-		//DEBUG_LOG("CIA r %04x %02x %04x\r\n", address, value, pc);
-	}
-	else if (address < 0x2000)
-	{
-		value = s_u8Memory[address & 0x1fff];
-	}
-	else
-	{
-		value = address >> 8;	// Empty address bus
-	}
+	value = pi1581.m6502.GetBus().Read(address);
 #endif
 	return value;
 }
@@ -131,24 +110,48 @@ u8 peek6502_1581(u16 address)
 void write6502_1581(u16 address, const u8 value)
 {
 #if defined(PI1581SUPPORT)
-	if (address & 0x8000)
-	{
-		return;
-	}
-	else if (address >= 0x6000)
-	{
-		//DEBUG_LOG("177x w %04x %02x %04x\r\n", address, value, pc);
-		pi1581.wd177x.Write(address, value);
-	}
-	else if (address >= 0x4000)
-	{
-		//DEBUG_LOG("CIA w %04x %02x %04x\r\n", address, value, pc);
-		pi1581.CIA.Write(address, value);
-	}
-	else if (address < 0x2000)
-	{
-		s_u8Memory[address & 0x1fff] = value;
-	}
+	pi1581.m6502.GetBus().Write(address, value);
+#endif
+}
+
+#if defined(PI1581SUPPORT)
+static u8 ReadWD177x(u16 address)
+{
+	u8 value = pi1581.wd177x.Read(address);
+	//DEBUG_LOG("177x r %04x %02x %04x\r\n", address, value, pc);
+	return value;
+}
+
+static void WriteWD177x(u16 address, const u8 value)
+{
+	//DEBUG_LOG("177x w %04x %02x %04x\r\n", address, value, pc);
+	pi1581.wd177x.Write(address, value);
+}
+
+static u8 ReadCIA(u16 address)
+{
+	u8 value = pi1581.CIA.Read(address);
+	//DEBUG_LOG("CIA r %04x %02x %04x\r\n", address, value, pc);
+	return value;
+}
+
+static void WriteCIA(u16 address, const u8 value)
+{
+	//DEBUG_LOG("CIA w %04x %02x %04x\r\n", address, value, pc);
+	pi1581.CIA.Write(address, value);
+}
+#endif
+
+void Pi1581::MapMemory()
+{
+#if defined(PI1581SUPPORT)
+	BusPageTable& bus = m6502.GetBus();
+
+	bus.Clear();	// 0x2000-0x3fff is an empty address bus
+	bus.MapRAM(0x00, 0x20, s_u8Memory, 0x1fff);
+	bus.MapDevice(0x40, 0x20, ReadCIA, WriteCIA);
+	bus.MapDevice(0x60, 0x20, ReadWD177x, WriteWD177x);
+	bus.MapRead(0x80, 0x80, roms.ROMImage1581, 0x7fff);
 #endif
 }
 
@@ -21,9 +21,11 @@
 
 #include "Drive.h"
 #include "m6502.h"
+#include "m6502switch.h"
 #include "iec_bus.h"
 #include "wd177x.h"
 #include "m8520.h"
+#include "BusPageTable.h"
 
 class Pi1581
 {
@@ -37,6 +39,9 @@ public:
 
 	void Reset();
 
+	// Build the CPU's bus page table from the 1581's memory map.
+	void MapMemory();
+
 	void SetDeviceID(u8 id);
 
 	void Insert(DiskImage* diskImage);
@@ -50,7 +55,12 @@ public:
 	WD177x wd177x;
 	m8520 CIA;
 
-	M6502 m6502;
+	// The CPU is specialised on the page table so the bus decode inlines into each cycle.
+#if defined(M6502_SWITCH_DISPATCH)
+	M6502Switch<BusPageTable> m6502;
+#else
+	M6502Core<BusPageTable> m6502;
+#endif
 
 	unsigned fastSerialDirection;
 	unsigned int RDYDelayCount;
@@ -36,6 +36,11 @@ void SpinLock::Acquire(void)
 #ifdef HAS_MULTICORE
 	if (s_bEnabled)
 	{
+#if defined(HOST_BUILD)
+		while (__sync_lock_test_and_set(&m_bLocked, 1))
+		{
+		}
+#else
 		// See: ARMv7-A Architecture Reference Manual, Section D7.3
 		asm volatile
 			(
@@ -51,6 +56,7 @@ void SpinLock::Acquire(void)
 
 			: : "r" ((u32)&m_bLocked)
 			);
+#endif
 	}
 #endif
 }
@@ -60,6 +66,9 @@ void SpinLock::Release(void)
 #ifdef HAS_MULTICORE
 	if (s_bEnabled)
 	{
+#if defined(HOST_BUILD)
+		__sync_lock_release(&m_bLocked);
+#else
 		// See: ARMv7-A Architecture Reference Manual, Section D7.3
 		asm volatile
 			(
@@ -72,6 +81,7 @@ void SpinLock::Release(void)
 
 			: : "r" ((u32)&m_bLocked)
 			);
+#endif
 	}
 #endif
 }
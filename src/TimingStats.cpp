@@ -0,0 +1,89 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "TimingStats.h"
+#include <stdio.h>
+#include <string.h>
+#include "rpiHardware.h"
+
+TimingStats::TimingStats()
+	: sequence(0)
+{
+	Reset(1000);
+}
+
+void TimingStats::Reset(u32 clocksPerCycle)
+{
+	u8 bucketShift = 0;
+
+	// Make each bucket about 1/8 of a cycle (rounded down to a power of 2 so we don't need to divide) so the histogram spans 1-2us.
+	while ((2u << bucketShift) <= clocksPerCycle / 8)
+		bucketShift++;
+
+	memset(&stats, 0, sizeof(stats));
+	stats.bucketShift = bucketShift;
+	stats.clocksPerCycle = clocksPerCycle;
+	overrunStreak = 0;
+	publishCountdown = TIMING_STATS_PUBLISH_CYCLES;
+	Publish();
+}
+
+void TimingStats::Publish()
+{
+	publishCountdown = TIMING_STATS_PUBLISH_CYCLES;
+
+	// An odd sequence tells the reader an update is in progress.
+	sequence = sequence + 1;
+	DataMemBarrier();
+	published = stats;
+	DataMemBarrier();
+	sequence = sequence + 1;
+}
+
+bool TimingStats::Read(TimingStatsSnapshot& snapshot) const
+{
+	for (int attempt = 0; attempt < 4; ++attempt)
+	{
+		u32 before = sequence;
+		if (before & 1)
+			continue;
+		DataMemBarrier();
+		snapshot = published;
+		DataMemBarrier();
+		if (sequence == before)
+			return true;
+	}
+	return false;
+}
+
+void TimingStats::Dump(const char* name, const TimingStatsSnapshot& snapshot)
+{
+	unsigned bucketNS = snapshot.clocksPerCycle ? ((1 << snapshot.bucketShift) * 1000) / snapshot.clocksPerCycle : 0;
+
+	printf("%s %u cycles, %u overruns, longest streak %u", name, snapshot.cycles, snapshot.overruns, snapshot.longestOverrunStreak);
+	if (snapshot.overruns)
+		printf(", worst %u clocks at PC=$%04X", snapshot.worstClocks, snapshot.worstPC);
+	printf("\r\n");
+
+	for (int bucket = 0; bucket < TIMING_STATS_BUCKETS; ++bucket)
+	{
+		if (snapshot.histogram[bucket])
+			printf(" %s%4uns %u\r\n", bucket == TIMING_STATS_BUCKETS - 1 ? ">=" : "< ", bucketNS * (bucket + (bucket == TIMING_STATS_BUCKETS - 1 ? 0 : 1)), snapshot.histogram[bucket]);
+	}
+}
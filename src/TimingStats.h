@@ -0,0 +1,96 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#ifndef TIMINGSTATS_H
+#define TIMINGSTATS_H
+
+#include "types.h"
+
+#define TIMING_STATS_BUCKETS 16
+// Publish roughly 50 times a second
+#define TIMING_STATS_PUBLISH_CYCLES 20000
+
+// How long each emulated cycle took to execute, in ARM clock cycles.
+struct TimingStatsSnapshot
+{
+	u32 histogram[TIMING_STATS_BUCKETS];	// Each bucket is (1 << bucketShift) ARM clocks wide. The last bucket also counts everything longer.
+	u32 cycles;
+	u32 overruns;			// Cycles that took longer than 1us. Cycle accuracy is lost when this happens.
+	u32 longestOverrunStreak;
+	u32 worstClocks;		// The longest overrun and the PC that was executing when it occurred.
+	u16 worstPC;
+	u8 bucketShift;
+	u32 clocksPerCycle;
+};
+
+// Collects per cycle timing on the emulating core and publishes it for core0 to display.
+// A sequence count is used rather than a lock so the emulating core never has to wait for core0.
+class TimingStats
+{
+public:
+	TimingStats();
+
+	void Reset(u32 clocksPerCycle);
+
+	inline void Cycle(u32 clocks, u16 pc)
+	{
+		u32 bucket = clocks >> stats.bucketShift;
+		if (bucket >= TIMING_STATS_BUCKETS)
+			bucket = TIMING_STATS_BUCKETS - 1;
+		stats.histogram[bucket]++;
+		stats.cycles++;
+
+		if (clocks > stats.clocksPerCycle)
+		{
+			stats.overruns++;
+			if (++overrunStreak > stats.longestOverrunStreak)
+				stats.longestOverrunStreak = overrunStreak;
+			if (clocks > stats.worstClocks)
+			{
+				stats.worstClocks = clocks;
+				stats.worstPC = pc;
+			}
+		}
+		else
+		{
+			overrunStreak = 0;
+		}
+
+		if (--publishCountdown == 0)
+			Publish();
+	}
+
+	void Publish();
+
+	// Called from the other core. Returns false if a consistent copy could not be taken (ie we raced with Publish).
+	bool Read(TimingStatsSnapshot& snapshot) const;
+
+	// Print the statistics on the UART.
+	static void Dump(const char* name, const TimingStatsSnapshot& snapshot);
+
+private:
+	TimingStatsSnapshot stats;
+	u32 overrunStreak;
+	u32 publishCountdown;
+
+	TimingStatsSnapshot published;
+	volatile u32 sequence;
+};
+
+#endif
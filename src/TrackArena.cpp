@@ -0,0 +1,100 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#include "TrackArena.h"
+#include "defs.h"
+#if defined(HAS_MULTICORE)
+#include "SpinLock.h"
+
+// The heap is not thread safe and core0 packs and prefetches caddy images while the emulating core grows its own image's tracks.
+static SpinLock heapLock;
+#endif
+
+static inline unsigned char* BlockData(void* block, unsigned offset)
+{
+	return (unsigned char*)block + offset;
+}
+
+unsigned char* TrackArena::Allocate(unsigned size)
+{
+	const unsigned headerSize = (sizeof(Block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+
+	size = AlignedSize(size);
+
+	Block* block = blocks;
+	if (block == 0 || block->size - block->used < size)
+	{
+		unsigned newBlockSize = headerSize + size;
+		if (newBlockSize < blockSize)
+			newBlockSize = blockSize;
+
+#if defined(HAS_MULTICORE)
+		heapLock.Acquire();
+#endif
+		block = (Block*)new unsigned char[newBlockSize];
+#if defined(HAS_MULTICORE)
+		heapLock.Release();
+#endif
+		if (block == 0)
+			return 0;
+		block->next = blocks;
+		block->size = newBlockSize;
+		block->used = headerSize;
+		block->lastAllocation = headerSize;
+		blocks = block;
+	}
+
+	unsigned char* data = BlockData(block, block->used);
+	block->lastAllocation = block->used;
+	block->used += size;
+	bytesUsed += size;
+	return data;
+}
+
+void TrackArena::Shrink(unsigned char* data, unsigned size)
+{
+	Block* block = blocks;
+	if (block == 0 || data != BlockData(block, block->lastAllocation))
+		return;
+
+	size = AlignedSize(size);
+
+	unsigned end = block->lastAllocation + size;
+	if (end < block->used)
+	{
+		bytesUsed -= block->used - end;
+		block->used = end;
+	}
+}
+
+void TrackArena::Release()
+{
+	while (blocks)
+	{
+		Block* next = blocks->next;
+#if defined(HAS_MULTICORE)
+		heapLock.Acquire();
+#endif
+		delete[] (unsigned char*)blocks;
+#if defined(HAS_MULTICORE)
+		heapLock.Release();
+#endif
+		blocks = next;
+	}
+	bytesUsed = 0;
+}
@@ -0,0 +1,60 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef TRACKARENA_H
+#define TRACKARENA_H
+
+#include "types.h"
+
+// Hands out track buffers for a DiskImage from a chain of large blocks.
+// A mounted image only costs the memory its tracks use and everything is given back at once when the image is closed.
+class TrackArena
+{
+public:
+	TrackArena(unsigned blockSize = BLOCK_SIZE) : blocks(0), blockSize(blockSize), bytesUsed(0) {}
+	~TrackArena() { Release(); }
+
+	// Returns 0 if the memory has run out.
+	unsigned char* Allocate(unsigned size);
+	// Gives back the unused end of the most recent allocation (eg once a track's real length is known).
+	void Shrink(unsigned char* data, unsigned size);
+	void Release();
+
+	unsigned BytesUsed() const { return bytesUsed; }
+
+	// The space an allocation of size really takes, so tracks laid out in one allocation are aligned like separate ones.
+	static unsigned AlignedSize(unsigned size) { return (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+private:
+	struct Block
+	{
+		Block* next;
+		unsigned size;
+		unsigned used;
+		unsigned lastAllocation;
+	};
+
+	static const unsigned BLOCK_SIZE = 0x10000;
+	static const unsigned ALIGNMENT = 16;
+
+	Block* blocks;
+	unsigned blockSize;
+	unsigned bytesUsed;
+};
+
+#endif
@@ -0,0 +1,156 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#include "WorkQueue.h"
+#include "defs.h"
+#if defined(HAS_MULTICORE)
+#include "SpinLock.h"
+extern "C"
+{
+#include "rpiHardware.h"
+}
+
+// The job currently on offer. Each Run gets a new generation so a worker that is late to the previous job can never claim an item of the next.
+static SpinLock queueLock;
+static WorkQueue::WorkFunction jobFunction;
+static void* jobContext;
+static unsigned jobCount;
+static unsigned jobNext;
+static volatile unsigned jobFinished;
+static volatile unsigned jobGeneration;
+static bool jobBusy;
+static volatile unsigned workerCount;
+
+static inline void WaitForEvent()
+{
+#if !defined(HOST_BUILD)
+	asm volatile ("wfe");
+#endif
+}
+#endif
+
+void WorkQueue::Run(WorkFunction function, void* context, unsigned count)
+{
+	Wait(Start(function, context, count));
+}
+
+// Returns the job's generation, or 0 if the items have already been run.
+unsigned WorkQueue::Start(WorkFunction function, void* context, unsigned count)
+{
+	unsigned index;
+
+#if defined(HAS_MULTICORE)
+	unsigned generation = 0;
+
+	queueLock.Acquire();
+	if (workerCount != 0 && !jobBusy && count != 0)
+	{
+		jobBusy = true;
+		jobFunction = function;
+		jobContext = context;
+		jobCount = count;
+		jobNext = 0;
+		jobFinished = 0;
+		generation = ++jobGeneration;
+		if (generation == 0)
+			generation = ++jobGeneration;
+	}
+	queueLock.Release();	// Releasing the lock signals an event, waking the workers.
+
+	if (generation)
+		return generation;
+#endif
+
+	for (index = 0; index < count; ++index)
+		function(context, index);
+	return 0;
+}
+
+void WorkQueue::Wait(unsigned job)
+{
+#if defined(HAS_MULTICORE)
+	unsigned index;
+
+	if (job == 0)
+		return;
+
+	while (Claim(job, index))
+	{
+		jobFunction(jobContext, index);
+		Finish();
+	}
+	while (jobFinished != jobCount)
+	{
+	}
+	DataMemBarrier();
+
+	queueLock.Acquire();
+	jobBusy = false;
+	queueLock.Release();
+#endif
+}
+
+#if defined(HAS_MULTICORE)
+bool WorkQueue::Claim(unsigned generation, unsigned& index)
+{
+	queueLock.Acquire();
+	bool claimed = generation == jobGeneration && jobNext < jobCount;
+	if (claimed)
+		index = jobNext++;
+	queueLock.Release();
+	return claimed;
+}
+
+void WorkQueue::Finish()
+{
+	queueLock.Acquire();
+	jobFinished = jobFinished + 1;
+	queueLock.Release();
+}
+
+void WorkQueue::RunWorker()
+{
+	unsigned seen;
+	WorkFunction function;
+	void* context;
+	unsigned index;
+
+	queueLock.Acquire();
+	seen = jobGeneration;
+	workerCount = workerCount + 1;
+	queueLock.Release();
+
+	while (true)
+	{
+		while (jobGeneration == seen)
+			WaitForEvent();
+
+		queueLock.Acquire();
+		seen = jobGeneration;
+		function = jobFunction;
+		context = jobContext;
+		queueLock.Release();
+
+		while (Claim(seen, index))
+		{
+			function(context, index);
+			Finish();
+		}
+	}
+}
+#endif
@@ -0,0 +1,48 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include "types.h"
+
+// Shares independent pieces of work (eg extracting each of an image's tracks) with the cores that would otherwise sit idle.
+// The core calling Run works through the items alongside them and Run only returns once every item is done.
+// With no worker cores (single core builds and the host) or while another core is using the queue the items are run in order instead.
+class WorkQueue
+{
+public:
+	typedef void (*WorkFunction)(void* context, unsigned index);
+
+	static void Run(WorkFunction function, void* context, unsigned count);
+
+	// Hands the items to the worker cores and returns straight away so the caller can get on with something else (eg reading the next items).
+	// What it returns must be passed to Wait, which helps with any items still left. Nothing else may be started in between.
+	// If no worker core can take them the items are run before Start returns.
+	static unsigned Start(WorkFunction function, void* context, unsigned count);
+	static void Wait(unsigned job);
+
+	// Each worker core calls this once it has started. It never returns.
+	static void RunWorker();
+
+private:
+	static bool Claim(unsigned generation, unsigned& index);
+	static void Finish();
+};
+
+#endif
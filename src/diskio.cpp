@@ -145,9 +145,10 @@ DRESULT disk_read (
 	//DEBUG_LOG("r pdrv = %d\r\n", pdrv);
 	if (pdrv == 0)
 	{
+		// One command per sector. CEMMCDevice only waits for read ready once per command so it cannot do multiple block reads yet.
 		for (UINT s = 0; s < count; ++s)
 		{
-			if (sd_read(buff, SD_BLOCK_SIZE, sector + s) < SD_BLOCK_SIZE)
+			if (sd_read(buff, SD_BLOCK_SIZE, sector + s) != SD_BLOCK_SIZE)
 			{
 				return RES_ERROR;
 			}
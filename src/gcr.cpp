@@ -80,6 +80,31 @@ static BYTE GCR_decode_low[32] = {
 };
 
 
+/* Returns the first 0xff byte from ptr on, or end. Once aligned it checks a word at a time. */
+static BYTE *
+find_ff_byte(BYTE * ptr, BYTE * end)
+{
+	unsigned int word;
+
+	for (; ptr < end && ((size_t) ptr & 3); ptr++)
+	{
+		if (*ptr == 0xff)
+			return ptr;
+	}
+
+	/* A byte of ~word is zero, so a byte of the GCR is 0xff, if it borrows when 1 is taken from it */
+	for (; ptr + 4 <= end; ptr += 4)
+	{
+		word = ~*(unsigned int *) ptr;
+		if ((word - 0x01010101) & ~word & 0x80808080)
+			break;
+	}
+
+	while (ptr < end && *ptr != 0xff)
+		ptr++;
+	return ptr;
+}
+
 int
 find_sync(BYTE ** gcr_pptr, BYTE * gcr_end)
 {
@@ -95,7 +120,8 @@ find_sync(BYTE ** gcr_pptr, BYTE * gcr_end)
 		if ( ((*gcr_pptr)[0] & 0x03) == 0x03 && (*gcr_pptr)[1] == 0xff)
 			break;
 
-		(*gcr_pptr)++;
+		/* only the byte before an 0xff can start one */
+		*gcr_pptr = find_ff_byte((*gcr_pptr) + 2, gcr_end) - 1;
 	}
 
 	(*gcr_pptr)++;
@@ -104,69 +130,171 @@ find_sync(BYTE ** gcr_pptr, BYTE * gcr_end)
 	return (*gcr_pptr < gcr_end);
 }
 
+int
+find_sync_bits(const BYTE * track, size_t length, int bitIndex, int maxBits, int * syncStartIndex)
+{
+	size_t bits, byteIndex;
+	unsigned int window, valid, zeros, syncs;
+	unsigned long long stream, ones2, ones10;
+	int windowStart, lastZero, i;
+
+	if (length == 0)
+		length = 1;	/* an empty track reads back its first byte over and over */
+	bits = length << 3;
+
+	byteIndex = bitIndex >> 3;
+	windowStart = -(bitIndex & 7);	/* offset from bitIndex of the window's first bit */
+	lastZero = -1;					/* offset of the last 0 bit looked at */
+	stream = 0;
+
+	while (windowStart < maxBits)
+	{
+		window = 0;
+		for (i = 0; i < 4; i++)
+		{
+			window = (window << 8) | track[byteIndex];
+			if (++byteIndex >= length)
+				byteIndex = 0;
+		}
+
+		/* bits before bitIndex read as 0 and, like any past maxBits, can not end a SYNC */
+		valid = 0xffffffff;
+		if (windowStart < 0)
+		{
+			valid >>= -windowStart;
+			window &= valid;
+		}
+		if (maxBits - windowStart < 32)
+			valid &= ~(0xffffffff >> (maxBits - windowStart));
+
+		/* a bit of ones10 is set when it and the 9 bits before it are all 1 */
+		stream = (stream << 32) | window;
+		ones2 = stream & (stream >> 1);
+		ones10 = ones2 & (ones2 >> 2);
+		ones10 &= ones10 >> 4;
+		ones10 &= ones2 >> 8;
+
+		zeros = ~window & valid;
+		syncs = zeros & (unsigned int) (ones10 >> 1);
+		if (syncs)
+		{
+			i = __builtin_clz(syncs);
+			if (syncStartIndex)
+			{
+				zeros &= i ? 0xffffffff << (32 - i) : 0;
+				if (zeros)
+					lastZero = windowStart + 31 - __builtin_ctz(zeros);
+				*syncStartIndex = (bitIndex + lastZero + 1) % bits;
+			}
+			return (bitIndex + windowStart + i) % bits;
+		}
+
+		if (zeros)
+			lastZero = windowStart + 31 - __builtin_ctz(zeros);
+		windowStart += 32;
+	}
+	return -1;
+}
+
+/* Whole byte tables built from the nibble ones above so a byte needs one lookup instead of two plus the bit shuffling */
+static WORD GCR_encode_byte[256];	/* byte to its 10 GCR bits */
+static WORD GCR_decode_byte[1024];	/* 10 GCR bits to their byte, bit 8 set if either half is not a valid GCR code */
+
+static struct GCRTables
+{
+	GCRTables()
+	{
+		int i;
+
+		for (i = 0; i < 256; i++)
+			GCR_encode_byte[i] = (GCR_conv_data[i >> 4] << 5) | GCR_conv_data[i & 0x0f];
+
+		for (i = 0; i < 1024; i++)
+		{
+			BYTE hnibble = GCR_decode_high[i >> 5];
+			BYTE lnibble = GCR_decode_low[i & 0x1f];
+			GCR_decode_byte[i] = hnibble | lnibble;
+			if (hnibble == 0xff || lnibble == 0xff)
+				GCR_decode_byte[i] |= 0x100;
+		}
+	}
+} gcrTables;
+
+/*
+    The 40 bits of a group are handled as its top byte plus the 32 bits below it,
+    which keeps the kernels to 32 bit registers on the Pi.
+    Only the top 8 bits of high are used so it may carry more above them.
+*/
+static inline int
+decode_GCR_group(unsigned int high, unsigned int low, BYTE * plain)
+{
+	unsigned int d0, d1, d2, d3;
+
+	d0 = GCR_decode_byte[((high << 2) | (low >> 30)) & 0x3ff];
+	d1 = GCR_decode_byte[(low >> 20) & 0x3ff];
+	d2 = GCR_decode_byte[(low >> 10) & 0x3ff];
+	d3 = GCR_decode_byte[low & 0x3ff];
+
+	plain[0] = (BYTE) d0;
+	plain[1] = (BYTE) d1;
+	plain[2] = (BYTE) d2;
+	plain[3] = (BYTE) d3;
+
+	if (((d0 | d1 | d2 | d3) & 0x100) == 0)
+		return 4;
+	if (d0 & 0x100)
+		return 0;
+	if (d1 & 0x100)
+		return 1;
+	return (d2 & 0x100) ? 2 : 3;
+}
+
 void
 convert_4bytes_to_GCR(BYTE * buffer, BYTE * ptr)
 {
-	*ptr = GCR_conv_data[(*buffer) >> 4] << 3;
-	*ptr |= GCR_conv_data[(*buffer) & 0x0f] >> 2;
-	ptr++;
-
-	*ptr = GCR_conv_data[(*buffer) & 0x0f] << 6;
-	buffer++;
-	*ptr |= GCR_conv_data[(*buffer) >> 4] << 1;
-	*ptr |= GCR_conv_data[(*buffer) & 0x0f] >> 4;
-	ptr++;
-
-	*ptr = GCR_conv_data[(*buffer) & 0x0f] << 4;
-	buffer++;
-	*ptr |= GCR_conv_data[(*buffer) >> 4] >> 1;
-	ptr++;
-
-	*ptr = GCR_conv_data[(*buffer) >> 4] << 7;
-	*ptr |= GCR_conv_data[(*buffer) & 0x0f] << 2;
-	buffer++;
-	*ptr |= GCR_conv_data[(*buffer) >> 4] >> 3;
-	ptr++;
-
-	*ptr = GCR_conv_data[(*buffer) >> 4] << 5;
-	*ptr |= GCR_conv_data[(*buffer) & 0x0f];
+	convert_bytes_to_GCR(buffer, ptr, 1);
+}
+
+void
+convert_bytes_to_GCR(const BYTE * buffer, BYTE * ptr, int groups)
+{
+	unsigned int high, low;
+
+	for (; groups > 0; groups--, buffer += 4, ptr += 5)
+	{
+		high = GCR_encode_byte[buffer[0]];
+		low = (high << 30) | (GCR_encode_byte[buffer[1]] << 20) | (GCR_encode_byte[buffer[2]] << 10) | GCR_encode_byte[buffer[3]];
+
+		ptr[0] = (BYTE) (high >> 2);
+		ptr[1] = (BYTE) (low >> 24);
+		ptr[2] = (BYTE) (low >> 16);
+		ptr[3] = (BYTE) (low >> 8);
+		ptr[4] = (BYTE) low;
+	}
 }
 
 int
 convert_4bytes_from_GCR(BYTE * gcr, BYTE * plain)
 {
-	BYTE hnibble, lnibble;
-	int badGCR, nConverted;
-
-	badGCR = 0;
-
-	hnibble = GCR_decode_high[gcr[0] >> 3];
-	lnibble = GCR_decode_low[((gcr[0] << 2) | (gcr[1] >> 6)) & 0x1f];
-	if ((hnibble == 0xff || lnibble == 0xff) && !badGCR)
-		badGCR = 1;
-	*plain++ = hnibble | lnibble;
-
-	hnibble = GCR_decode_high[(gcr[1] >> 1) & 0x1f];
-	lnibble = GCR_decode_low[((gcr[1] << 4) | (gcr[2] >> 4)) & 0x1f];
-	if ((hnibble == 0xff || lnibble == 0xff) && !badGCR)
-		badGCR = 2;
-	*plain++ = hnibble | lnibble;
-
-	hnibble = GCR_decode_high[((gcr[2] << 1) | (gcr[3] >> 7)) & 0x1f];
-	lnibble = GCR_decode_low[(gcr[3] >> 2) & 0x1f];
-	if ((hnibble == 0xff || lnibble == 0xff) && !badGCR)
-		badGCR = 3;
-	*plain++ = hnibble | lnibble;
-
-	hnibble = GCR_decode_high[((gcr[3] << 3) | (gcr[4] >> 5)) & 0x1f];
-	lnibble = GCR_decode_low[gcr[4] & 0x1f];
-	if ((hnibble == 0xff || lnibble == 0xff) && !badGCR)
-		badGCR = 4;
-	*plain++ = hnibble | lnibble;
-
-	nConverted = (badGCR == 0) ? 4 : (badGCR - 1);
-
-	return (nConverted);
+	return decode_GCR_group(gcr[0], (gcr[1] << 24) | (gcr[2] << 16) | (gcr[3] << 8) | gcr[4], plain);
+}
+
+void
+convert_bytes_from_GCR(const BYTE * gcr, int shift, BYTE * plain, int groups)
+{
+	unsigned int high, low;
+
+	for (; groups > 0; groups--, gcr += 5, plain += 4)
+	{
+		high = gcr[0];
+		low = (gcr[1] << 24) | (gcr[2] << 16) | (gcr[3] << 8) | gcr[4];
+		if (shift)
+		{
+			high = (high << shift) | (gcr[1] >> (8 - shift));
+			low = (low << shift) | (gcr[5] >> (8 - shift));
+		}
+		decode_GCR_group(high, low, plain);
+	}
 }
 
 int
@@ -467,11 +595,7 @@ convert_sector_to_GCR(BYTE * buffer, BYTE * ptr,
 	databuf[0x102] = 0;	/* 2 bytes filler */
 	databuf[0x103] = 0;
 
-	for (i = 0; i < 65; i++)
-	{
-		convert_4bytes_to_GCR(databuf + (4 * i), ptr);
-		ptr += 5;
-	}
+	convert_bytes_to_GCR(databuf, ptr, 65);
 }
 
 size_t
@@ -936,10 +1060,13 @@ check_sync_flags(BYTE * gcrdata, int density, int length)
 	int i, syncs = 0;
 
 	// check manually for SYNCKILL
+	// only all or none matter, so stop at the first byte that rules both out
 	for (i = 0; i < length; i++)
 	{
 		if (gcrdata[i] == 0xff)
 			syncs++;
+		else if (syncs)
+			return (density);
 	}
 
 	//printf("syncs: %d\n",syncs);
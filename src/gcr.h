@@ -124,8 +124,17 @@ extern int gap_match_length;
 
 /* prototypes */
 int find_sync(BYTE ** gcr_pptr, BYTE * gcr_end);
+/*
+    Bit level SYNC search round a circular track as the 1541 sees it, 32 bits at a time.
+    Returns the index of the first 0 bit after 10 or more 1 bits, looking no further than maxBits bits from bitIndex, or -1.
+    1 bits before bitIndex do not count. If a SYNC is found and syncStartIndex is given it gets the index of the SYNC's first 1 bit.
+*/
+int find_sync_bits(const BYTE * track, size_t length, int bitIndex, int maxBits, int * syncStartIndex);
 void convert_4bytes_to_GCR(BYTE * buffer, BYTE * ptr);
 int convert_4bytes_from_GCR(BYTE * gcr, BYTE * plain);
+/* Many 4 byte groups at once. The GCR may start shift (0-7) bits into gcr[0], in which case one byte past the last group is read. */
+void convert_bytes_to_GCR(const BYTE * buffer, BYTE * ptr, int groups);
+void convert_bytes_from_GCR(const BYTE * gcr, int shift, BYTE * plain, int groups);
 int extract_id(BYTE * gcr_track, BYTE * id);
 int extract_cosmetic_id(BYTE * gcr_track, BYTE * id);
 size_t find_track_cycle(BYTE ** cycle_start, BYTE ** cycle_stop, int cap_min,
@@ -36,6 +36,12 @@
 #include <ctype.h>
 #include <stdlib.h>
 #include <algorithm>
+#if defined(EXPERIMENTALZERO)
+extern "C"
+{
+#include "startup.h"
+}
+#endif
 
 #define CBM_NAME_LENGTH 16
 #define CBM_NAME_LENGTH_MINUS_D64 CBM_NAME_LENGTH-4
@@ -53,6 +59,7 @@ extern void Reboot_Pi();
 extern void SwitchDrive(const char* drive);
 extern int numberOfUSBMassStorageDevices;
 extern void DisplayMessage(int x, int y, bool LCD, const char* message, u32 textColour, u32 backgroundColour);
+extern u32 clockCycles1MHz;
 
 #define WaitWhile(checkStatus) \
 	do\
@@ -218,6 +225,7 @@ IEC_Commands::IEC_Commands()
 	deviceID = 8;
 	usingVIC20 = false;
 	autoBootFB128 = false;
+	jiffyDOS = false;
 	Reset();
 	starFileName = 0;
 	C128BootSectorName = 0;
@@ -230,6 +238,8 @@ void IEC_Commands::Reset(void)
 {
 	receivedCommand = false;
 	receivedEOI = false;
+	jiffyActive = false;
+	jiffyLoad = false;
 	secondaryAddress = 0;
 	selectedImageName[0] = 0;
 	atnSequence = ATN_SEQUENCE_IDLE;
@@ -304,6 +314,9 @@ bool IEC_Commands::CheckATN(void)
 
 bool IEC_Commands::WriteIECSerialPort(u8 data, bool eoi)
 {
+	if (jiffyActive)
+		return WriteJiffyDOS(data, eoi, false, true);
+
 	IEC_Bus::WaitMicroSeconds(50); //sidplay64-sd2iec needs this?
 
 	// When the talker is ready it releases the Clock line.
@@ -346,6 +359,10 @@ bool IEC_Commands::WriteIECSerialPort(u8 data, bool eoi)
 
 bool IEC_Commands::ReadIECSerialPort(u8& byte)
 {
+	// Bytes sent under ATN always use the standard protocol.
+	if (jiffyActive && atnSequence != ATN_SEQUENCE_RECEIVE_COMMAND_CODE)
+		return ReadJiffyDOS(byte);
+
 	byte = 0;
 
 	// When the talker is ready it releases the Clock line.
@@ -374,6 +391,11 @@ bool IEC_Commands::ReadIECSerialPort(u8& byte)
 
 	for (u8 i = 0; i < 8; ++i)
 	{
+		if (i == 7 && jiffyDOS && !jiffyActive && atnSequence == ATN_SEQUENCE_RECEIVE_COMMAND_CODE)
+		{
+			if (DetectJiffyDOS(byte))
+				return true;
+		}
 		WaitWhile(IEC_Bus::IsClockAsserted());
 		byte = (byte >> 1) | (!!IEC_Bus::IsDataReleased() << 7);
 		WaitWhile(IEC_Bus::IsClockReleased());
@@ -383,6 +405,159 @@ bool IEC_Commands::ReadIECSerialPort(u8& byte)
 	return false;
 }
 
+// JIFFYDOS
+// A JiffyDOS computer identifies itself while sending a Listen or Talk under ATN. Before the last bit it holds the Clock line asserted for longer than usual (more than 200 microseconds).
+// A device that also speaks JiffyDOS answers by asserting the Data line for about 100 microseconds during this delay.
+// From then until the next ATN the data bytes (not the commands under ATN) are sent two bits at a time, one on the Clock line and one on the Data line.
+// There is no per bit handshake; each pair is placed on (or read from) the lines at a fixed time after a start edge so the timing below is critical.
+// If the computer then sends a Talk with secondary address 1 it wants to use the JiffyDOS LOAD protocol.
+// This streams the file and only sends the EOI status at the end of each block (giving us time to read the next one) instead of after every byte.
+
+// Times are in tenths of a micro second from the start edge.
+// They are timed with the CPU's cycle counter as the 1MHz system timer could be up to a micro second late.
+static const u16 JiffyDOSReceiveTimes[4] = { 185, 315, 390, 510 };
+static const u8 JiffyDOSReceiveClockBits[4] = { 4, 6, 3, 2 };
+static const u8 JiffyDOSReceiveDataBits[4] = { 5, 7, 1, 0 };
+static const u16 JiffyDOSSendTimes[4] = { 100, 200, 310, 410 };
+
+static inline void JiffyDOSWaitUntil(u32 start, u32 time)
+{
+	u32 cycles = time * clockCycles1MHz / 10;
+
+	while (read_cycle_counter() - start < cycles)
+	{
+	}
+}
+
+// Interrupts are held off from just before a byte's start edge until it has been handshaked as one would throw the timing out.
+// Only the Pi Zero build takes interrupts on this core; other builds take them on core0 so there is nothing to do.
+class JiffyDOSTimedSection
+{
+public:
+#if defined(EXPERIMENTALZERO)
+	JiffyDOSTimedSection() : cpsr(_disable_interrupts()) {}
+	~JiffyDOSTimedSection()
+	{
+		if ((cpsr & 0x80) == 0)	// Only if the IRQs were on before.
+			_enable_interrupts();
+	}
+
+private:
+	int cpsr;
+#endif
+};
+
+bool IEC_Commands::DetectJiffyDOS(u8 byte)
+{
+	// byte holds the first 7 bits of the command code.
+	u8 command = byte >> 1;
+	bool forUs = command == 0x20 + deviceID || command == 0x40 + deviceID;
+	u32 start = read32(ARM_SYSTIMER_CLO);
+
+	do
+	{
+		IEC_Bus::ReadBrowseMode();
+		if (CheckATN()) return true;
+		if (forUs && !jiffyActive && (read32(ARM_SYSTIMER_CLO) - start) > 218)
+		{
+			JiffyDOSTimedSection timedSection;
+			IEC_Bus::AssertData();
+			IEC_Bus::WaitMicroSeconds(101);
+			IEC_Bus::ReleaseData();
+			jiffyActive = true;
+		}
+	}
+	while (IEC_Bus::IsClockAsserted());
+	return false;
+}
+
+bool IEC_Commands::ReadJiffyDOS(u8& byte)
+{
+	byte = 0;
+
+	JiffyDOSTimedSection timedSection;
+
+	// We are ready when we have released both lines. The computer starts the byte by releasing the Clock line.
+	IEC_Bus::ReleaseClock();
+	IEC_Bus::ReleaseData();
+	WaitWhile(IEC_Bus::IsClockAsserted());
+	u32 start = read_cycle_counter();
+
+	for (u8 i = 0; i < 4; ++i)
+	{
+		JiffyDOSWaitUntil(start, JiffyDOSReceiveTimes[i]);
+		IEC_Bus::ReadBrowseMode();
+		if (IEC_Bus::IsClockReleased()) byte |= 1 << JiffyDOSReceiveClockBits[i];
+		if (IEC_Bus::IsDataReleased()) byte |= 1 << JiffyDOSReceiveDataBits[i];
+	}
+	byte ^= 0xff;
+
+	// The computer then tells us if this was the last byte by releasing the Clock line.
+	JiffyDOSWaitUntil(start, 670);
+	IEC_Bus::ReadBrowseMode();
+	if (CheckATN()) return true;
+	if (IEC_Bus::IsClockReleased()) receivedEOI = true;
+
+	// Acknowledge the byte.
+	JiffyDOSWaitUntil(start, 730);
+	IEC_Bus::AssertData();
+	IEC_Bus::WaitMicroSeconds(10);
+	return false;
+}
+
+bool IEC_Commands::WriteJiffyDOS(u8 data, bool eoi, bool loadMode, bool sendStatus)
+{
+	IEC_Bus::ReleaseData();
+	IEC_Bus::ReleaseClock();
+	IEC_Bus::WaitMicroSeconds(3);
+
+	JiffyDOSTimedSection timedSection;
+	if (loadMode)
+	{
+		// When LOADing the computer starts each byte by asserting the Data line.
+		WaitWhile(IEC_Bus::IsDataAsserted());
+		WaitWhile(IEC_Bus::IsDataReleased());
+	}
+	else
+	{
+		// Otherwise the computer starts the byte by releasing the Data line.
+		WaitWhile(IEC_Bus::IsDataAsserted());
+	}
+	u32 start = read_cycle_counter();
+
+	for (u8 i = 0; i < 4; ++i)
+	{
+		JiffyDOSWaitUntil(start, JiffyDOSSendTimes[i]);
+		if (data & (1 << (i * 2))) IEC_Bus::ReleaseClock();
+		else IEC_Bus::AssertClock();
+		if (data & (2 << (i * 2))) IEC_Bus::ReleaseData();
+		else IEC_Bus::AssertData();
+	}
+
+	if (sendStatus)
+	{
+		// EOI is signalled with the Clock line released and the Data line asserted.
+		// Otherwise (and when LOADing this means there is more to come) the Clock line is asserted and the Data line released.
+		JiffyDOSWaitUntil(start, 520);
+		if (eoi)
+		{
+			IEC_Bus::ReleaseClock();
+			IEC_Bus::AssertData();
+		}
+		else
+		{
+			IEC_Bus::AssertClock();
+			IEC_Bus::ReleaseData();
+		}
+		IEC_Bus::WaitMicroSeconds(3);
+		// The computer acknowledges by asserting the Data line.
+		WaitWhile(IEC_Bus::IsDataReleased());
+	}
+
+	IEC_Bus::WaitMicroSeconds(10);
+	return false;
+}
+
 void IEC_Commands::SimulateIECBegin(void)
 {
 	SetHeaderVersion();
@@ -451,6 +626,8 @@ IEC_Commands::UpdateAction IEC_Commands::SimulateIECUpdate(void)
 			deviceRole = DEVICE_ROLE_PASSIVE;
 			atnSequence = ATN_SEQUENCE_RECEIVE_COMMAND_CODE;
 			receivedEOI = false;
+			jiffyActive = false;
+			jiffyLoad = false;
 
 			// Wait until the computer is ready to talk
 			// TODO: should set a timer here and if it times out (before the clock is released) go back to IDLE?
@@ -528,6 +705,12 @@ IEC_Commands::UpdateAction IEC_Commands::SimulateIECUpdate(void)
 			else if ((commandCode & 0x60) == 0x60)	// Set secondary addresses for 6*, e* and f* commands
 			{
 				secondaryAddress = commandCode & 0x0f;
+				if (jiffyActive && deviceRole == DEVICE_ROLE_TALK && commandCode == 0x61)
+				{
+					// JiffyDOS LOAD of the file opened on channel 0
+					jiffyLoad = true;
+					secondaryAddress = 0;
+				}
 				if ((commandCode & 0xf0) == 0xe0)	// Close
 				{
 					CloseFile(secondaryAddress);
@@ -1529,7 +1712,13 @@ bool IEC_Commands::SendBuffer(Channel& channel, bool eoi)
 	for (u32 i = 0; i < channel.cursor; ++i)
 	{
 		u8 finalbyte = eoi && (channel.bytesSent == (channel.fileSize - 1));
-		if (WriteIECSerialPort(channel.buffer[i], finalbyte))
+		if (jiffyLoad)
+		{
+			// Only the last byte of the buffer needs a status so the computer waits while we read the next one.
+			if (WriteJiffyDOS(channel.buffer[i], finalbyte, true, finalbyte || i == channel.cursor - 1))
+				return true;
+		}
+		else if (WriteIECSerialPort(channel.buffer[i], finalbyte))
 		{
 			return true;
 		}
@@ -74,6 +74,7 @@ public:
 	u8 GetDeviceId() { return deviceID; }
 
 	void SetLowercaseBrowseModeFilenames(bool value) { lowercaseBrowseModeFilenames = value; }
+	void SetJiffyDOS(bool value) { jiffyDOS = value; }
 	void SetNewDiskType(DiskImage::DiskType type) { newDiskType = type; }
 	void SetAutoBootFB128(bool autoBootFB128) { this->autoBootFB128 = autoBootFB128; }
 	void Set128BootSectorName(const char* SectorName) 
@@ -134,6 +135,9 @@ protected:
 	bool CheckATN(void);
 	bool WriteIECSerialPort(u8 data, bool eoi);
 	bool ReadIECSerialPort(u8& byte);
+	bool WriteJiffyDOS(u8 data, bool eoi, bool loadMode, bool sendStatus);
+	bool ReadJiffyDOS(u8& byte);
+	bool DetectJiffyDOS(u8 byte);
 
 	void Listen();
 	void Talk();
@@ -180,6 +184,9 @@ protected:
 	bool receivedEOI : 1;	// End Or Identify
 	bool usingVIC20 : 1;	// When sending data we need to wait longer for the 64 as its VICII may be stealing its cycles. VIC20 does not have this problem and can accept data faster.
 	bool autoBootFB128 : 1;
+	bool jiffyDOS : 1;		// Allow JiffyDOS to be negotiated.
+	bool jiffyActive : 1;	// JiffyDOS was negotiated during this ATN sequence.
+	bool jiffyLoad : 1;		// JiffyDOS LOAD (block) protocol.
 
 	u8 deviceID;
 	u8 secondaryAddress;
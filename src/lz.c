@@ -154,10 +154,11 @@ static int _LZ_WriteVarSize( unsigned int x, unsigned char * buf )
 
 /*************************************************************************
 * _LZ_ReadVarSize() - Read unsigned integer with variable number of
-* bytes depending on value.
+* bytes depending on value. Returns 0 rather than read past end.
 *************************************************************************/
 
-static int _LZ_ReadVarSize( unsigned int * x, unsigned char * buf )
+static int _LZ_ReadVarSize( unsigned int * x, const unsigned char * buf,
+    const unsigned char * end )
 {
 	unsigned int y, b, num_bytes;
 
@@ -166,6 +167,10 @@ static int _LZ_ReadVarSize( unsigned int * x, unsigned char * buf )
 	num_bytes = 0;
 	do
 	{
+		if( buf >= end )
+		{
+			return 0;
+		}
 		b = (unsigned int) (*buf ++);
 		y = (y << 7) | (b & 0x0000007f);
 		++ num_bytes;
@@ -332,7 +337,8 @@ int LZ_Compress( unsigned char *in, unsigned char *out, unsigned int insize )
 * The function returns the size of the compressed data.
 *************************************************************************/
 
-int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
+int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize,
+    unsigned int *work )
 {
 	unsigned char marker, symbol;
 	unsigned int  inpos, outpos, bytesleft, i, index, symbols;
@@ -340,7 +346,6 @@ int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
 	unsigned int  maxlength, length, bestlength;
 	unsigned int  histogram[ 256 ], *lastindex, *jumptable;
 	unsigned char *ptr1, *ptr2;
-	unsigned int *work;
 
 	/* Do we have anything to compress? */
 	if( insize < 1 )
@@ -348,13 +353,6 @@ int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
 		return 0;
 	}
 
-	if(!(work = malloc(insize+65536 * sizeof(unsigned int))))
-	{
-		//printf("Could not allocate compression buffer\n");
-		//exit(0);
-		return 0;
-	}
-
 	/* Assign arrays to the working area */
 	lastindex = work;
 	jumptable = &work[ 65536 ];
@@ -487,24 +485,28 @@ int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize)
 		++ inpos;
 	}
 
-	free(work);
-
 	return outpos;
 }
 
 
 /*************************************************************************
-* LZ_Uncompress() - Uncompress a block of data using an LZ77 decoder.
-*  in      - Input (compressed) buffer.
-*  out     - Output (uncompressed) buffer. This buffer must be large
-*            enough to hold the uncompressed data.
-*  insize  - Number of input bytes.
+* _LZ_Uncompress() - The LZ77 decoder behind LZ_Uncompress() and
+* LZ_UncompressBounded().
+* Rather than a byte at a time, each run of literals up to the next
+* marker is found with memchr() and copied in one go. A reference that
+* does not overlap the bytes it is copied to is one memcpy(), one a byte
+* back is a memset(), and any other overlapping one is copied in chunks
+* that double in size as the repeated pattern grows.
+* Returns 0 for data that would write more than outsize bytes or refer
+* back before the start of the output.
 *************************************************************************/
 
-int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize )
+static unsigned int _LZ_Uncompress( const unsigned char *in, unsigned char *out,
+    unsigned int insize, unsigned int outsize )
 {
-	unsigned char marker, symbol;
-	unsigned int  i, inpos, outpos, length, offset;
+	const unsigned char *src, *end, *next;
+	unsigned char marker, *from, *to;
+	unsigned int outpos, length, offset, num_bytes;
 
 	/* Do we have anything to uncompress? */
 	if( insize < 1 )
@@ -514,43 +516,114 @@ int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize )
 
 	/* Get marker symbol from input stream */
 	marker = in[ 0 ];
-	inpos = 1;
+	src = in + 1;
+	end = in + insize;
 
 	/* Main decompression loop */
 	outpos = 0;
-	do
+	while( src < end )
 	{
-		symbol = in[ inpos ++ ];
-		if( symbol == marker )
+		/* Plain copy up to the next marker */
+		next = (const unsigned char *) memchr( src, marker, end - src );
+		if( next == NULL )
 		{
-			/* We had a marker byte */
-			if( in[ inpos ] == 0 )
+			next = end;
+		}
+		length = next - src;
+		if( length > outsize - outpos )
+		{
+			return 0;
+		}
+		memcpy( &out[ outpos ], src, length );
+		outpos += length;
+		src = next;
+		if( src >= end )
+		{
+			break;
+		}
+
+		/* We had a marker byte */
+		if( ++ src >= end )
+		{
+			return 0;
+		}
+		if( *src == 0 )
+		{
+			/* It was a single occurrence of the marker byte */
+			if( outpos >= outsize )
 			{
-				/* It was a single occurrence of the marker byte */
-				out[ outpos ++ ] = marker;
-				++ inpos;
+				return 0;
 			}
-			else
-			{
-				/* Extract true length and offset */
-				inpos += _LZ_ReadVarSize( &length, &in[ inpos ] );
-				inpos += _LZ_ReadVarSize( &offset, &in[ inpos ] );
+			out[ outpos ++ ] = marker;
+			++ src;
+			continue;
+		}
 
-				/* Copy corresponding data from history window */
-				for( i = 0; i < length; ++ i )
-				{
-					out[ outpos ] = out[ outpos - offset ];
-					++ outpos;
-				}
-			}
+		/* Extract true length and offset */
+		num_bytes = _LZ_ReadVarSize( &length, src, end );
+		if( num_bytes == 0 )
+		{
+			return 0;
+		}
+		src += num_bytes;
+		num_bytes = _LZ_ReadVarSize( &offset, src, end );
+		if( num_bytes == 0 || offset == 0 || offset > outpos || length > outsize - outpos )
+		{
+			return 0;
+		}
+		src += num_bytes;
+
+		/* Copy corresponding data from history window */
+		from = &out[ outpos - offset ];
+		to = &out[ outpos ];
+		outpos += length;
+		if( offset >= length )
+		{
+			memcpy( to, from, length );
+		}
+		else if( offset == 1 )
+		{
+			memset( to, *from, length );
 		}
 		else
 		{
-			/* No marker, plain copy */
-			out[ outpos ++ ] = symbol;
+			/* Each copy doubles the run of the repeated pattern behind to */
+			while( length > offset )
+			{
+				memcpy( to, from, offset );
+				to += offset;
+				length -= offset;
+				offset <<= 1;
+			}
+			memcpy( to, from, length );
 		}
 	}
-	while( inpos < insize );
 
 	return outpos;
 }
+
+
+/*************************************************************************
+* LZ_Uncompress() - Uncompress a block of data using an LZ77 decoder.
+*  in      - Input (compressed) buffer.
+*  out     - Output (uncompressed) buffer. This buffer must be large
+*            enough to hold the uncompressed data.
+*  insize  - Number of input bytes.
+*************************************************************************/
+
+int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize )
+{
+	return (int) _LZ_Uncompress( in, out, insize, 0xffffffff );
+}
+
+
+/*************************************************************************
+* LZ_UncompressBounded() - As LZ_Uncompress(), but never writes more
+* than outsize bytes. Returns 0 if the data will not fit or is corrupt.
+*************************************************************************/
+
+int LZ_UncompressBounded( unsigned char *in, unsigned char *out,
+    unsigned int insize, unsigned int outsize )
+{
+	return (int) _LZ_Uncompress( in, out, insize, outsize );
+}
@@ -42,8 +42,11 @@ extern "C" {
 *************************************************************************/
 
 int LZ_Compress( unsigned char *in, unsigned char *out, unsigned int insize );
-int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize);
+int LZ_CompressFast( unsigned char *in, unsigned char *out, unsigned int insize,
+    unsigned int *work );
 int LZ_Uncompress( unsigned char *in, unsigned char *out, unsigned int insize );
+int LZ_UncompressBounded( unsigned char *in, unsigned char *out,
+    unsigned int insize, unsigned int outsize );
 
 
 #ifdef __cplusplus
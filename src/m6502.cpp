@@ -17,50 +17,54 @@
 // along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
 
 #include "m6502.h"
+#include "BusPageTable.h"
 
-M6502::OpcodeCycleFunction M6502::opcodeFunctions[256] =
+template <class Bus>
+typename M6502Core<Bus>::OpcodeCycleFunction M6502Core<Bus>::opcodeFunctions[256] =
 {
 //       0           1           2           3           4           5           6           7           8           9           A           B           C           D           E           F
-&M6502::BRK,&M6502::ORA,&M6502::JAM,&M6502::SLO,&M6502::NOP,&M6502::ORA,&M6502::ASL,&M6502::SLO,&M6502::PHP,&M6502::ORA,&M6502::ASL,&M6502::ANC,&M6502::NOP,&M6502::ORA,&M6502::ASL,&M6502::SLO,// 0
-&M6502::BPL,&M6502::ORA,&M6502::JAM,&M6502::SLO,&M6502::NOP,&M6502::ORA,&M6502::ASL,&M6502::SLO,&M6502::CLC,&M6502::ORA,&M6502::NOP,&M6502::SLO,&M6502::NOP,&M6502::ORA,&M6502::ASL,&M6502::SLO,// 1
-&M6502::JSR,&M6502::AND,&M6502::JAM,&M6502::RLA,&M6502::BIT,&M6502::AND,&M6502::ROL,&M6502::RLA,&M6502::PLP,&M6502::AND,&M6502::ROL,&M6502::ANC,&M6502::BIT,&M6502::AND,&M6502::ROL,&M6502::RLA,// 2
-&M6502::BMI,&M6502::AND,&M6502::JAM,&M6502::RLA,&M6502::NOP,&M6502::AND,&M6502::ROL,&M6502::RLA,&M6502::SEC,&M6502::AND,&M6502::NOP,&M6502::RLA,&M6502::NOP,&M6502::AND,&M6502::ROL,&M6502::RLA,// 3
-&M6502::RTI,&M6502::EOR,&M6502::JAM,&M6502::SRE,&M6502::NOP,&M6502::EOR,&M6502::LSR,&M6502::SRE,&M6502::PHA,&M6502::EOR,&M6502::LSR,&M6502::ASR,&M6502::JMP,&M6502::EOR,&M6502::LSR,&M6502::SRE,// 4
-&M6502::BVC,&M6502::EOR,&M6502::JAM,&M6502::SRE,&M6502::NOP,&M6502::EOR,&M6502::LSR,&M6502::SRE,&M6502::CLI,&M6502::EOR,&M6502::NOP,&M6502::SRE,&M6502::NOP,&M6502::EOR,&M6502::LSR,&M6502::SRE,// 5
-&M6502::RTS,&M6502::ADC,&M6502::JAM,&M6502::RRA,&M6502::NOP,&M6502::ADC,&M6502::ROR,&M6502::RRA,&M6502::PLA,&M6502::ADC,&M6502::ROR,&M6502::ARR,&M6502::JMP,&M6502::ADC,&M6502::ROR,&M6502::RRA,// 6
-&M6502::BVS,&M6502::ADC,&M6502::JAM,&M6502::RRA,&M6502::NOP,&M6502::ADC,&M6502::ROR,&M6502::RRA,&M6502::SEI,&M6502::ADC,&M6502::NOP,&M6502::RRA,&M6502::NOP,&M6502::ADC,&M6502::ROR,&M6502::RRA,// 7
-&M6502::NOP,&M6502::STA,&M6502::NOP,&M6502::SAX,&M6502::STY,&M6502::STA,&M6502::STX,&M6502::SAX,&M6502::DEY,&M6502::NOP,&M6502::TXA,&M6502::XAA,&M6502::STY,&M6502::STA,&M6502::STX,&M6502::SAX,// 8
-&M6502::BCC,&M6502::STA,&M6502::JAM,&M6502::SHA,&M6502::STY,&M6502::STA,&M6502::STX,&M6502::SAX,&M6502::TYA,&M6502::STA,&M6502::TXS,&M6502::SHS,&M6502::SHY,&M6502::STA,&M6502::SHX,&M6502::SHA,// 9
-&M6502::LDY,&M6502::LDA,&M6502::LDX,&M6502::LAX,&M6502::LDY,&M6502::LDA,&M6502::LDX,&M6502::LAX,&M6502::TAY,&M6502::LDA,&M6502::TAX,&M6502::LXA,&M6502::LDY,&M6502::LDA,&M6502::LDX,&M6502::LAX,// A
-&M6502::BCS,&M6502::LDA,&M6502::JAM,&M6502::LAX,&M6502::LDY,&M6502::LDA,&M6502::LDX,&M6502::LAX,&M6502::CLV,&M6502::LDA,&M6502::TSX,&M6502::LAS,&M6502::LDY,&M6502::LDA,&M6502::LDX,&M6502::LAX,// B
-&M6502::CPY,&M6502::CMP,&M6502::NOP,&M6502::DCP,&M6502::CPY,&M6502::CMP,&M6502::DEC,&M6502::DCP,&M6502::INY,&M6502::CMP,&M6502::DEX,&M6502::SBX,&M6502::CPY,&M6502::CMP,&M6502::DEC,&M6502::DCP,// C
-&M6502::BNE,&M6502::CMP,&M6502::JAM,&M6502::DCP,&M6502::NOP,&M6502::CMP,&M6502::DEC,&M6502::DCP,&M6502::CLD,&M6502::CMP,&M6502::NOP,&M6502::DCP,&M6502::NOP,&M6502::CMP,&M6502::DEC,&M6502::DCP,// D
-&M6502::CPX,&M6502::SBC,&M6502::NOP,&M6502::ISB,&M6502::CPX,&M6502::SBC,&M6502::INC,&M6502::ISB,&M6502::INX,&M6502::SBC,&M6502::NOP,&M6502::SBC,&M6502::CPX,&M6502::SBC,&M6502::INC,&M6502::ISB,// E
-&M6502::BEQ,&M6502::SBC,&M6502::JAM,&M6502::ISB,&M6502::NOP,&M6502::SBC,&M6502::INC,&M6502::ISB,&M6502::SED,&M6502::SBC,&M6502::NOP,&M6502::ISB,&M6502::NOP,&M6502::SBC,&M6502::INC,&M6502::ISB // F
+&M6502Core::BRK,&M6502Core::ORA,&M6502Core::JAM,&M6502Core::SLO,&M6502Core::NOP,&M6502Core::ORA,&M6502Core::ASL,&M6502Core::SLO,&M6502Core::PHP,&M6502Core::ORA,&M6502Core::ASL,&M6502Core::ANC,&M6502Core::NOP,&M6502Core::ORA,&M6502Core::ASL,&M6502Core::SLO,// 0
+&M6502Core::BPL,&M6502Core::ORA,&M6502Core::JAM,&M6502Core::SLO,&M6502Core::NOP,&M6502Core::ORA,&M6502Core::ASL,&M6502Core::SLO,&M6502Core::CLC,&M6502Core::ORA,&M6502Core::NOP,&M6502Core::SLO,&M6502Core::NOP,&M6502Core::ORA,&M6502Core::ASL,&M6502Core::SLO,// 1
+&M6502Core::JSR,&M6502Core::AND,&M6502Core::JAM,&M6502Core::RLA,&M6502Core::BIT,&M6502Core::AND,&M6502Core::ROL,&M6502Core::RLA,&M6502Core::PLP,&M6502Core::AND,&M6502Core::ROL,&M6502Core::ANC,&M6502Core::BIT,&M6502Core::AND,&M6502Core::ROL,&M6502Core::RLA,// 2
+&M6502Core::BMI,&M6502Core::AND,&M6502Core::JAM,&M6502Core::RLA,&M6502Core::NOP,&M6502Core::AND,&M6502Core::ROL,&M6502Core::RLA,&M6502Core::SEC,&M6502Core::AND,&M6502Core::NOP,&M6502Core::RLA,&M6502Core::NOP,&M6502Core::AND,&M6502Core::ROL,&M6502Core::RLA,// 3
+&M6502Core::RTI,&M6502Core::EOR,&M6502Core::JAM,&M6502Core::SRE,&M6502Core::NOP,&M6502Core::EOR,&M6502Core::LSR,&M6502Core::SRE,&M6502Core::PHA,&M6502Core::EOR,&M6502Core::LSR,&M6502Core::ASR,&M6502Core::JMP,&M6502Core::EOR,&M6502Core::LSR,&M6502Core::SRE,// 4
+&M6502Core::BVC,&M6502Core::EOR,&M6502Core::JAM,&M6502Core::SRE,&M6502Core::NOP,&M6502Core::EOR,&M6502Core::LSR,&M6502Core::SRE,&M6502Core::CLI,&M6502Core::EOR,&M6502Core::NOP,&M6502Core::SRE,&M6502Core::NOP,&M6502Core::EOR,&M6502Core::LSR,&M6502Core::SRE,// 5
+&M6502Core::RTS,&M6502Core::ADC,&M6502Core::JAM,&M6502Core::RRA,&M6502Core::NOP,&M6502Core::ADC,&M6502Core::ROR,&M6502Core::RRA,&M6502Core::PLA,&M6502Core::ADC,&M6502Core::ROR,&M6502Core::ARR,&M6502Core::JMP,&M6502Core::ADC,&M6502Core::ROR,&M6502Core::RRA,// 6
+&M6502Core::BVS,&M6502Core::ADC,&M6502Core::JAM,&M6502Core::RRA,&M6502Core::NOP,&M6502Core::ADC,&M6502Core::ROR,&M6502Core::RRA,&M6502Core::SEI,&M6502Core::ADC,&M6502Core::NOP,&M6502Core::RRA,&M6502Core::NOP,&M6502Core::ADC,&M6502Core::ROR,&M6502Core::RRA,// 7
+&M6502Core::NOP,&M6502Core::STA,&M6502Core::NOP,&M6502Core::SAX,&M6502Core::STY,&M6502Core::STA,&M6502Core::STX,&M6502Core::SAX,&M6502Core::DEY,&M6502Core::NOP,&M6502Core::TXA,&M6502Core::XAA,&M6502Core::STY,&M6502Core::STA,&M6502Core::STX,&M6502Core::SAX,// 8
+&M6502Core::BCC,&M6502Core::STA,&M6502Core::JAM,&M6502Core::SHA,&M6502Core::STY,&M6502Core::STA,&M6502Core::STX,&M6502Core::SAX,&M6502Core::TYA,&M6502Core::STA,&M6502Core::TXS,&M6502Core::SHS,&M6502Core::SHY,&M6502Core::STA,&M6502Core::SHX,&M6502Core::SHA,// 9
+&M6502Core::LDY,&M6502Core::LDA,&M6502Core::LDX,&M6502Core::LAX,&M6502Core::LDY,&M6502Core::LDA,&M6502Core::LDX,&M6502Core::LAX,&M6502Core::TAY,&M6502Core::LDA,&M6502Core::TAX,&M6502Core::LXA,&M6502Core::LDY,&M6502Core::LDA,&M6502Core::LDX,&M6502Core::LAX,// A
+&M6502Core::BCS,&M6502Core::LDA,&M6502Core::JAM,&M6502Core::LAX,&M6502Core::LDY,&M6502Core::LDA,&M6502Core::LDX,&M6502Core::LAX,&M6502Core::CLV,&M6502Core::LDA,&M6502Core::TSX,&M6502Core::LAS,&M6502Core::LDY,&M6502Core::LDA,&M6502Core::LDX,&M6502Core::LAX,// B
+&M6502Core::CPY,&M6502Core::CMP,&M6502Core::NOP,&M6502Core::DCP,&M6502Core::CPY,&M6502Core::CMP,&M6502Core::DEC,&M6502Core::DCP,&M6502Core::INY,&M6502Core::CMP,&M6502Core::DEX,&M6502Core::SBX,&M6502Core::CPY,&M6502Core::CMP,&M6502Core::DEC,&M6502Core::DCP,// C
+&M6502Core::BNE,&M6502Core::CMP,&M6502Core::JAM,&M6502Core::DCP,&M6502Core::NOP,&M6502Core::CMP,&M6502Core::DEC,&M6502Core::DCP,&M6502Core::CLD,&M6502Core::CMP,&M6502Core::NOP,&M6502Core::DCP,&M6502Core::NOP,&M6502Core::CMP,&M6502Core::DEC,&M6502Core::DCP,// D
+&M6502Core::CPX,&M6502Core::SBC,&M6502Core::NOP,&M6502Core::ISB,&M6502Core::CPX,&M6502Core::SBC,&M6502Core::INC,&M6502Core::ISB,&M6502Core::INX,&M6502Core::SBC,&M6502Core::NOP,&M6502Core::SBC,&M6502Core::CPX,&M6502Core::SBC,&M6502Core::INC,&M6502Core::ISB,// E
+&M6502Core::BEQ,&M6502Core::SBC,&M6502Core::JAM,&M6502Core::ISB,&M6502Core::NOP,&M6502Core::SBC,&M6502Core::INC,&M6502Core::ISB,&M6502Core::SED,&M6502Core::SBC,&M6502Core::NOP,&M6502Core::ISB,&M6502Core::NOP,&M6502Core::SBC,&M6502Core::INC,&M6502Core::ISB // F
 };
 
-M6502::AddressModeCycleFunction M6502::T1AddressModeFunctions[256] =
+template <class Bus>
+typename M6502Core<Bus>::AddressModeCycleFunction M6502Core<Bus>::T1AddressModeFunctions[256] =
 {
 //       0                     1                2                       3                4                  5                  6                 7                  8                  9                  A                 B                  C                  D                    E              F
-&M6502::brk_5_4_T1,&M6502::idx_2_4_T1,&M6502::sb_jam_T1, &M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::ph_5_1_T1,&M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //0
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1,//1
-&M6502::jsr_5_3_T1,&M6502::idx_2_4_T1,&M6502::sb_jam_T1, &M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::pl_5_2_T1,&M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //2
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1,//3
-&M6502::rti_5_5_T1,&M6502::idx_2_4_T1,&M6502::sb_jam_T1, &M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::ph_5_1_T1,&M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs5_6_1_T1,&M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //4
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1,//5
-&M6502::rts_5_7_T1,&M6502::idx_2_4_T1,&M6502::sb_jam_T1, &M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::pl_5_2_T1,&M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs5_6_2_T1,&M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //6
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1,//7
-&M6502::imm_2_1_T1,&M6502::idx_3_3_T1,&M6502::imm_2_1_T1,&M6502::idx_3_3_T1,  &M6502::zp_3_1_T1, &M6502::zp_3_1_T1, &M6502::zp_2_1_T1, &M6502::zp_3_1_T1, &M6502::sb_1_T1,  &M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_3_2_T1, &M6502::abs_3_2_T1, &M6502::abs_3_2_T1, &M6502::abs_3_2_T1, //8
-&M6502::rel_5_8_T1,&M6502::idy_3_6_T1,&M6502::sb_jam_T1, &M6502::idy_3_6_T1,  &M6502::zpx_3_5_T1,&M6502::zpx_3_5_T1,&M6502::zpy_3_5_T1,&M6502::zpy_3_5_T1,&M6502::sb_1_T1,  &M6502::absy_3_4_T1,&M6502::sb_1_T1,&M6502::absy_3_4_T1,&M6502::absx_3_4_T1,&M6502::absx_3_4_T1,&M6502::absy_3_4_T1,&M6502::absy_3_4_T1,//9
-&M6502::imm_2_1_T1,&M6502::idx_2_4_T1,&M6502::imm_2_1_T1,&M6502::idx_2_4_T1,  &M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::sb_1_T1,  &M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, //A
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_2_7_T1,  &M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpy_2_6_T1,&M6502::zpy_2_6_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absy_2_5_T1,&M6502::absy_2_5_T1,//B
-&M6502::imm_2_1_T1,&M6502::idx_2_4_T1,&M6502::imm_2_1_T1,&M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::sb_1_T1,  &M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //C
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1,//D
-&M6502::imm_2_1_T1,&M6502::idx_2_4_T1,&M6502::imm_2_1_T1,&M6502::idx_Undoc_T1,&M6502::zp_2_1_T1, &M6502::zp_2_1_T1, &M6502::zp_4_1_T1, &M6502::zp_4_1_T1, &M6502::sb_1_T1,  &M6502::imm_2_1_T1, &M6502::sb_1_T1,&M6502::imm_2_1_T1, &M6502::abs_2_3_T1, &M6502::abs_2_3_T1, &M6502::abs_4_2_T1, &M6502::abs_4_2_T1, //E
-&M6502::rel_5_8_T1,&M6502::idy_2_7_T1,&M6502::sb_jam_T1, &M6502::idy_Undoc_T1,&M6502::zpx_2_6_T1,&M6502::zpx_2_6_T1,&M6502::zpx_4_3_T1,&M6502::zpx_4_3_T1,&M6502::sb_1_T1,  &M6502::absy_2_5_T1,&M6502::sb_1_T1,&M6502::absy_4_4_T1,&M6502::absx_2_5_T1,&M6502::absx_2_5_T1,&M6502::absx_4_4_T1,&M6502::absx_4_4_T1 //F
+&M6502Core::brk_5_4_T1,&M6502Core::idx_2_4_T1,&M6502Core::sb_jam_T1, &M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::ph_5_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //0
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1,//1
+&M6502Core::jsr_5_3_T1,&M6502Core::idx_2_4_T1,&M6502Core::sb_jam_T1, &M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::pl_5_2_T1,&M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //2
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1,//3
+&M6502Core::rti_5_5_T1,&M6502Core::idx_2_4_T1,&M6502Core::sb_jam_T1, &M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::ph_5_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs5_6_1_T1,&M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //4
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1,//5
+&M6502Core::rts_5_7_T1,&M6502Core::idx_2_4_T1,&M6502Core::sb_jam_T1, &M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::pl_5_2_T1,&M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs5_6_2_T1,&M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //6
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1,//7
+&M6502Core::imm_2_1_T1,&M6502Core::idx_3_3_T1,&M6502Core::imm_2_1_T1,&M6502Core::idx_3_3_T1,  &M6502Core::zp_3_1_T1, &M6502Core::zp_3_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_3_1_T1, &M6502Core::sb_1_T1,  &M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_3_2_T1, &M6502Core::abs_3_2_T1, &M6502Core::abs_3_2_T1, &M6502Core::abs_3_2_T1, //8
+&M6502Core::rel_5_8_T1,&M6502Core::idy_3_6_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_3_6_T1,  &M6502Core::zpx_3_5_T1,&M6502Core::zpx_3_5_T1,&M6502Core::zpy_3_5_T1,&M6502Core::zpy_3_5_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_3_4_T1,&M6502Core::sb_1_T1,&M6502Core::absy_3_4_T1,&M6502Core::absx_3_4_T1,&M6502Core::absx_3_4_T1,&M6502Core::absy_3_4_T1,&M6502Core::absy_3_4_T1,//9
+&M6502Core::imm_2_1_T1,&M6502Core::idx_2_4_T1,&M6502Core::imm_2_1_T1,&M6502Core::idx_2_4_T1,  &M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::sb_1_T1,  &M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, //A
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_2_7_T1,  &M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpy_2_6_T1,&M6502Core::zpy_2_6_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absy_2_5_T1,&M6502Core::absy_2_5_T1,//B
+&M6502Core::imm_2_1_T1,&M6502Core::idx_2_4_T1,&M6502Core::imm_2_1_T1,&M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::sb_1_T1,  &M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //C
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1,//D
+&M6502Core::imm_2_1_T1,&M6502Core::idx_2_4_T1,&M6502Core::imm_2_1_T1,&M6502Core::idx_Undoc_T1,&M6502Core::zp_2_1_T1, &M6502Core::zp_2_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::zp_4_1_T1, &M6502Core::sb_1_T1,  &M6502Core::imm_2_1_T1, &M6502Core::sb_1_T1,&M6502Core::imm_2_1_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_2_3_T1, &M6502Core::abs_4_2_T1, &M6502Core::abs_4_2_T1, //E
+&M6502Core::rel_5_8_T1,&M6502Core::idy_2_7_T1,&M6502Core::sb_jam_T1, &M6502Core::idy_Undoc_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_2_6_T1,&M6502Core::zpx_4_3_T1,&M6502Core::zpx_4_3_T1,&M6502Core::sb_1_T1,  &M6502Core::absy_2_5_T1,&M6502Core::sb_1_T1,&M6502Core::absy_4_4_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_2_5_T1,&M6502Core::absx_4_4_T1,&M6502Core::absx_4_4_T1 //F
 };
 
-void M6502::ADC(void)
+template <class Bus>
+void M6502Core<Bus>::ADC(void)
 {
 	u16 result;
 
@@ -87,7 +91,8 @@ void M6502::ADC(void)
 	a = (u8)result;
 }
 
-void M6502::ARR(void)
+template <class Bus>
+void M6502Core<Bus>::ARR(void)
 {
 	u16 result = a & value;
 	u16 carry = status & FLAG_CARRY;
@@ -122,7 +127,8 @@ void M6502::ARR(void)
 	}
 }
 
-void M6502::SBC(void)
+template <class Bus>
+void M6502Core<Bus>::SBC(void)
 {
 	u16 result = a - value - ((status & FLAG_CARRY) ? 0 : 1);
 	if (status & FLAG_DECIMAL)
@@ -146,14 +152,15 @@ void M6502::SBC(void)
 	}
 }
 
-void M6502::absx_2_5_T3(void)
+template <class Bus>
+void M6502Core<Bus>::absx_2_5_T3(void)
 {
 	u16 startpage = ea & 0xFF00;
 	ea += x;
 	if (startpage != (ea & 0xFF00))
 	{
 		BUS_READ(startpage | (ea & 0xff));
-		addressModeCycleFn = &M6502::absx_2_5_T4;
+		addressModeCycleFn = &M6502Core::absx_2_5_T4;
 	}
 	else
 	{
@@ -162,14 +169,15 @@ void M6502::absx_2_5_T3(void)
 	}
 }
 
-void M6502::absy_2_5_T3(void)
+template <class Bus>
+void M6502Core<Bus>::absy_2_5_T3(void)
 {
 	u16 startpage = ea & 0xFF00;
 	ea += y;
 	if (startpage != (ea & 0xFF00))
 	{
 		BUS_READ(startpage | (ea & 0xff));
-		addressModeCycleFn = &M6502::absy_2_5_T4;
+		addressModeCycleFn = &M6502Core::absy_2_5_T4;
 	}
 	else
 	{
@@ -178,14 +186,15 @@ void M6502::absy_2_5_T3(void)
 	}
 }
 
-void M6502::idy_2_7_T4(void)
+template <class Bus>
+void M6502Core<Bus>::idy_2_7_T4(void)
 {
 	u16 startpage = ea & 0xFF00;
 	ea += y;
 	if (startpage != (ea & 0xFF00))
 	{
 		BUS_READ(startpage | (ea & 0xff));
-		addressModeCycleFn = &M6502::idy_2_7_T5;
+		addressModeCycleFn = &M6502Core::idy_2_7_T5;
 	}
 	else
 	{
@@ -194,24 +203,26 @@ void M6502::idy_2_7_T4(void)
 	}
 }
 
-void M6502::rel_5_8_T2(void)
+template <class Bus>
+void M6502Core<Bus>::rel_5_8_T2(void)
 {
 	BUS_READ(oldpc);
 	pc = oldpc + ra;
 	if ((oldpc & 0xFF00) == (pc & 0xFF00))
 	{
 		BranchTakenMaskingInterrupt = true;
-		addressModeCycleFn = &M6502::InstructionFetch;	// Opcode has already been executed in T1 so just move on to the next instruction.
+		addressModeCycleFn = &M6502Core::InstructionFetch;	// Opcode has already been executed in T1 so just move on to the next instruction.
 	}
 	else
 	{
-		addressModeCycleFn = &M6502::rel_5_8_T3;
+		addressModeCycleFn = &M6502Core::rel_5_8_T3;
 	}
 }
 
 // When executing a BRK and an interrupt condition is triggered between T0 and T4 the BRK morphs into the interrupt instruction.
 // We check here if we continue on executing the BRK or morph and take the interrupt.
-void M6502::brk_5_4_T4(void)
+template <class Bus>
+void M6502Core<Bus>::brk_5_4_T4(void)
 {
 #ifdef  SUPPORT_NMI
 	if (NMIPending)
@@ -230,7 +241,7 @@ void M6502::brk_5_4_T4(void)
 	}
 #endif
 	Push(status | FLAG_CONSTANT | FLAG_BREAK);
-	addressModeCycleFn = &M6502::brk_5_4_T5;
+	addressModeCycleFn = &M6502Core::brk_5_4_T5;
 }
 
 // It is possible for a BRK/IRQ to mask a NMI for short burts of NMI assertions.
@@ -240,7 +251,8 @@ void M6502::brk_5_4_T4(void)
 // If the NMI now un-asserts between now and the end of IRQ_T6 it will be missed/masked.
 // The ability for a BRK/IRQ to turn into a NMI shows how the designers of the 6502 anticipated this masking and kept it to a minimum of only four 1/2 cycles!
 // But then again, perhpas not, as a NMI that asserts after IRQ_T4 and remains asserted will not be processed until the first instruction of the IRQ routine has completed (see InstructionFetchIRQ).
-void M6502::IRQ_T4(void)
+template <class Bus>
+void M6502Core<Bus>::IRQ_T4(void)
 {
 #ifdef  SUPPORT_NMI
 	if (NMIPending)
@@ -252,25 +264,26 @@ void M6502::IRQ_T4(void)
 #endif
 	ClearB();
 	Push(status);
-	addressModeCycleFn = &M6502::IRQ_T5;
+	addressModeCycleFn = &M6502Core::IRQ_T5;
 }
 
 // Interrupts are polled before starting a new instruction
 // T0 of every address mode (except reset).
-void M6502::InstructionFetch()
+template <class Bus>
+void M6502Core<Bus>::InstructionFetch()
 {
 	opcode = BUS_READ(pc);	// Technically the InstructionFetch cycle T0 is part of the previous instruction's execution and the check for interrupts occurs after this fetch.
 
 #ifdef  SUPPORT_NMI
 	if (NMIPending)
-		addressModeCycleFn = &M6502::NMI_T1;
+		addressModeCycleFn = &M6502Core::NMI_T1;
 	else
 #endif //  SUPPORT_NMI
 #ifdef  SUPPORT_IRQ
 	if (IRQPending && !IRQDisabled())
 	{
 		IRQPending = 0;
-		addressModeCycleFn = &M6502::IRQ_T1;
+		addressModeCycleFn = &M6502Core::IRQ_T1;
 	}
 	else
 #endif //  SUPPORT_IRQ
@@ -284,7 +297,8 @@ void M6502::InstructionFetch()
 #ifdef  SUPPORT_IRQ
 // If a NMI asserts too late during the IRQ execution ie after IRQ_T4 then it must wait one more instruction. So no polling is performed during this fetch.
 // This is an idiosyncrasy of the real hardware and will be emulated using this fuction.
-void M6502::InstructionFetchIRQ()
+template <class Bus>
+void M6502Core<Bus>::InstructionFetchIRQ()
 {
 	opcode = BUS_READ(pc++);	// T0
 	addressModeCycleFn = T1AddressModeFunctions[opcode];
@@ -296,42 +310,24 @@ void M6502::InstructionFetchIRQ()
 // On a real 6502, interrupts can be asserted between 1/2 cycles. When this occurs the hardware effectively ignores it for a further 1/2 cycle anyway.
 // Here, interrupts are polled at the start of a cycle (in an instruction fetch cycle) emulating this behaviour.
 // High frequency (1/2 cycle) bursts of interrupts assertions and un-assertions occuring mid full cycle will be missed by the hardware anyway.
-void M6502::Step(void)
+template <class Bus>
+void M6502Core<Bus>::Step(void)
 {
-	bool irq;
-
-	// If an IRQ occurs during a CLI then it will not take effect until the instruction after the CLI has been executed.
-	// To emulate this, CLI simply sets CLIMaskingInterrupt flag.
-	// Similar behaviour can be witnessed with the 3 cycle branch taken instruction.
-#ifdef  SUPPORT_IRQ
-	irq = IRQ.IsAsserted();
-	if (irq && ((status & FLAG_INTERRUPT) == 0) && !CLIMaskingInterrupt && !BranchTakenMaskingInterrupt)
-		IRQPending = 1;
-	if (!irq)
-		IRQPending = 0;
-#endif //  SUPPORT_IRQ
-
-#ifdef  SUPPORT_NMI
-	NMIPending = NMI.IsAsserted() && !CLIMaskingInterrupt && !BranchTakenMaskingInterrupt;
-#endif //  SUPPORT_NMI
-
-	if (CLIMaskingInterrupt)	// If so we have delayed the IRQ long enough for the next instruction to now start. The CLI will then take effect after that instruction completes executing.
-		CLIMaskingInterrupt = false;
-	if (BranchTakenMaskingInterrupt)	// If so we have delayed the IRQ long enough for the next instruction to now start.
-		BranchTakenMaskingInterrupt = false;
+	PollInterrupts();
 
 #ifdef  SUPPORT_RDY_HALTING
 	if (!Halted())
 	{
 		CheckForHalt();
-		(this->*M6502::addressModeCycleFn)();
+		(this->*M6502Core::addressModeCycleFn)();
 	}
 #else
-	(this->*M6502::addressModeCycleFn)();
+	(this->*M6502Core::addressModeCycleFn)();
 #endif //  SUPPORT_RDY_HALTING
 }
 
-void M6502::Reset(void)
+template <class Bus>
+void M6502Core<Bus>::Reset(void)
 {
 	CLIMaskingInterrupt = false;
 	BranchTakenMaskingInterrupt = false;
@@ -352,14 +348,16 @@ void M6502::Reset(void)
 }
 
 #ifdef  SUPPORT_RDY_HALTING
-void M6502::RDY(bool asserted)
+template <class Bus>
+void M6502Core<Bus>::RDY(bool asserted)
 {
 	if (asserted && (RDYHalted == 0)) RDYCounter = 3;
 	RDYAsserted = asserted;
 	if (RDYHalted && !asserted) RDYHalted = 0;
 }
 
-void M6502::CheckForHalt()
+template <class Bus>
+void M6502Core<Bus>::CheckForHalt()
 {
 	if ((RDYHalted == 0) && RDYAsserted && RDYCounter)
 	{
@@ -368,9 +366,14 @@ void M6502::CheckForHalt()
 	}
 }
 
-u8 M6502::BusRead(u16 address)
+template <class Bus>
+u8 M6502Core<Bus>::BusRead(u16 address)
 {
 	if ((RDYHalted == 0) && RDYAsserted) RDYHalted = 1;
-	return dataBusReadFn(address);
+	return bus.Read(address);
 }
 #endif //  SUPPORT_RDY_HALTING
+
+// Instantiate the CPU for the buses it is used with.
+template class M6502Core<M6502FunctionBus>;
+template class M6502Core<BusPageTable>;
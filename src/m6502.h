@@ -68,8 +68,9 @@
 #ifdef  SUPPORT_RDY_HALTING
 #define BUS_READ BusRead
 #else
-#define BUS_READ dataBusReadFn
+#define BUS_READ bus.Read
 #endif //  SUPPORT_RDY_HALTING
+#define BUS_WRITE bus.Write
 
 //#define SUPPORT_NMI		// Some devices don't use the NMI eg Commodore 1541
 #define SUPPORT_IRQ		// Some devices don't use IRQ eg Atari 7800
@@ -87,13 +88,26 @@
 	{											\
 		oldpc = pc;								\
 		pc = (pc & 0xff00) | ((pc + ra) & 0xff);\
-		addressModeCycleFn = &M6502::rel_5_8_T2;\
+		addressModeCycleFn = &M6502Core::rel_5_8_T2;\
 	}											\
-	else addressModeCycleFn = &M6502::InstructionFetch;
+	else addressModeCycleFn = &M6502Core::InstructionFetch;
 
 typedef u8(*DataBusReadFn)(u16 address);
 typedef void(*DataBusWriteFn)(u16 address, const u8 value);
 
+// The bus used by M6502. Calls the externally supplied read and write functions.
+class M6502FunctionBus
+{
+public:
+	M6502FunctionBus() : readFn(0), writeFn(0) {}
+
+	inline u8 Read(u16 address) { return readFn(address); }
+	inline void Write(u16 address, const u8 value) { writeFn(address, value); }
+
+	DataBusReadFn readFn;	// A pointer to the externally supplied Data Bus read function.
+	DataBusWriteFn writeFn;	// A pointer to the externally supplied Data Bus write function.
+};
+
 #if defined(SUPPORT_IRQ) || defined(SUPPORT_NMI)
 class Interrupt
 {
@@ -108,9 +122,16 @@ private:
 };
 #endif //  SUPPORT_IRQ
 
-class M6502
+// The CPU is templated on its bus so that when the bus is known at compile time its reads and writes inline into the cycle functions.
+// A Bus needs to provide;-
+//   u8 Read(u16 address)
+//   void Write(u16 address, const u8 value)
+template <class Bus>
+class M6502Core
 {
-private:
+protected:
+	Bus bus;
+
 	enum
 	{
 		FLAG_CARRY = 0x01,
@@ -123,9 +144,9 @@ private:
 		FLAG_SIGN = 0x80
 	};
 
-	typedef void (M6502::*AddressModeCycleFunction)(void);	// Member function pointers for the starting cycle of the address mode functions.
+	typedef void (M6502Core::*AddressModeCycleFunction)(void);	// Member function pointers for the starting cycle of the address mode functions.
 	static AddressModeCycleFunction T1AddressModeFunctions[256];
-	typedef void (M6502::*OpcodeCycleFunction)(void);		// Member function pointers for the opcodes.
+	typedef void (M6502Core::*OpcodeCycleFunction)(void);		// Member function pointers for the opcodes.
 	static OpcodeCycleFunction opcodeFunctions[256];
 
 	union
@@ -164,23 +185,20 @@ private:
 	u8 RDYHalted : 1;
 #endif //  SUPPORT_RDY_HALTING
 
-	DataBusReadFn dataBusReadFn;	// A pointer to the externally supplied Data Bus read function.
-	DataBusWriteFn dataBusWriteFn;	// A pointer to the externally supplied Data Bus write function.
-
 	AddressModeCycleFunction addressModeCycleFn;	// Our pointer to the function that will process the current address mode functionality for the current cycle.
 	OpcodeCycleFunction opcodeCycleFn;				// Our pointer to the function that will be called after (or during) the address mode cycle(s) that execute the actual opcode.
 
-	inline void ExecuteOpcode(void) { (this->*M6502::opcodeCycleFn)(); addressModeCycleFn = &M6502::InstructionFetch; } // Helper function to call opcodeCycleFn and set up for the next instruction fetch. 
+	inline void ExecuteOpcode(void) { (this->*M6502Core::opcodeCycleFn)(); addressModeCycleFn = &M6502Core::InstructionFetch; } // Helper function to call opcodeCycleFn and set up for the next instruction fetch. 
 
 	// Stack manipulation helpers.
-	inline void Push(u8 val) { dataBusWriteFn(0x100 + sp--, val); }
-	inline u8 Pull(void) { return (dataBusReadFn(0x100 + ++sp)); }
+	inline void Push(u8 val) { BUS_WRITE(0x100 + sp--, val); }
+	inline u8 Pull(void) { return (BUS_READ(0x100 + ++sp)); }
 
 	// Helper function to write back the results of an instruction (to memory or the A register).
 	inline void WriteValue(u8 byte)
 	{
-		if (addressModeCycleFn == &M6502::sb_1_T1) a = byte;
-		else dataBusWriteFn(ea, byte);
+		if (addressModeCycleFn == &M6502Core::sb_1_T1) a = byte;
+		else BUS_WRITE(ea, byte);
 	}
 
 	void InstructionFetch();	// T0 of every address mode (except reset).
@@ -280,199 +298,199 @@ private:
 
 	void imm_2_1_T1(void) { value = BUS_READ(pc++); ExecuteOpcode(); } //2 cycles
 	
-	void rel_5_8_T1(void) { (this->*M6502::opcodeCycleFn)(); } // Branch instructions are the anomaly and execute their opcode in T1.
+	void rel_5_8_T1(void) { (this->*M6502Core::opcodeCycleFn)(); } // Branch instructions are the anomaly and execute their opcode in T1.
 	void rel_5_8_T2(void);
-	void rel_5_8_T3(void) { BUS_READ(pc); addressModeCycleFn = &M6502::InstructionFetch; } // Opcode has already been executed in T1 so just move on to the next instruction.
+	void rel_5_8_T3(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::InstructionFetch; } // Opcode has already been executed in T1 so just move on to the next instruction.
 
-	void zp_2_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zp_2_1_T2; } //3 cycles
+	void zp_2_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zp_2_1_T2; } //3 cycles
 	void zp_2_1_T2(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void zp_3_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zp_3_1_T2; } //3 cycles
+	void zp_3_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zp_3_1_T2; } //3 cycles
 	void zp_3_1_T2(void) { ExecuteOpcode(); }
 
-	void abs_2_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::abs_2_3_T2; } //4 cycles
-	void abs_2_3_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::abs_2_3_T3; }
+	void abs_2_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::abs_2_3_T2; } //4 cycles
+	void abs_2_3_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::abs_2_3_T3; }
 	void abs_2_3_T3(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void abs_3_2_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::abs_3_2_T2; } //4 cycles
-	void abs_3_2_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::abs_3_2_T3; }
+	void abs_3_2_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::abs_3_2_T2; } //4 cycles
+	void abs_3_2_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::abs_3_2_T3; }
 	void abs_3_2_T3(void) { ExecuteOpcode(); }
 
-	void idx_2_4_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idx_2_4_T2; } //6 cycles
-	void idx_2_4_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502::idx_2_4_T3; }
-	void idx_2_4_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idx_2_4_T4; }
-	void idx_2_4_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idx_2_4_T5; }
+	void idx_2_4_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idx_2_4_T2; } //6 cycles
+	void idx_2_4_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502Core::idx_2_4_T3; }
+	void idx_2_4_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idx_2_4_T4; }
+	void idx_2_4_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idx_2_4_T5; }
 	void idx_2_4_T5(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void idx_3_3_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idx_3_3_T2; } //6 cycles
-	void idx_3_3_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502::idx_3_3_T3; }
-	void idx_3_3_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idx_3_3_T4; }
-	void idx_3_3_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idx_3_3_T5; }
+	void idx_3_3_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idx_3_3_T2; } //6 cycles
+	void idx_3_3_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502Core::idx_3_3_T3; }
+	void idx_3_3_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idx_3_3_T4; }
+	void idx_3_3_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idx_3_3_T5; }
 	void idx_3_3_T5(void) { ExecuteOpcode(); }
 
 	// idx_Undoc behaviour was determined by capturing bus activity on a real 6502 in a 1541 and confirmed by observing Visual6502.
-	void idx_Undoc_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idx_Undoc_T2; } //8 cycles
-	void idx_Undoc_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502::idx_Undoc_T3; }
-	void idx_Undoc_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idx_Undoc_T4; }
-	void idx_Undoc_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idx_Undoc_T5; }
-	void idx_Undoc_T5(void) { value = BUS_READ(ea);  addressModeCycleFn = &M6502::idx_Undoc_T6; }
-	void idx_Undoc_T6(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::idx_Undoc_T7; }
+	void idx_Undoc_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idx_Undoc_T2; } //8 cycles
+	void idx_Undoc_T2(void) { BUS_READ(ia); addressModeCycleFn = &M6502Core::idx_Undoc_T3; }
+	void idx_Undoc_T3(void) { ia = (ia + x) & 0xff; ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idx_Undoc_T4; }
+	void idx_Undoc_T4(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idx_Undoc_T5; }
+	void idx_Undoc_T5(void) { value = BUS_READ(ea);  addressModeCycleFn = &M6502Core::idx_Undoc_T6; }
+	void idx_Undoc_T6(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::idx_Undoc_T7; }
 	void idx_Undoc_T7(void) { ExecuteOpcode(); }
 
-	void absx_2_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absx_2_5_T2; } //4/5 cycles
-	void absx_2_5_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absx_2_5_T3; }
+	void absx_2_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absx_2_5_T2; } //4/5 cycles
+	void absx_2_5_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absx_2_5_T3; }
 	void absx_2_5_T3(void);
 	void absx_2_5_T4(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void absx_3_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absx_3_4_T2; } //5 cycles
-	void absx_3_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absx_3_4_T3; }
-	void absx_3_4_T3(void) { BUS_READ(ea); ea += x; addressModeCycleFn = &M6502::absx_3_4_T4; }
+	void absx_3_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absx_3_4_T2; } //5 cycles
+	void absx_3_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absx_3_4_T3; }
+	void absx_3_4_T3(void) { BUS_READ(ea); ea += x; addressModeCycleFn = &M6502Core::absx_3_4_T4; }
 	void absx_3_4_T4(void) { ExecuteOpcode(); }
 
-	void absy_2_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absy_2_5_T2; } //4/5 cycles
-	void absy_2_5_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absy_2_5_T3; }
+	void absy_2_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absy_2_5_T2; } //4/5 cycles
+	void absy_2_5_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absy_2_5_T3; }
 	void absy_2_5_T3(void);
 	void absy_2_5_T4(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void absy_3_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absy_3_4_T2; } //5 cycles
-	void absy_3_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absy_3_4_T3; }
-	void absy_3_4_T3(void) { BUS_READ(ea); ea += y; addressModeCycleFn = &M6502::absy_3_4_T4; }
+	void absy_3_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absy_3_4_T2; } //5 cycles
+	void absy_3_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absy_3_4_T3; }
+	void absy_3_4_T3(void) { BUS_READ(ea); ea += y; addressModeCycleFn = &M6502Core::absy_3_4_T4; }
 	void absy_3_4_T4(void) { ExecuteOpcode(); }
 
-	void zpx_2_6_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zpx_2_6_T2; } //4 cycles
-	void zpx_2_6_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502::zpx_2_6_T3; }
+	void zpx_2_6_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zpx_2_6_T2; } //4 cycles
+	void zpx_2_6_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502Core::zpx_2_6_T3; }
 	void zpx_2_6_T3(void) { ea = (ea + x) & 0xFF; value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void zpx_3_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zpx_3_5_T2; } //4 cycles
-	void zpx_3_5_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502::zpx_3_5_T3; }
+	void zpx_3_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zpx_3_5_T2; } //4 cycles
+	void zpx_3_5_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502Core::zpx_3_5_T3; }
 	void zpx_3_5_T3(void) { ea = (ea + x) & 0xFF; ExecuteOpcode(); }
 
-	void zpy_2_6_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zpy_2_6_T2; } //4 cycles
-	void zpy_2_6_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502::zpy_2_6_T3; }
+	void zpy_2_6_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zpy_2_6_T2; } //4 cycles
+	void zpy_2_6_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502Core::zpy_2_6_T3; }
 	void zpy_2_6_T3(void) { ea = (ea + y) & 0xFF; value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void zpy_3_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zpy_3_5_T2; } //4 cycles
-	void zpy_3_5_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502::zpy_3_5_T3; }
+	void zpy_3_5_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zpy_3_5_T2; } //4 cycles
+	void zpy_3_5_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502Core::zpy_3_5_T3; }
 	void zpy_3_5_T3(void) { ea = (ea + y) & 0xFF; ExecuteOpcode(); }
 
-	void idy_2_7_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idy_2_7_T2; } //5/6 cycles
-	void idy_2_7_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idy_2_7_T3; }
-	void idy_2_7_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idy_2_7_T4; }
+	void idy_2_7_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idy_2_7_T2; } //5/6 cycles
+	void idy_2_7_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idy_2_7_T3; }
+	void idy_2_7_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idy_2_7_T4; }
 	void idy_2_7_T4(void);
 	void idy_2_7_T5(void) { value = BUS_READ(ea); ExecuteOpcode(); }
 
-	void idy_3_6_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idy_3_6_T2; } //6 cycles
-	void idy_3_6_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idy_3_6_T3; }
-	void idy_3_6_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idy_3_6_T4; }
-	void idy_3_6_T4(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502::idy_3_6_T5; }
+	void idy_3_6_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idy_3_6_T2; } //6 cycles
+	void idy_3_6_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idy_3_6_T3; }
+	void idy_3_6_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idy_3_6_T4; }
+	void idy_3_6_T4(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502Core::idy_3_6_T5; }
 	void idy_3_6_T5(void) { ExecuteOpcode(); }
 
 	// idy_Undoc behaviour was determined by capturing bus activity on a real 6502 in a 1541 and confirmed by Visual6502.
-	void idy_Undoc_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::idy_Undoc_T2; } //8 cycles
-	void idy_Undoc_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502::idy_Undoc_T3; }
-	void idy_Undoc_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502::idy_Undoc_T4; }
-	void idy_Undoc_T4(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502::idy_Undoc_T5; }
-	void idy_Undoc_T5(void) { value = BUS_READ(ea);  addressModeCycleFn = &M6502::idy_Undoc_T6; }
-	void idy_Undoc_T6(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::idy_Undoc_T7; }
+	void idy_Undoc_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::idy_Undoc_T2; } //8 cycles
+	void idy_Undoc_T2(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::idy_Undoc_T3; }
+	void idy_Undoc_T3(void) { ea |= (BUS_READ(ia & 0xff) << 8); addressModeCycleFn = &M6502Core::idy_Undoc_T4; }
+	void idy_Undoc_T4(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502Core::idy_Undoc_T5; }
+	void idy_Undoc_T5(void) { value = BUS_READ(ea);  addressModeCycleFn = &M6502Core::idy_Undoc_T6; }
+	void idy_Undoc_T6(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::idy_Undoc_T7; }
 	void idy_Undoc_T7(void) { ExecuteOpcode(); }
 
-	void zp_4_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zp_4_1_T2; } //5 cycles
-	void zp_4_1_T2(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502::zp_4_1_T3; }
-	void zp_4_1_T3(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::zp_4_1_T4; }
+	void zp_4_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zp_4_1_T2; } //5 cycles
+	void zp_4_1_T2(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502Core::zp_4_1_T3; }
+	void zp_4_1_T3(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::zp_4_1_T4; }
 	void zp_4_1_T4(void) { ExecuteOpcode(); }
 
-	void abs_4_2_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::abs_4_2_T2; } //6 cycles
-	void abs_4_2_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::abs_4_2_T3; }
-	void abs_4_2_T3(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502::abs_4_2_T4; }
-	void abs_4_2_T4(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::abs_4_2_T5; }
+	void abs_4_2_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::abs_4_2_T2; } //6 cycles
+	void abs_4_2_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::abs_4_2_T3; }
+	void abs_4_2_T3(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502Core::abs_4_2_T4; }
+	void abs_4_2_T4(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::abs_4_2_T5; }
 	void abs_4_2_T5(void) { ExecuteOpcode(); }
 
-	void zpx_4_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::zpx_4_3_T2; } //6 cycles
-	void zpx_4_3_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502::zpx_4_3_T3; }
-	void zpx_4_3_T3(void) { ea = (ea + x) & 0xFF; value = BUS_READ(ea); addressModeCycleFn = &M6502::zpx_4_3_T4; }
-	void zpx_4_3_T4(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::zpx_4_3_T5; }
+	void zpx_4_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::zpx_4_3_T2; } //6 cycles
+	void zpx_4_3_T2(void) { BUS_READ(ea); addressModeCycleFn = &M6502Core::zpx_4_3_T3; }
+	void zpx_4_3_T3(void) { ea = (ea + x) & 0xFF; value = BUS_READ(ea); addressModeCycleFn = &M6502Core::zpx_4_3_T4; }
+	void zpx_4_3_T4(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::zpx_4_3_T5; }
 	void zpx_4_3_T5(void) { ExecuteOpcode(); }
 
-	void absx_4_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absx_4_4_T2; } //7 cycles
-	void absx_4_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absx_4_4_T3; }
-	void absx_4_4_T3(void) { ea += x; BUS_READ(ea); addressModeCycleFn = &M6502::absx_4_4_T4; }
-	void absx_4_4_T4(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502::absx_4_4_T5; }
-	void absx_4_4_T5(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::absx_4_4_T6; }
+	void absx_4_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absx_4_4_T2; } //7 cycles
+	void absx_4_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absx_4_4_T3; }
+	void absx_4_4_T3(void) { ea += x; BUS_READ(ea); addressModeCycleFn = &M6502Core::absx_4_4_T4; }
+	void absx_4_4_T4(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502Core::absx_4_4_T5; }
+	void absx_4_4_T5(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::absx_4_4_T6; }
 	void absx_4_4_T6(void) { ExecuteOpcode(); }
 
-	void absy_4_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::absy_4_4_T2; } //7 cycles
-	void absy_4_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::absy_4_4_T3; }
-	void absy_4_4_T3(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502::absy_4_4_T4; }
-	void absy_4_4_T4(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502::absy_4_4_T5; }
-	void absy_4_4_T5(void) { dataBusWriteFn(ea, (u8)value); addressModeCycleFn = &M6502::absy_4_4_T6; }
+	void absy_4_4_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::absy_4_4_T2; } //7 cycles
+	void absy_4_4_T2(void) { ea |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::absy_4_4_T3; }
+	void absy_4_4_T3(void) { ea += y; BUS_READ(ea); addressModeCycleFn = &M6502Core::absy_4_4_T4; }
+	void absy_4_4_T4(void) { value = BUS_READ(ea); addressModeCycleFn = &M6502Core::absy_4_4_T5; }
+	void absy_4_4_T5(void) { BUS_WRITE(ea, (u8)value); addressModeCycleFn = &M6502Core::absy_4_4_T6; }
 	void absy_4_4_T6(void) { ExecuteOpcode(); }
 
-	void ph_5_1_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502::ph_5_1_T2; } //3 cycles
+	void ph_5_1_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::ph_5_1_T2; } //3 cycles
 	void ph_5_1_T2(void) { ExecuteOpcode(); }
 
-	void pl_5_2_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502::pl_5_2_T2; } //4 cycles
-	void pl_5_2_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502::pl_5_2_T3; }
+	void pl_5_2_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::pl_5_2_T2; } //4 cycles
+	void pl_5_2_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502Core::pl_5_2_T3; }
 	void pl_5_2_T3(void) { ExecuteOpcode(); }
 
-	void jsr_5_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::jsr_5_3_T2; } //6 cycles
-	void jsr_5_3_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502::jsr_5_3_T3; }
-	void jsr_5_3_T3(void) { Push((u8)((pc) >> 8)); addressModeCycleFn = &M6502::jsr_5_3_T4; }
-	void jsr_5_3_T4(void) { Push(pc & 0xff); addressModeCycleFn = &M6502::jsr_5_3_T5; }
+	void jsr_5_3_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::jsr_5_3_T2; } //6 cycles
+	void jsr_5_3_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502Core::jsr_5_3_T3; }
+	void jsr_5_3_T3(void) { Push((u8)((pc) >> 8)); addressModeCycleFn = &M6502Core::jsr_5_3_T4; }
+	void jsr_5_3_T4(void) { Push(pc & 0xff); addressModeCycleFn = &M6502Core::jsr_5_3_T5; }
 	void jsr_5_3_T5(void) { ea |= (BUS_READ(pc++) << 8); pc = ea; ExecuteOpcode(); }
 
-	void rti_5_5_T1(void) { BUS_READ(pc++); addressModeCycleFn = &M6502::rti_5_5_T2; } //6 cycles
-	void rti_5_5_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502::rti_5_5_T3; }
-	void rti_5_5_T3(void) { status = Pull(); addressModeCycleFn = &M6502::rti_5_5_T4; }
-	void rti_5_5_T4(void) { pc = Pull(); addressModeCycleFn = &M6502::rti_5_5_T5; }
+	void rti_5_5_T1(void) { BUS_READ(pc++); addressModeCycleFn = &M6502Core::rti_5_5_T2; } //6 cycles
+	void rti_5_5_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502Core::rti_5_5_T3; }
+	void rti_5_5_T3(void) { status = Pull(); addressModeCycleFn = &M6502Core::rti_5_5_T4; }
+	void rti_5_5_T4(void) { pc = Pull(); addressModeCycleFn = &M6502Core::rti_5_5_T5; }
 	void rti_5_5_T5(void) { pc |= (Pull() << 8); ExecuteOpcode(); }
 
-	void abs5_6_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502::abs5_6_1_T2; } //3 cycles
+	void abs5_6_1_T1(void) { ea = BUS_READ(pc++); addressModeCycleFn = &M6502Core::abs5_6_1_T2; } //3 cycles
 	void abs5_6_1_T2(void) { ea |= (BUS_READ(pc++) << 8); ExecuteOpcode(); }
 
-	void abs5_6_2_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502::abs5_6_2_T2; } //5 cycles
-	void abs5_6_2_T2(void) { ia |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502::abs5_6_2_T3; }
-	void abs5_6_2_T3(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502::abs5_6_2_T4; }
+	void abs5_6_2_T1(void) { ia = BUS_READ(pc++); addressModeCycleFn = &M6502Core::abs5_6_2_T2; } //5 cycles
+	void abs5_6_2_T2(void) { ia |= (BUS_READ(pc++) << 8); addressModeCycleFn = &M6502Core::abs5_6_2_T3; }
+	void abs5_6_2_T3(void) { ea = BUS_READ(ia++); addressModeCycleFn = &M6502Core::abs5_6_2_T4; }
 	void abs5_6_2_T4(void) { ea |= (BUS_READ(ia) << 8); ExecuteOpcode(); }
 
-	void rts_5_7_T1(void) { BUS_READ(pc++); addressModeCycleFn = &M6502::rts_5_7_T2; } //6 cycles
-	void rts_5_7_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502::rts_5_7_T3; }
-	void rts_5_7_T3(void) { pc = Pull(); addressModeCycleFn = &M6502::rts_5_7_T4; }
-	void rts_5_7_T4(void) { pc |= (Pull() << 8); addressModeCycleFn = &M6502::rts_5_7_T5; }
+	void rts_5_7_T1(void) { BUS_READ(pc++); addressModeCycleFn = &M6502Core::rts_5_7_T2; } //6 cycles
+	void rts_5_7_T2(void) { BUS_READ(0x100 + sp); addressModeCycleFn = &M6502Core::rts_5_7_T3; }
+	void rts_5_7_T3(void) { pc = Pull(); addressModeCycleFn = &M6502Core::rts_5_7_T4; }
+	void rts_5_7_T4(void) { pc |= (Pull() << 8); addressModeCycleFn = &M6502Core::rts_5_7_T5; }
 	void rts_5_7_T5(void) { BUS_READ(pc); pc++; ExecuteOpcode(); }
 
 	// The BRK, RESET, NMI and IRQ instructions are closely related.
 	// At T4 BRK can morph into one of the interrupts if that interrupt condition has subsequently occurred since the instruction started.
-	void brk_5_4_T1(void) { BUS_READ(pc); pc++; addressModeCycleFn = &M6502::brk_5_4_T2; } //7 cycles
-	void brk_5_4_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502::brk_5_4_T3; }
-	void brk_5_4_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502::brk_5_4_T4; }
+	void brk_5_4_T1(void) { BUS_READ(pc); pc++; addressModeCycleFn = &M6502Core::brk_5_4_T2; } //7 cycles
+	void brk_5_4_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502Core::brk_5_4_T3; }
+	void brk_5_4_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502Core::brk_5_4_T4; }
 	void brk_5_4_T4(void); // We check here if we continue on executing the BRK or take the interrupt.
-	void brk_5_4_T5(void) { ea = BUS_READ(0xFFFE); addressModeCycleFn = &M6502::brk_5_4_T6; } // Short burts of interrupt assertions will be correctly masked by the BRK in these 2 cycles.
+	void brk_5_4_T5(void) { ea = BUS_READ(0xFFFE); addressModeCycleFn = &M6502Core::brk_5_4_T6; } // Short burts of interrupt assertions will be correctly masked by the BRK in these 2 cycles.
 	void brk_5_4_T6(void) { SetI(); pc = ea | (BUS_READ(0xFFFF) << 8); ExecuteOpcode(); }
 
-	void Reset_T0(void) { sp = 0; BUS_READ(pc);	addressModeCycleFn = &M6502::Reset_T1; } //7 cycles
-	void Reset_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502::Reset_T2; }
-	void Reset_T2(void) { BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502::Reset_T3; }
-	void Reset_T3(void) { BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502::Reset_T4; }
-	void Reset_T4(void) { ClearB(); BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502::Reset_T5; }
-	void Reset_T5(void) { ea = BUS_READ(0xFFFC); addressModeCycleFn = &M6502::Reset_T6; }
-	void Reset_T6(void) { pc = ea | (BUS_READ(0xFFFD) << 8); addressModeCycleFn = &M6502::InstructionFetch; }
+	void Reset_T0(void) { sp = 0; BUS_READ(pc);	addressModeCycleFn = &M6502Core::Reset_T1; } //7 cycles
+	void Reset_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::Reset_T2; }
+	void Reset_T2(void) { BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502Core::Reset_T3; }
+	void Reset_T3(void) { BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502Core::Reset_T4; }
+	void Reset_T4(void) { ClearB(); BUS_READ(0x100 + sp--); addressModeCycleFn = &M6502Core::Reset_T5; }
+	void Reset_T5(void) { ea = BUS_READ(0xFFFC); addressModeCycleFn = &M6502Core::Reset_T6; }
+	void Reset_T6(void) { pc = ea | (BUS_READ(0xFFFD) << 8); addressModeCycleFn = &M6502Core::InstructionFetch; }
 
 #ifdef  SUPPORT_NMI
-	void NMI_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502::NMI_T2; } //7 cycles
-	void NMI_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502::NMI_T3; }
-	void NMI_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502::NMI_T4; }
-	void NMI_T4(void) { ClearB(); Push(status); status |= FLAG_INTERRUPT; addressModeCycleFn = &M6502::NMI_T5; }
-	void NMI_T5(void) { ea = BUS_READ(0xFFFA); addressModeCycleFn = &M6502::NMI_T6; }
-	void NMI_T6(void) { SetI(); pc = ea | (BUS_READ(0xFFFB) << 8); NMIPending = false; addressModeCycleFn = &M6502::InstructionFetch; }
+	void NMI_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::NMI_T2; } //7 cycles
+	void NMI_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502Core::NMI_T3; }
+	void NMI_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502Core::NMI_T4; }
+	void NMI_T4(void) { ClearB(); Push(status); status |= FLAG_INTERRUPT; addressModeCycleFn = &M6502Core::NMI_T5; }
+	void NMI_T5(void) { ea = BUS_READ(0xFFFA); addressModeCycleFn = &M6502Core::NMI_T6; }
+	void NMI_T6(void) { SetI(); pc = ea | (BUS_READ(0xFFFB) << 8); NMIPending = false; addressModeCycleFn = &M6502Core::InstructionFetch; }
 #endif //  SUPPORT_NMI
 
 #ifdef  SUPPORT_IRQ
-	void IRQ_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502::IRQ_T2; } //7 cycles
-	void IRQ_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502::IRQ_T3; }
-	void IRQ_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502::IRQ_T4; }
+	void IRQ_T1(void) { BUS_READ(pc); addressModeCycleFn = &M6502Core::IRQ_T2; } //7 cycles
+	void IRQ_T2(void) { Push((u8)(pc >> 8)); addressModeCycleFn = &M6502Core::IRQ_T3; }
+	void IRQ_T3(void) { Push(pc & 0xff); addressModeCycleFn = &M6502Core::IRQ_T4; }
 	void IRQ_T4(void);  // We check here if we continue on executing as IRQ or morph into NMI
-	void IRQ_T5(void) { ea = BUS_READ(0xFFFE); addressModeCycleFn = &M6502::IRQ_T6; } // Short burts of NMI assertions will be correctly masked by the IRQ in these 2 cycles
-	void IRQ_T6(void) { SetI();	pc = ea | (BUS_READ(0xFFFF) << 8); addressModeCycleFn = &M6502::InstructionFetchIRQ; }
+	void IRQ_T5(void) { ea = BUS_READ(0xFFFE); addressModeCycleFn = &M6502Core::IRQ_T6; } // Short burts of NMI assertions will be correctly masked by the IRQ in these 2 cycles
+	void IRQ_T6(void) { SetI();	pc = ea | (BUS_READ(0xFFFF) << 8); addressModeCycleFn = &M6502Core::InstructionFetchIRQ; }
 #endif //  SUPPORT_IRQ
 
 	inline void ClearB() { status &= (~FLAG_BREAK); }
@@ -504,10 +522,36 @@ private:
 	void CheckForHalt();
 #endif //  SUPPORT_RDY_HALTING
 
+	// Latch the interrupt lines at the start of a cycle.
+	inline void PollInterrupts(void)
+	{
+		bool irq;
+
+		// If an IRQ occurs during a CLI then it will not take effect until the instruction after the CLI has been executed.
+		// To emulate this, CLI simply sets CLIMaskingInterrupt flag.
+		// Similar behaviour can be witnessed with the 3 cycle branch taken instruction.
+#ifdef  SUPPORT_IRQ
+		irq = IRQ.IsAsserted();
+		if (irq && ((status & FLAG_INTERRUPT) == 0) && !CLIMaskingInterrupt && !BranchTakenMaskingInterrupt)
+			IRQPending = 1;
+		if (!irq)
+			IRQPending = 0;
+#endif //  SUPPORT_IRQ
+
+#ifdef  SUPPORT_NMI
+		NMIPending = NMI.IsAsserted() && !CLIMaskingInterrupt && !BranchTakenMaskingInterrupt;
+#endif //  SUPPORT_NMI
+
+		if (CLIMaskingInterrupt)	// If so we have delayed the IRQ long enough for the next instruction to now start. The CLI will then take effect after that instruction completes executing.
+			CLIMaskingInterrupt = false;
+		if (BranchTakenMaskingInterrupt)	// If so we have delayed the IRQ long enough for the next instruction to now start.
+			BranchTakenMaskingInterrupt = false;
+	}
+
 public:
-	M6502() : status(FLAG_CONSTANT), dataBusReadFn(0), dataBusWriteFn(0) {}
-	M6502(void* data, DataBusReadFn dataBusReadFn, DataBusWriteFn dataBusWriteFn) { SetBusFunctions(dataBusReadFn, dataBusWriteFn); }
-	void SetBusFunctions(DataBusReadFn dataBusReadFn, DataBusWriteFn dataBusWriteFn) {this->dataBusReadFn = dataBusReadFn; this->dataBusWriteFn = dataBusWriteFn; status = FLAG_CONSTANT; Reset(); }
+	M6502Core() : status(FLAG_CONSTANT) {}
+	inline Bus& GetBus() { return bus; }
+	void PowerOn(void) { status = FLAG_CONSTANT; Reset(); }
 	void Reset(void);
 	void Step(void);
 #ifdef  SUPPORT_RDY_HALTING
@@ -525,7 +569,7 @@ public:
 	u8 GetY() const { return y; }
 	u8 GetStatus() const { return status; }
 	// Emulate the 6502's SYNC signal and pin
-	bool SYNC(void) const { return addressModeCycleFn == &M6502::InstructionFetch; }
+	bool SYNC(void) const { return addressModeCycleFn == &M6502Core::InstructionFetch; }
 
 #ifdef  SUPPORT_IRQ
 	Interrupt IRQ;
@@ -534,4 +578,13 @@ public:
 	Interrupt NMI;
 #endif //  SUPPORT_NMI
 };
+
+// The original interface where the bus read and write functions are supplied at runtime.
+class M6502 : public M6502Core<M6502FunctionBus>
+{
+public:
+	M6502() {}
+	M6502(void* data, DataBusReadFn dataBusReadFn, DataBusWriteFn dataBusWriteFn) { SetBusFunctions(dataBusReadFn, dataBusWriteFn); }
+	void SetBusFunctions(DataBusReadFn dataBusReadFn, DataBusWriteFn dataBusWriteFn) { bus.readFn = dataBusReadFn; bus.writeFn = dataBusWriteFn; PowerOn(); }
+};
 #endif
@@ -0,0 +1,589 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+#include "m6502switch.h"
+#include "BusPageTable.h"
+
+// State numbers are (opcode << 3) | T.
+#define STATE(op, t) (((op) << 3) | (t))
+
+#define NEXT_CYCLE state++; break
+#define EXECUTE(fn) this->fn(); state = STATE_FETCH; break	// The same as M6502Core::ExecuteOpcode with the opcode function known
+
+// The branch conditions (see BRANCH_CONDITION in m6502.h)
+#define BRANCH_TAKEN_BPL ((status & Base::FLAG_SIGN) == 0)
+#define BRANCH_TAKEN_BMI ((status & Base::FLAG_SIGN) == Base::FLAG_SIGN)
+#define BRANCH_TAKEN_BVC ((status & Base::FLAG_OVERFLOW) == 0)
+#define BRANCH_TAKEN_BVS ((status & Base::FLAG_OVERFLOW) == Base::FLAG_OVERFLOW)
+#define BRANCH_TAKEN_BCC ((status & Base::FLAG_CARRY) == 0)
+#define BRANCH_TAKEN_BCS ((status & Base::FLAG_CARRY) == Base::FLAG_CARRY)
+#define BRANCH_TAKEN_BNE ((status & Base::FLAG_ZERO) == 0)
+#define BRANCH_TAKEN_BEQ ((status & Base::FLAG_ZERO) == Base::FLAG_ZERO)
+
+// Each address mode expands to the cases for all of its T stages for one opcode.
+// The bodies are the same as the M6502Core cycle functions they are named after.
+
+// Single byte instructions
+#define MODE_sb_1(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); value = a; EXECUTE(fn);
+
+// WriteValue() decides between the accumulator and memory by checking for sb_1_T1 so keep addressModeCycleFn in step for the accumulator shifts and rotates.
+#define MODE_acc_1(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); value = a; addressModeCycleFn = &M6502Switch::sb_1_T1; this->fn(); addressModeCycleFn = 0; state = STATE_FETCH; break;
+
+#define MODE_sb_jam(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); EXECUTE(fn);
+
+#define MODE_imm_2_1(op, fn) \
+	case STATE(op, 1): value = BUS_READ(pc++); EXECUTE(fn);
+
+// Branch instructions execute their opcode in T1.
+#define MODE_rel_5_8(op, fn) \
+	case STATE(op, 1): \
+		ra = BUS_READ(pc++); \
+		if (ra & 0x80) ra |= 0xFF00; \
+		if (BRANCH_TAKEN_##fn) \
+		{ \
+			oldpc = pc; \
+			pc = (pc & 0xff00) | ((pc + ra) & 0xff); \
+			NEXT_CYCLE; \
+		} \
+		state = STATE_FETCH; \
+		break; \
+	case STATE(op, 2): \
+		BUS_READ(oldpc); \
+		pc = oldpc + ra; \
+		if ((oldpc & 0xFF00) == (pc & 0xFF00)) \
+		{ \
+			BranchTakenMaskingInterrupt = true; \
+			state = STATE_FETCH; \
+			break; \
+		} \
+		NEXT_CYCLE; \
+	case STATE(op, 3): BUS_READ(pc); state = STATE_FETCH; break;
+
+#define MODE_zp_2_1(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_zp_3_1(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): EXECUTE(fn);
+
+#define MODE_abs_2_3(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_abs_3_2(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): EXECUTE(fn);
+
+#define MODE_idx_2_4(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ia); NEXT_CYCLE; \
+	case STATE(op, 3): ia = (ia + x) & 0xff; ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 4): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 5): value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_idx_3_3(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ia); NEXT_CYCLE; \
+	case STATE(op, 3): ia = (ia + x) & 0xff; ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 4): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 5): EXECUTE(fn);
+
+#define MODE_idx_Undoc(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ia); NEXT_CYCLE; \
+	case STATE(op, 3): ia = (ia + x) & 0xff; ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 4): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 5): value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 6): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 7): EXECUTE(fn);
+
+// Indexed by a register where crossing a page costs an extra cycle.
+#define MODE_abs_2_5(op, fn, reg) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): \
+	{ \
+		u16 startpage = ea & 0xFF00; \
+		ea += reg; \
+		if (startpage != (ea & 0xFF00)) \
+		{ \
+			BUS_READ(startpage | (ea & 0xff)); \
+			NEXT_CYCLE; \
+		} \
+		value = BUS_READ(ea); \
+		EXECUTE(fn); \
+	} \
+	case STATE(op, 4): value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_absx_2_5(op, fn) MODE_abs_2_5(op, fn, x)
+#define MODE_absy_2_5(op, fn) MODE_abs_2_5(op, fn, y)
+
+#define MODE_abs_3_4(op, fn, reg) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): BUS_READ(ea); ea += reg; NEXT_CYCLE; \
+	case STATE(op, 4): EXECUTE(fn);
+
+#define MODE_absx_3_4(op, fn) MODE_abs_3_4(op, fn, x)
+#define MODE_absy_3_4(op, fn) MODE_abs_3_4(op, fn, y)
+
+#define MODE_zp_2_6(op, fn, reg) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 3): ea = (ea + reg) & 0xFF; value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_zpx_2_6(op, fn) MODE_zp_2_6(op, fn, x)
+#define MODE_zpy_2_6(op, fn) MODE_zp_2_6(op, fn, y)
+
+#define MODE_zp_3_5(op, fn, reg) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 3): ea = (ea + reg) & 0xFF; EXECUTE(fn);
+
+#define MODE_zpx_3_5(op, fn) MODE_zp_3_5(op, fn, x)
+#define MODE_zpy_3_5(op, fn) MODE_zp_3_5(op, fn, y)
+
+#define MODE_idy_2_7(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 3): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 4): \
+	{ \
+		u16 startpage = ea & 0xFF00; \
+		ea += y; \
+		if (startpage != (ea & 0xFF00)) \
+		{ \
+			BUS_READ(startpage | (ea & 0xff)); \
+			NEXT_CYCLE; \
+		} \
+		value = BUS_READ(ea); \
+		EXECUTE(fn); \
+	} \
+	case STATE(op, 5): value = BUS_READ(ea); EXECUTE(fn);
+
+#define MODE_idy_3_6(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 3): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 4): ea += y; BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 5): EXECUTE(fn);
+
+#define MODE_idy_Undoc(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 3): ea |= (BUS_READ(ia & 0xff) << 8); NEXT_CYCLE; \
+	case STATE(op, 4): ea += y; BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 5): value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 6): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 7): EXECUTE(fn);
+
+#define MODE_zp_4_1(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 3): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 4): EXECUTE(fn);
+
+#define MODE_abs_4_2(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 4): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 5): EXECUTE(fn);
+
+#define MODE_zpx_4_3(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 3): ea = (ea + x) & 0xFF; value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 4): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 5): EXECUTE(fn);
+
+#define MODE_abs_4_4(op, fn, reg) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): ea += reg; BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 4): value = BUS_READ(ea); NEXT_CYCLE; \
+	case STATE(op, 5): BUS_WRITE(ea, (u8)value); NEXT_CYCLE; \
+	case STATE(op, 6): EXECUTE(fn);
+
+#define MODE_absx_4_4(op, fn) MODE_abs_4_4(op, fn, x)
+#define MODE_absy_4_4(op, fn) MODE_abs_4_4(op, fn, y)
+
+#define MODE_ph_5_1(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); NEXT_CYCLE; \
+	case STATE(op, 2): EXECUTE(fn);
+
+#define MODE_pl_5_2(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(0x100 + sp); NEXT_CYCLE; \
+	case STATE(op, 3): EXECUTE(fn);
+
+#define MODE_jsr_5_3(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(0x100 + sp); NEXT_CYCLE; \
+	case STATE(op, 3): Push((u8)((pc) >> 8)); NEXT_CYCLE; \
+	case STATE(op, 4): Push(pc & 0xff); NEXT_CYCLE; \
+	case STATE(op, 5): ea |= (BUS_READ(pc++) << 8); pc = ea; EXECUTE(fn);
+
+#define MODE_rti_5_5(op, fn) \
+	case STATE(op, 1): BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(0x100 + sp); NEXT_CYCLE; \
+	case STATE(op, 3): status = Pull(); NEXT_CYCLE; \
+	case STATE(op, 4): pc = Pull(); NEXT_CYCLE; \
+	case STATE(op, 5): pc |= (Pull() << 8); EXECUTE(fn);
+
+#define MODE_abs5_6_1(op, fn) \
+	case STATE(op, 1): ea = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ea |= (BUS_READ(pc++) << 8); EXECUTE(fn);
+
+#define MODE_abs5_6_2(op, fn) \
+	case STATE(op, 1): ia = BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): ia |= (BUS_READ(pc++) << 8); NEXT_CYCLE; \
+	case STATE(op, 3): ea = BUS_READ(ia++); NEXT_CYCLE; \
+	case STATE(op, 4): ea |= (BUS_READ(ia) << 8); EXECUTE(fn);
+
+#define MODE_rts_5_7(op, fn) \
+	case STATE(op, 1): BUS_READ(pc++); NEXT_CYCLE; \
+	case STATE(op, 2): BUS_READ(0x100 + sp); NEXT_CYCLE; \
+	case STATE(op, 3): pc = Pull(); NEXT_CYCLE; \
+	case STATE(op, 4): pc |= (Pull() << 8); NEXT_CYCLE; \
+	case STATE(op, 5): BUS_READ(pc); pc++; EXECUTE(fn);
+
+#define MODE_brk_5_4(op, fn) \
+	case STATE(op, 1): BUS_READ(pc); pc++; NEXT_CYCLE; \
+	case STATE(op, 2): Push((u8)(pc >> 8)); NEXT_CYCLE; \
+	case STATE(op, 3): Push(pc & 0xff); NEXT_CYCLE; \
+	case STATE(op, 4): brk_5_4_T4(); break; \
+	case STATE(op, 5): ea = BUS_READ(0xFFFE); NEXT_CYCLE; \
+	case STATE(op, 6): SetI(); pc = ea | (BUS_READ(0xFFFF) << 8); EXECUTE(fn);
+
+#define OPCODE(op, mode, fn) MODE_##mode(op, fn)
+
+template <class Bus>
+void M6502Switch<Bus>::Step(void)
+{
+	PollInterrupts();
+
+#ifdef  SUPPORT_RDY_HALTING
+	if (Halted())
+		return;
+	CheckForHalt();
+#endif //  SUPPORT_RDY_HALTING
+
+	switch (state)
+	{
+		case STATE_FETCH: InstructionFetch(); break;
+#ifdef  SUPPORT_IRQ
+		// If a NMI asserts too late during the IRQ execution ie after IRQ_T4 then it must wait one more instruction. So no polling is performed during this fetch.
+		case STATE_FETCH_IRQ: opcode = BUS_READ(pc++); state = STATE(opcode, 1); break;
+#endif //  SUPPORT_IRQ
+
+		// Reset_T0 is performed by M6502Core::Reset
+		case STATE_RESET + 1: BUS_READ(pc); NEXT_CYCLE;
+		case STATE_RESET + 2: BUS_READ(0x100 + sp--); NEXT_CYCLE;
+		case STATE_RESET + 3: BUS_READ(0x100 + sp--); NEXT_CYCLE;
+		case STATE_RESET + 4: ClearB(); BUS_READ(0x100 + sp--); NEXT_CYCLE;
+		case STATE_RESET + 5: ea = BUS_READ(0xFFFC); NEXT_CYCLE;
+		case STATE_RESET + 6: pc = ea | (BUS_READ(0xFFFD) << 8); state = STATE_FETCH; break;
+
+#ifdef  SUPPORT_NMI
+		case STATE_NMI + 1: BUS_READ(pc); NEXT_CYCLE;
+		case STATE_NMI + 2: Push((u8)(pc >> 8)); NEXT_CYCLE;
+		case STATE_NMI + 3: Push(pc & 0xff); NEXT_CYCLE;
+		case STATE_NMI + 4: NMI_T4(); break;
+		case STATE_NMI + 5: ea = BUS_READ(0xFFFA); NEXT_CYCLE;
+		case STATE_NMI + 6: SetI(); pc = ea | (BUS_READ(0xFFFB) << 8); NMIPending = false; state = STATE_FETCH; break;
+#endif //  SUPPORT_NMI
+
+#ifdef  SUPPORT_IRQ
+		case STATE_IRQ + 1: BUS_READ(pc); NEXT_CYCLE;
+		case STATE_IRQ + 2: Push((u8)(pc >> 8)); NEXT_CYCLE;
+		case STATE_IRQ + 3: Push(pc & 0xff); NEXT_CYCLE;
+		case STATE_IRQ + 4: IRQ_T4(); break;
+		case STATE_IRQ + 5: ea = BUS_READ(0xFFFE); NEXT_CYCLE;
+		case STATE_IRQ + 6: SetI(); pc = ea | (BUS_READ(0xFFFF) << 8); state = STATE_FETCH_IRQ; break;
+#endif //  SUPPORT_IRQ
+
+		OPCODE(0x00, brk_5_4, BRK)
+		OPCODE(0x01, idx_2_4, ORA)
+		OPCODE(0x02, sb_jam, JAM)
+		OPCODE(0x03, idx_Undoc, SLO)
+		OPCODE(0x04, zp_2_1, NOP)
+		OPCODE(0x05, zp_2_1, ORA)
+		OPCODE(0x06, zp_4_1, ASL)
+		OPCODE(0x07, zp_4_1, SLO)
+		OPCODE(0x08, ph_5_1, PHP)
+		OPCODE(0x09, imm_2_1, ORA)
+		OPCODE(0x0A, acc_1, ASL)
+		OPCODE(0x0B, imm_2_1, ANC)
+		OPCODE(0x0C, abs_2_3, NOP)
+		OPCODE(0x0D, abs_2_3, ORA)
+		OPCODE(0x0E, abs_4_2, ASL)
+		OPCODE(0x0F, abs_4_2, SLO)
+		OPCODE(0x10, rel_5_8, BPL)
+		OPCODE(0x11, idy_2_7, ORA)
+		OPCODE(0x12, sb_jam, JAM)
+		OPCODE(0x13, idy_Undoc, SLO)
+		OPCODE(0x14, zpx_2_6, NOP)
+		OPCODE(0x15, zpx_2_6, ORA)
+		OPCODE(0x16, zpx_4_3, ASL)
+		OPCODE(0x17, zpx_4_3, SLO)
+		OPCODE(0x18, sb_1, CLC)
+		OPCODE(0x19, absy_2_5, ORA)
+		OPCODE(0x1A, sb_1, NOP)
+		OPCODE(0x1B, absy_4_4, SLO)
+		OPCODE(0x1C, absx_2_5, NOP)
+		OPCODE(0x1D, absx_2_5, ORA)
+		OPCODE(0x1E, absx_4_4, ASL)
+		OPCODE(0x1F, absx_4_4, SLO)
+		OPCODE(0x20, jsr_5_3, JSR)
+		OPCODE(0x21, idx_2_4, AND)
+		OPCODE(0x22, sb_jam, JAM)
+		OPCODE(0x23, idx_Undoc, RLA)
+		OPCODE(0x24, zp_2_1, BIT)
+		OPCODE(0x25, zp_2_1, AND)
+		OPCODE(0x26, zp_4_1, ROL)
+		OPCODE(0x27, zp_4_1, RLA)
+		OPCODE(0x28, pl_5_2, PLP)
+		OPCODE(0x29, imm_2_1, AND)
+		OPCODE(0x2A, acc_1, ROL)
+		OPCODE(0x2B, imm_2_1, ANC)
+		OPCODE(0x2C, abs_2_3, BIT)
+		OPCODE(0x2D, abs_2_3, AND)
+		OPCODE(0x2E, abs_4_2, ROL)
+		OPCODE(0x2F, abs_4_2, RLA)
+		OPCODE(0x30, rel_5_8, BMI)
+		OPCODE(0x31, idy_2_7, AND)
+		OPCODE(0x32, sb_jam, JAM)
+		OPCODE(0x33, idy_Undoc, RLA)
+		OPCODE(0x34, zpx_2_6, NOP)
+		OPCODE(0x35, zpx_2_6, AND)
+		OPCODE(0x36, zpx_4_3, ROL)
+		OPCODE(0x37, zpx_4_3, RLA)
+		OPCODE(0x38, sb_1, SEC)
+		OPCODE(0x39, absy_2_5, AND)
+		OPCODE(0x3A, sb_1, NOP)
+		OPCODE(0x3B, absy_4_4, RLA)
+		OPCODE(0x3C, absx_2_5, NOP)
+		OPCODE(0x3D, absx_2_5, AND)
+		OPCODE(0x3E, absx_4_4, ROL)
+		OPCODE(0x3F, absx_4_4, RLA)
+		OPCODE(0x40, rti_5_5, RTI)
+		OPCODE(0x41, idx_2_4, EOR)
+		OPCODE(0x42, sb_jam, JAM)
+		OPCODE(0x43, idx_Undoc, SRE)
+		OPCODE(0x44, zp_2_1, NOP)
+		OPCODE(0x45, zp_2_1, EOR)
+		OPCODE(0x46, zp_4_1, LSR)
+		OPCODE(0x47, zp_4_1, SRE)
+		OPCODE(0x48, ph_5_1, PHA)
+		OPCODE(0x49, imm_2_1, EOR)
+		OPCODE(0x4A, acc_1, LSR)
+		OPCODE(0x4B, imm_2_1, ASR)
+		OPCODE(0x4C, abs5_6_1, JMP)
+		OPCODE(0x4D, abs_2_3, EOR)
+		OPCODE(0x4E, abs_4_2, LSR)
+		OPCODE(0x4F, abs_4_2, SRE)
+		OPCODE(0x50, rel_5_8, BVC)
+		OPCODE(0x51, idy_2_7, EOR)
+		OPCODE(0x52, sb_jam, JAM)
+		OPCODE(0x53, idy_Undoc, SRE)
+		OPCODE(0x54, zpx_2_6, NOP)
+		OPCODE(0x55, zpx_2_6, EOR)
+		OPCODE(0x56, zpx_4_3, LSR)
+		OPCODE(0x57, zpx_4_3, SRE)
+		OPCODE(0x58, sb_1, CLI)
+		OPCODE(0x59, absy_2_5, EOR)
+		OPCODE(0x5A, sb_1, NOP)
+		OPCODE(0x5B, absy_4_4, SRE)
+		OPCODE(0x5C, absx_2_5, NOP)
+		OPCODE(0x5D, absx_2_5, EOR)
+		OPCODE(0x5E, absx_4_4, LSR)
+		OPCODE(0x5F, absx_4_4, SRE)
+		OPCODE(0x60, rts_5_7, RTS)
+		OPCODE(0x61, idx_2_4, ADC)
+		OPCODE(0x62, sb_jam, JAM)
+		OPCODE(0x63, idx_Undoc, RRA)
+		OPCODE(0x64, zp_2_1, NOP)
+		OPCODE(0x65, zp_2_1, ADC)
+		OPCODE(0x66, zp_4_1, ROR)
+		OPCODE(0x67, zp_4_1, RRA)
+		OPCODE(0x68, pl_5_2, PLA)
+		OPCODE(0x69, imm_2_1, ADC)
+		OPCODE(0x6A, acc_1, ROR)
+		OPCODE(0x6B, imm_2_1, ARR)
+		OPCODE(0x6C, abs5_6_2, JMP)
+		OPCODE(0x6D, abs_2_3, ADC)
+		OPCODE(0x6E, abs_4_2, ROR)
+		OPCODE(0x6F, abs_4_2, RRA)
+		OPCODE(0x70, rel_5_8, BVS)
+		OPCODE(0x71, idy_2_7, ADC)
+		OPCODE(0x72, sb_jam, JAM)
+		OPCODE(0x73, idy_Undoc, RRA)
+		OPCODE(0x74, zpx_2_6, NOP)
+		OPCODE(0x75, zpx_2_6, ADC)
+		OPCODE(0x76, zpx_4_3, ROR)
+		OPCODE(0x77, zpx_4_3, RRA)
+		OPCODE(0x78, sb_1, SEI)
+		OPCODE(0x79, absy_2_5, ADC)
+		OPCODE(0x7A, sb_1, NOP)
+		OPCODE(0x7B, absy_4_4, RRA)
+		OPCODE(0x7C, absx_2_5, NOP)
+		OPCODE(0x7D, absx_2_5, ADC)
+		OPCODE(0x7E, absx_4_4, ROR)
+		OPCODE(0x7F, absx_4_4, RRA)
+		OPCODE(0x80, imm_2_1, NOP)
+		OPCODE(0x81, idx_3_3, STA)
+		OPCODE(0x82, imm_2_1, NOP)
+		OPCODE(0x83, idx_3_3, SAX)
+		OPCODE(0x84, zp_3_1, STY)
+		OPCODE(0x85, zp_3_1, STA)
+		OPCODE(0x86, zp_2_1, STX)
+		OPCODE(0x87, zp_3_1, SAX)
+		OPCODE(0x88, sb_1, DEY)
+		OPCODE(0x89, imm_2_1, NOP)
+		OPCODE(0x8A, sb_1, TXA)
+		OPCODE(0x8B, imm_2_1, XAA)
+		OPCODE(0x8C, abs_3_2, STY)
+		OPCODE(0x8D, abs_3_2, STA)
+		OPCODE(0x8E, abs_3_2, STX)
+		OPCODE(0x8F, abs_3_2, SAX)
+		OPCODE(0x90, rel_5_8, BCC)
+		OPCODE(0x91, idy_3_6, STA)
+		OPCODE(0x92, sb_jam, JAM)
+		OPCODE(0x93, idy_3_6, SHA)
+		OPCODE(0x94, zpx_3_5, STY)
+		OPCODE(0x95, zpx_3_5, STA)
+		OPCODE(0x96, zpy_3_5, STX)
+		OPCODE(0x97, zpy_3_5, SAX)
+		OPCODE(0x98, sb_1, TYA)
+		OPCODE(0x99, absy_3_4, STA)
+		OPCODE(0x9A, sb_1, TXS)
+		OPCODE(0x9B, absy_3_4, SHS)
+		OPCODE(0x9C, absx_3_4, SHY)
+		OPCODE(0x9D, absx_3_4, STA)
+		OPCODE(0x9E, absy_3_4, SHX)
+		OPCODE(0x9F, absy_3_4, SHA)
+		OPCODE(0xA0, imm_2_1, LDY)
+		OPCODE(0xA1, idx_2_4, LDA)
+		OPCODE(0xA2, imm_2_1, LDX)
+		OPCODE(0xA3, idx_2_4, LAX)
+		OPCODE(0xA4, zp_2_1, LDY)
+		OPCODE(0xA5, zp_2_1, LDA)
+		OPCODE(0xA6, zp_2_1, LDX)
+		OPCODE(0xA7, zp_2_1, LAX)
+		OPCODE(0xA8, sb_1, TAY)
+		OPCODE(0xA9, imm_2_1, LDA)
+		OPCODE(0xAA, sb_1, TAX)
+		OPCODE(0xAB, imm_2_1, LXA)
+		OPCODE(0xAC, abs_2_3, LDY)
+		OPCODE(0xAD, abs_2_3, LDA)
+		OPCODE(0xAE, abs_2_3, LDX)
+		OPCODE(0xAF, abs_2_3, LAX)
+		OPCODE(0xB0, rel_5_8, BCS)
+		OPCODE(0xB1, idy_2_7, LDA)
+		OPCODE(0xB2, sb_jam, JAM)
+		OPCODE(0xB3, idy_2_7, LAX)
+		OPCODE(0xB4, zpx_2_6, LDY)
+		OPCODE(0xB5, zpx_2_6, LDA)
+		OPCODE(0xB6, zpy_2_6, LDX)
+		OPCODE(0xB7, zpy_2_6, LAX)
+		OPCODE(0xB8, sb_1, CLV)
+		OPCODE(0xB9, absy_2_5, LDA)
+		OPCODE(0xBA, sb_1, TSX)
+		OPCODE(0xBB, absy_4_4, LAS)
+		OPCODE(0xBC, absx_2_5, LDY)
+		OPCODE(0xBD, absx_2_5, LDA)
+		OPCODE(0xBE, absy_2_5, LDX)
+		OPCODE(0xBF, absy_2_5, LAX)
+		OPCODE(0xC0, imm_2_1, CPY)
+		OPCODE(0xC1, idx_2_4, CMP)
+		OPCODE(0xC2, imm_2_1, NOP)
+		OPCODE(0xC3, idx_Undoc, DCP)
+		OPCODE(0xC4, zp_2_1, CPY)
+		OPCODE(0xC5, zp_2_1, CMP)
+		OPCODE(0xC6, zp_4_1, DEC)
+		OPCODE(0xC7, zp_4_1, DCP)
+		OPCODE(0xC8, sb_1, INY)
+		OPCODE(0xC9, imm_2_1, CMP)
+		OPCODE(0xCA, sb_1, DEX)
+		OPCODE(0xCB, imm_2_1, SBX)
+		OPCODE(0xCC, abs_2_3, CPY)
+		OPCODE(0xCD, abs_2_3, CMP)
+		OPCODE(0xCE, abs_4_2, DEC)
+		OPCODE(0xCF, abs_4_2, DCP)
+		OPCODE(0xD0, rel_5_8, BNE)
+		OPCODE(0xD1, idy_2_7, CMP)
+		OPCODE(0xD2, sb_jam, JAM)
+		OPCODE(0xD3, idy_Undoc, DCP)
+		OPCODE(0xD4, zpx_2_6, NOP)
+		OPCODE(0xD5, zpx_2_6, CMP)
+		OPCODE(0xD6, zpx_4_3, DEC)
+		OPCODE(0xD7, zpx_4_3, DCP)
+		OPCODE(0xD8, sb_1, CLD)
+		OPCODE(0xD9, absy_2_5, CMP)
+		OPCODE(0xDA, sb_1, NOP)
+		OPCODE(0xDB, absy_4_4, DCP)
+		OPCODE(0xDC, absx_2_5, NOP)
+		OPCODE(0xDD, absx_2_5, CMP)
+		OPCODE(0xDE, absx_4_4, DEC)
+		OPCODE(0xDF, absx_4_4, DCP)
+		OPCODE(0xE0, imm_2_1, CPX)
+		OPCODE(0xE1, idx_2_4, SBC)
+		OPCODE(0xE2, imm_2_1, NOP)
+		OPCODE(0xE3, idx_Undoc, ISB)
+		OPCODE(0xE4, zp_2_1, CPX)
+		OPCODE(0xE5, zp_2_1, SBC)
+		OPCODE(0xE6, zp_4_1, INC)
+		OPCODE(0xE7, zp_4_1, ISB)
+		OPCODE(0xE8, sb_1, INX)
+		OPCODE(0xE9, imm_2_1, SBC)
+		OPCODE(0xEA, sb_1, NOP)
+		OPCODE(0xEB, imm_2_1, SBC)
+		OPCODE(0xEC, abs_2_3, CPX)
+		OPCODE(0xED, abs_2_3, SBC)
+		OPCODE(0xEE, abs_4_2, INC)
+		OPCODE(0xEF, abs_4_2, ISB)
+		OPCODE(0xF0, rel_5_8, BEQ)
+		OPCODE(0xF1, idy_2_7, SBC)
+		OPCODE(0xF2, sb_jam, JAM)
+		OPCODE(0xF3, idy_Undoc, ISB)
+		OPCODE(0xF4, zpx_2_6, NOP)
+		OPCODE(0xF5, zpx_2_6, SBC)
+		OPCODE(0xF6, zpx_4_3, INC)
+		OPCODE(0xF7, zpx_4_3, ISB)
+		OPCODE(0xF8, sb_1, SED)
+		OPCODE(0xF9, absy_2_5, SBC)
+		OPCODE(0xFA, sb_1, NOP)
+		OPCODE(0xFB, absy_4_4, ISB)
+		OPCODE(0xFC, absx_2_5, NOP)
+		OPCODE(0xFD, absx_2_5, SBC)
+		OPCODE(0xFE, absx_4_4, INC)
+		OPCODE(0xFF, absx_4_4, ISB)
+	}
+}
+
+// Instantiate the CPU for the buses it is used with.
+template class M6502Switch<M6502FunctionBus>;
+template class M6502Switch<BusPageTable>;
@@ -0,0 +1,170 @@
+// Pi1541 - A Commodore 1541 disk drive emulator
+// Copyright(C) 2018 Stephen White
+//
+// This file is part of Pi1541.
+// 
+// Pi1541 is free software : you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+// 
+// Pi1541 is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+// GNU General Public License for more details.
+// 
+// You should have received a copy of the GNU General Public License
+// along with Pi1541. If not, see <http://www.gnu.org/licenses/>.
+
+
+/////////////////////////////////////////////////////////////////////////////////
+// An alternative dispatch engine for the M6502 core.
+//
+// M6502Core keeps the processor's state machine as member function pointers and calls through addressModeCycleFn (and opcodeCycleFn) every cycle.
+// M6502Switch instead keeps a single state number made from the opcode and the T stage ((opcode << 3) | T) and dispatches it with one dense switch.
+// Each case is the body of the matching M6502Core cycle function with the opcode function inlined, so an instruction's whole cycle sequence is
+// resolved at compile time and the only indirect branch left per cycle is the switch's jump table.
+//
+// The registers, flags, opcode functions and interrupt handling are all shared with M6502Core so the two engines produce bit identical bus traffic.
+// The host runner's -lockstep mode steps both engines side by side on random code and random interrupts and compares every bus access.
+//
+// Build with M6502_SWITCH_DISPATCH defined (make M6502SWITCH=1) to use this engine for the emulated drives.
+
+#ifndef M6502SWITCH_H
+#define M6502SWITCH_H
+#include "m6502.h"
+
+template <class Bus>
+class M6502Switch : public M6502Core<Bus>
+{
+	typedef M6502Core<Bus> Base;
+
+public:
+	M6502Switch() : state(STATE_FETCH) {}
+	void PowerOn(void) { status = Base::FLAG_CONSTANT; Reset(); }
+	void Reset(void) { Base::Reset(); state = STATE_RESET + 1; }	// M6502Core::Reset performs Reset_T0
+	void Step(void);
+
+	// Emulate the 6502's SYNC signal and pin
+	bool SYNC(void) const { return state == STATE_FETCH; }
+
+private:
+	// The states after the 256 opcodes are used for instruction fetch, reset and the interrupt sequences.
+	enum
+	{
+		STATE_FETCH = 0x100 << 3,
+		STATE_FETCH_IRQ,
+		STATE_RESET = 0x101 << 3,
+		STATE_IRQ = 0x102 << 3,
+		STATE_NMI = 0x103 << 3
+	};
+
+	using Base::bus;
+	using Base::ea;
+	using Base::ra;
+	using Base::ia;
+	using Base::oldpc;
+	using Base::value;
+	using Base::pc;
+	using Base::opcode;
+	using Base::a;
+	using Base::x;
+	using Base::y;
+	using Base::status;
+	using Base::sp;
+	using Base::BranchTakenMaskingInterrupt;
+	using Base::addressModeCycleFn;
+#ifdef  SUPPORT_IRQ
+	using Base::IRQPending;
+#endif //  SUPPORT_IRQ
+#ifdef  SUPPORT_NMI
+	using Base::NMIPending;
+#endif //  SUPPORT_NMI
+#ifdef  SUPPORT_RDY_HALTING
+	using Base::BusRead;
+	using Base::CheckForHalt;
+	using Base::Halted;
+#endif //  SUPPORT_RDY_HALTING
+	using Base::Push;
+	using Base::Pull;
+	using Base::SetI;
+	using Base::ClearB;
+	using Base::IRQDisabled;
+	using Base::PollInterrupts;
+
+	// These mirror the M6502Core cycle functions of the same name that can change the instruction being executed.
+	// Interrupts are polled before starting a new instruction
+	inline void InstructionFetch(void)
+	{
+		opcode = BUS_READ(pc);
+#ifdef  SUPPORT_NMI
+		if (NMIPending)
+			state = STATE_NMI + 1;
+		else
+#endif //  SUPPORT_NMI
+#ifdef  SUPPORT_IRQ
+		if (IRQPending && !IRQDisabled())
+		{
+			IRQPending = 0;
+			state = STATE_IRQ + 1;
+		}
+		else
+#endif //  SUPPORT_IRQ
+		{
+			pc++;
+			state = (opcode << 3) | 1;
+		}
+	}
+
+#ifdef  SUPPORT_NMI
+	inline void NMI_T4(void)
+	{
+		ClearB();
+		Push(status);
+		status |= Base::FLAG_INTERRUPT;
+		state = STATE_NMI + 5;
+	}
+#endif //  SUPPORT_NMI
+
+#ifdef  SUPPORT_IRQ
+	inline void IRQ_T4(void)
+	{
+#ifdef  SUPPORT_NMI
+		if (NMIPending)
+		{
+			NMIPending = 0;
+			NMI_T4();
+			return;
+		}
+#endif //  SUPPORT_NMI
+		ClearB();
+		Push(status);
+		state = STATE_IRQ + 5;
+	}
+#endif //  SUPPORT_IRQ
+
+	inline void brk_5_4_T4(void)
+	{
+#ifdef  SUPPORT_NMI
+		if (NMIPending)
+		{
+			NMIPending = 0;
+			NMI_T4();
+			return;
+		}
+#endif //  SUPPORT_NMI
+#ifdef  SUPPORT_IRQ
+		if (IRQPending && !IRQDisabled())
+		{
+			IRQPending = 0;
+			IRQ_T4();
+			return;
+		}
+#endif //  SUPPORT_IRQ
+		Push(status | Base::FLAG_CONSTANT | Base::FLAG_BREAK);
+		state++;
+	}
+
+	u16 state;	// (opcode << 3) | T of the next cycle to execute.
+};
+#endif
@@ -24,11 +24,15 @@
 
 m6522::m6522()
 {
+	quietCyclesEnabled = true;
 	Reset();
 }
 
 void m6522::Reset()
 {
+	quietCycles = 0;
+	quietCyclesRemaining = 0;
+
 	functionControlRegister = 0;
 	auxiliaryControlRegister = 0;
 
@@ -102,6 +106,7 @@ void m6522::InputCA1(bool value)
 
 void m6522::InputCA2(bool value)
 {
+	EndQuietCycles();
 	if ((functionControlRegister & FCR_CA2_IO) == 0) // CA2 is an input?
 	{
 		if (ca2 != value && ((functionControlRegister & FCR_CA2_EDGE_TRIGGER_MODE) != 0) == value)
@@ -112,6 +117,7 @@ void m6522::InputCA2(bool value)
 
 void m6522::InputCB1(bool value)
 {
+	EndQuietCycles();
 	if (cb1 != value && ((functionControlRegister & FCR_CB1) != 0) == value) // CB1 is an input?
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -127,6 +133,7 @@ void m6522::InputCB1(bool value)
 // If CB2 is not set to an output then reads the CB2 line and stores the value in cb2
 void m6522::InputCB2(bool value)
 {
+	EndQuietCycles();
 	if ((functionControlRegister & FCR_CB2_IO) == 0) // CB2 is an input?
 	{
 		if (cb2 != value && ((functionControlRegister & FCR_CB2_EDGE_TRIGGER_MODE) != 0) == value)
@@ -136,8 +143,10 @@ void m6522::InputCB2(bool value)
 }
 
 // Update for a single cycle
-void m6522::Execute()
+void m6522::ExecuteCycle()
 {
+	CatchUp();
+
 	if (ca2 && pulseCA2) ca2 = false;
 	if (cb2 && pulseCB2) cb2 = false;
 
@@ -403,12 +412,71 @@ void m6522::Execute()
 		break;
 	}
 	cb1Old = cb1;
+
+	ScheduleQuietCycles();
+}
+
+// Work out how many of the following cycles will do nothing but decrement the counters.
+// ie the number of cycles until the next timer underflow (the cycle that may set an IFR flag, reload a counter or flip PB7) that must be run in full.
+// Pulse outputs, timer reloads and an active shift register all need the very next cycle to be run in full.
+void m6522::ScheduleQuietCycles()
+{
+	unsigned cycles = 0xffff;
+
+	if (!quietCyclesEnabled || (ca2 && pulseCA2) || (cb2 && pulseCB2) || t1TimedOut || t1Reload || t2TimedOut || t2Reload || cb1OutputShiftClockPositiveEdge
+		|| (t2CountingPB6Mode != t2CountingPB6ModeOld) || (auxiliaryControlRegister & ACR_SHIFTREG_CTRL))
+	{
+		cycles = 0;
+	}
+	else
+	{
+		// T1 decrements from N to 0 and then underflows on the next cycle.
+		if (t1Ticking && t1c.value < cycles)
+			cycles = t1c.value;
+
+		// T2 times out on the cycle it decrements to 0.
+		// (T2 counting PB6 pulses is never decremented by ExecuteCycle)
+		if (t2CountingDown && !t2CountingPB6Mode)
+		{
+			unsigned short t2Cycles = t2c.value - 1;
+			if (t2Cycles < cycles)
+				cycles = t2Cycles;
+		}
+	}
+
+	quietCycles = cycles;
+	quietCyclesRemaining = cycles;
+}
+
+// Apply the cycles skipped by Execute as ExecuteCycle would have done.
+void m6522::CatchUpCounters(unsigned cycles)
+{
+	if (t1Ticking)
+		t1c.value -= cycles;
+
+	if (t2CountingDown && !t2CountingPB6Mode)
+	{
+		// Count the times the low byte went through 0xfe
+		unsigned firstFE = (unsigned char)(t2c.bytes.l - 0xfe);
+		if (firstFE == 0)
+			firstFE = 0x100;
+		if (cycles >= firstFE)
+			t2TimedOutCount += 1 + ((cycles - firstFE) >> 8);
+		t2c.value -= cycles;
+	}
+
+	pb6Old = portB.GetInput() & ~portB.GetDirection() & 0x40;
+	cb1Old = cb1;
+
+	quietCycles = quietCyclesRemaining;
 }
 
 unsigned char m6522::Read(unsigned int address)
 {
 	unsigned char value = 0;
 
+	CatchUp();
+
 	switch (address & 0xf)
 	{
 		case ORB:
@@ -483,6 +551,8 @@ unsigned char m6522::Peek(unsigned int address)
 {
 	unsigned char value = 0;
 
+	CatchUp();
+
 	switch (address & 0xf)
 	{
 		case ORB:
@@ -568,6 +638,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 			// If PB7 has been programmed as a TIMER 1 output it will go low on the phi2 following the write operation.
 			// Additionally, if the T1 interrupt flag has already been set, the write operation will clear it.
 			// The write to TICH initiates the countdown on the next ph2.
+			EndQuietCycles();
 			t1l.bytes.h = value;
 			t1c.value = t1l.value;
 			t1Ticking = true;	// BruceLee needs this else it will not load.
@@ -591,6 +662,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 		break;
 		case T1LH:
 			// A write to T1LH loads an 8 bit count value into the latch.
+			EndQuietCycles();
 			t1l.bytes.h = value;
 			// To clear or not to clear the IRQ flag?
 			// There are a few documents that say a write to T1LH does not clear the IRQ.
@@ -611,6 +683,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 		case T2CH:
 			// Writing T2CH loads an 8 bit byte into the high order counter and latch (!!!there is no t2lh!!!) and simultaneously loads the low order latch into the low order counter, and the count down is initiated.
 			// If a T2 interrupt has occurred, the write operation will clear the T2 interrupt flag and reset !IRQ.
+			EndQuietCycles();
 			t2c.bytes.h = value;
 			t2c.bytes.l = t2Latch;
 			t2Reload = true;
@@ -622,6 +695,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 			t2OneShotTriggeredIRQ = false;
 		break;
 		case SR:
+			EndQuietCycles();
 			shiftRegister = value;
 			if (interruptFlagRegister & IR_SR) bitsShiftedSoFar = 0;
 			ClearInterrupt(IR_SR);
@@ -630,6 +704,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 		break;
 		case ACR:
 			//bool t1OutPB7Prev = (auxiliaryControlRegister & ACR_T1_OUT_PB7) != 0;
+			EndQuietCycles();
 			auxiliaryControlRegister = value;
 			latchPortA = (value & ACR_PA_LATCH_ENABLE) != 0;
 			latchPortB = (value & ACR_PB_LATCH_ENABLE) != 0;
@@ -675,6 +750,7 @@ void m6522::Write(unsigned int address, unsigned char value)
 			//}
 		break;
 		case FCR:	// Peripheral Control Register
+			EndQuietCycles();
 			functionControlRegister = value;
 			if ((value & FCR_CA2_IO) == FCR_CA2_IO)
 			{
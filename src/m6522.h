@@ -217,7 +217,18 @@ FCR/PCR
 	inline bool GetCB2() { return cb2; }
 	void InputCB2(bool value);
 
-	void Execute();
+	// Update for a single cycle
+	inline void Execute()
+	{
+		// Between events the only state that changes is the timer counters.
+		// So just count off the cycles and catch the counters up when they are next needed.
+		if (quietCyclesRemaining)
+		{
+			quietCyclesRemaining--;
+			return;
+		}
+		ExecuteCycle();
+	}
 
 	unsigned char Read(unsigned int address);
 	unsigned char Peek(unsigned int address);
@@ -227,7 +238,33 @@ FCR/PCR
 	{
 		return functionControlRegister;
 	}
+
+	// Turning the quiet cycles off runs every cycle in full (the host lockstep checks the two agree).
+	void SetQuietCyclesEnabled(bool enable)
+	{
+		EndQuietCycles();
+		quietCyclesEnabled = enable;
+	}
 private:
+	void ExecuteCycle();
+	void ScheduleQuietCycles();
+
+	// Bring the counters up to date with the cycles counted off by Execute.
+	inline void CatchUp()
+	{
+		if (quietCycles != quietCyclesRemaining)
+			CatchUpCounters(quietCycles - quietCyclesRemaining);
+	}
+	void CatchUpCounters(unsigned cycles);
+
+	// Something the schedule depends on has changed so run the next cycle in full.
+	inline void EndQuietCycles()
+	{
+		CatchUp();
+		quietCycles = 0;
+		quietCyclesRemaining = 0;
+	}
+
 	inline unsigned char ReadPortB()
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -380,6 +417,10 @@ private:
 	unsigned cb1OutputShiftClock;
 	unsigned char cb2Shift;  // version of cb2 controlled by the shift register
 	bool cb1OutputShiftClockPositiveEdge;
+
+	unsigned quietCycles;			// The number of cycles, from the last full cycle, in which nothing but the counters can change.
+	unsigned quietCyclesRemaining;	// How many of those are still to be counted off by Execute.
+	bool quietCyclesEnabled;
 };
 
 #endif
\ No newline at end of file
@@ -87,11 +87,15 @@ extern bool bLoggingCYCs;
 
 m8520::m8520()
 {
+	quietCyclesEnabled = true;
 	Reset();
 }
 
 void m8520::Reset()
 {
+	quietCycles = 0;
+	quietCyclesRemaining = 0;
+
 	// The port pins are set as inputs and port registers to zero(although a read of the ports will return all highs because of passive pullups).
 	portA.SetDirection(0);
 	portB.SetDirection(0);
@@ -150,11 +154,13 @@ void m8520::Reset()
 
 extern u16 pc;
 
-// Update for a single cycle
-void m8520::Execute()
+void m8520::ExecuteCycle()
 {
 	bool timerATimedOut = false;
 	bool timerBTimedOut = false;
+
+	CatchUp();
+
 	// In oneshot mode, the timer will count down from the latched value to zero, generate an interrupt, reload the latched value, then stop.
 	// In continuous mode, the timer will count from the latched value to zero, generate an interrupt, reload the latched value and repeat the procedure continuously.
 
@@ -341,6 +347,45 @@ void m8520::Execute()
 	CNTPinOld = CNTPin;
 	timerAReloaded = false;
 	timerBReloaded = false;
+
+	ScheduleQuietCycles();
+}
+
+// Work out how many cycles can pass before a timer underflows.
+// Nothing else happens on those cycles unless a register is accessed or the CNT pin changes.
+void m8520::ScheduleQuietCycles()
+{
+	unsigned cycles = 0xffff;
+
+	// PC is only asserted for a few cycles after a port B access so just let it run out.
+	// In the CNT modes the timers only count the CNT edges that ExecuteCycle makes on a timer A underflow.
+	// In the underflow modes timer B only counts on a timer A underflow.
+	if (!quietCyclesEnabled || PCAsserted)
+	{
+		cycles = 0;
+	}
+	else
+	{
+		// The timers underflow on the cycle they are decremented from 0.
+		if (timerAActive && timerAMode == TA_MODE_PHI2 && timerACounter < cycles)
+			cycles = timerACounter;
+		if (timerBActive && timerBMode == TB_MODE_PHI2 && timerBCounter < cycles)
+			cycles = timerBCounter;
+	}
+
+	quietCycles = cycles;
+	quietCyclesRemaining = cycles;
+}
+
+// Apply the cycles skipped by Execute as ExecuteCycle would have done.
+void m8520::CatchUpCounters(unsigned cycles)
+{
+	if (timerAActive && timerAMode == TA_MODE_PHI2)
+		timerACounter -= cycles;
+	if (timerBActive && timerBMode == TB_MODE_PHI2)
+		timerBCounter -= cycles;
+
+	quietCycles = quietCyclesRemaining;
 }
 
 void m8520::SetPinFLAG(bool value)	// Active low
@@ -358,6 +403,9 @@ void m8520::SetPinCNT(bool value)
 {
 	if (serialPortMode == SP_MODE_INPUT)
 	{
+		if (CNTPin != value)
+			EndQuietCycles();
+
 		if (!CNTPin && value)	// rising edge?
 		{
 			//DEBUG_LOG("C%d\r\n", serialBitsShiftedSoFar);
@@ -410,6 +458,8 @@ unsigned char m8520::Read(unsigned int address)
 {
 	unsigned char value = 0;
 
+	CatchUp();
+
 	switch (address & 0xf)
 	{
 		case ORA:
@@ -420,6 +470,7 @@ unsigned char m8520::Read(unsigned int address)
 			// The 8520 datasheet contradicts itself;-
 			// PC will go low forone cycle following a read orwrite of PORT B.
 			// PC will go low on the 3rd cycle after a PORT B access.
+			EndQuietCycles();
 			PCAsserted = 3;
 		break;
 		case DDRA:
@@ -491,6 +542,8 @@ unsigned char m8520::Peek(unsigned int address)
 {
 	unsigned char value = 0;
 
+	CatchUp();
+
 	switch (address & 0xf)
 	{
 		case ORA:
@@ -560,6 +613,7 @@ void m8520::Write(unsigned int address, unsigned char value)
 			// The 8520 datasheet contradicts itself;-
 			// PC will go low forone cycle following a read orwrite of PORT B.
 			// PC will go low on the 3rd cycle after a PORT B access.
+			EndQuietCycles();
 			PCAsserted = 3;
 			break;
 		case DDRA:
@@ -574,6 +628,7 @@ void m8520::Write(unsigned int address, unsigned char value)
 			timerALatch = (timerBLatch & 0xff00) | value;
 			break;
 		case TAHI:
+			EndQuietCycles();
 			timerALatch = (timerBLatch & 0xff) | (value << 8);
 			// In oneshot mode; a write to Timer High will transfer the timer latch to the counter and initiate counting regardless of the start bit.
 
@@ -589,6 +644,7 @@ void m8520::Write(unsigned int address, unsigned char value)
 			timerBLatch = (timerBLatch & 0xff00) | value;
 			break;
 		case TBHI:
+			EndQuietCycles();
 			timerBLatch = (timerBLatch & 0xff) | (value << 8);
 			// In oneshot mode; a write to Timer High will transfer the timer latch to the counter and initiate counting regardless of the start bit.
 
@@ -664,6 +720,8 @@ void m8520::Write(unsigned int address, unsigned char value)
 		{
 			unsigned char CRARegisterOld = CRARegister;
 
+			EndQuietCycles();
+
 			CRARegister = value;
 			if (CRARegister & CRA_START)
 			{
@@ -774,7 +832,7 @@ void m8520::Write(unsigned int address, unsigned char value)
 			break;
 		}
 		case CRB:
-			CRBRegister = value;
+			EndQuietCycles();
 
 			CRBRegister = value;
 			if (CRBRegister & CRB_START)
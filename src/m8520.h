@@ -131,7 +131,18 @@ public:
 	inline IOPort* GetPortA() { return &portA; }
 	inline IOPort* GetPortB() { return &portB; }
 
-	void Execute();
+	// Update for a single cycle
+	inline void Execute()
+	{
+		// Between timer underflows the only state that changes is the counters.
+		// So just count off the cycles and catch the counters up when they are next needed.
+		if (quietCyclesRemaining)
+		{
+			quietCyclesRemaining--;
+			return;
+		}
+		ExecuteCycle();
+	}
 
 	unsigned char Read(unsigned int address);
 	unsigned char Peek(unsigned int address);
@@ -145,7 +156,33 @@ public:
 	bool GetPinSP() const { return SPPin; }
 	void SetPinTOD(bool value);
 
+	// Turning the quiet cycles off runs every cycle in full (the host lockstep checks the two agree).
+	void SetQuietCyclesEnabled(bool enable)
+	{
+		EndQuietCycles();
+		quietCyclesEnabled = enable;
+	}
+
 //private:
+	void ExecuteCycle();
+	void ScheduleQuietCycles();
+
+	// Bring the counters up to date with the cycles counted off by Execute.
+	inline void CatchUp()
+	{
+		if (quietCycles != quietCyclesRemaining)
+			CatchUpCounters(quietCycles - quietCyclesRemaining);
+	}
+	void CatchUpCounters(unsigned cycles);
+
+	// Something the schedule depends on has changed so run the next cycle in full.
+	inline void EndQuietCycles()
+	{
+		CatchUp();
+		quietCycles = 0;
+		quietCyclesRemaining = 0;
+	}
+
 	inline unsigned char ReadPortB()
 	{
 		unsigned char ddr = portB.GetDirection();
@@ -287,6 +324,10 @@ public:
 	unsigned serialBitsShiftedSoFar;
 	bool serialShiftingEnabled;
 	//unsigned timerATimeOutCount;
+
+	unsigned quietCycles;			// The number of cycles, from the last full cycle, in which nothing but the counters can change.
+	unsigned quietCyclesRemaining;	// How many of those are still to be counted off by Execute.
+	bool quietCyclesEnabled;
 };
 
 #endif
\ No newline at end of file
@@ -43,6 +43,8 @@ extern "C"
 #include "FileBrowser.h"
 #include "ScreenLCD.h"
 #include "SpinLock.h"
+#include "TimingStats.h"
+#include "WorkQueue.h"
 
 #include "logo.h"
 #include "sample.h"
@@ -120,9 +122,8 @@ bool USBKeyboardDetected = false;
 //bool resetWhileEmulating = false;
 bool selectedViaIECCommands = false;
 u16 pc;
-#if defined(RPI2)
 u32 clockCycles1MHz;
-#endif
+TimingStats timingStats;
 
 #if not defined(EXPERIMENTALZERO)
 SpinLock core0RefreshingScreen;
@@ -241,12 +242,12 @@ extern "C"
 DWORD get_fattime() { return 0; }	// If you have hardware RTC return a correct value here. THis can then be reflected in file modification times/dates.
 
 extern u8 read6502(u16 address);
-extern u8 read6502ExtraRAM(u16 address);
 extern void write6502(u16 address, const u8 value);
-extern void write6502ExtraRAM(u16 address, const u8 value);
 extern u8 read6502_1581(u16 address);
 extern void write6502_1581(u16 address, const u8 value);
 
+void DisplayMessage(int x, int y, bool LCD, const char* message, u32 textColour, u32 backgroundColour);
+
 void InitialiseHardware()
 {
 #if defined(RPI3)
@@ -271,13 +272,10 @@ void InitialiseHardware()
 	RPI_PropertyAddTag(TAG_SET_CLOCK_RATE, ARM_CLK_ID, MaxClk);
 	RPI_PropertyProcess();
 
-#if defined(RPI2)
 	// Enable clock cycle counter
-	asm volatile ("mcr p15,0,%0,c9,c12,0" :: "r" (0b0001));
-	asm volatile ("mcr p15,0,%0,c9,c12,1" :: "r" ((1 << 31)));
+	enable_cycle_counter();
 
 	clockCycles1MHz = MaxClk / 1000000;
-#endif
 }
 
 void InitialiseLCD()
@@ -384,6 +382,14 @@ void UpdateLCD(const char* track, unsigned temperature)
 	}
 }
 
+static void ReportTimingStats(const char* name)
+{
+	TimingStatsSnapshot snapshot;
+
+	if (timingStats.Read(snapshot))
+		TimingStats::Dump(name, snapshot);
+}
+
 // This runs on core0 and frees up core1 to just run the emulator.
 // Care must be taken not to crowd out the shared cache with core1 as this could slow down core1 so that it no longer can perform its duties in the 1us timings it requires.
 void UpdateScreen()
@@ -402,6 +408,9 @@ void UpdateScreen()
 	u32 bgColour = COLOUR_WHITE;
 	u32 oldTemperature = 0;
 	u32 caddyIndexChangedTimer = 0;
+	u32 oldOverruns = 0;
+	u32 timingStatsReportedTime = 0;
+	u32 diskFlushTime = 0;
 
 	RGBA atnColour = COLOUR_YELLOW;
 	RGBA dataColour = COLOUR_GREEN;
@@ -603,6 +612,17 @@ void UpdateScreen()
 //#if not defined(EXPERIMENTALZERO)
 //			core0RefreshingScreen.Release();
 //#endif
+			diskCaddy.Prefetch();
+
+			if (options.DiskFlushInterval())
+			{
+				u32 now = read32(ARM_SYSTIMER_CLO);
+				if (now - diskFlushTime >= options.DiskFlushInterval() * 1000000)
+				{
+					diskFlushTime = now;
+					diskCaddy.Flush();
+				}
+			}
 
 			if (options.DisplayTemperature())
 			{
@@ -620,6 +640,25 @@ void UpdateScreen()
 				}
 			}
 
+			if (options.DisplayTimingStats())
+			{
+				TimingStatsSnapshot snapshot;
+				if (timingStats.Read(snapshot) && snapshot.overruns != oldOverruns)
+				{
+					oldOverruns = snapshot.overruns;
+					snprintf(tempBuffer, tempBufferSize, "Lost %d", snapshot.overruns);
+					screen.PrintText(false, 48 * 8, y, tempBuffer, snapshot.overruns ? COLOUR_RED : textColour, bgColour);
+
+					// The UART is slow so don't report more than once a second.
+					u32 now = read32(ARM_SYSTIMER_CLO);
+					if (now - timingStatsReportedTime >= 1000000)
+					{
+						timingStatsReportedTime = now;
+						TimingStats::Dump(emulating == EMULATING_1541 ? "1541" : "1581", snapshot);
+					}
+				}
+			}
+
 			if (caddyIndexChangedTimer == 0)
 			{
 				if (refreshLCDStatusDisplay)
@@ -666,24 +705,6 @@ static bool Snoop(u8 a)
 	return false;
 }
 
-//--------------------------------------------------------------------------------------
-// This is an implementation of FNV-1a
-// (http://www.isthe.com/chongo/tech/comp/fnv/)
-//--------------------------------------------------------------------------------------
-u32 HashBuffer(const void* pBuffer, u32 length)
-{
-	u8*	pu8Buffer = (u8*)pBuffer;
-	u32	hash = 0x811c9dc5U;
-
-	while (length)
-	{
-		hash ^= *pu8Buffer++;
-		hash *= 16777619U;
-		--length;
-	}
-	return hash;
-}
-
 EmulatingMode BeginEmulating(FileBrowser* fileBrowser, const char* filenameForIcon)
 {
 	DiskImage* diskImage = diskCaddy.SelectFirstImage();
@@ -777,12 +798,126 @@ void CheckAutoMountImage(EXIT_TYPE reset_reason , FileBrowser* fileBrowser)
 	}
 }
 
+// Report the result of a benchmark run on the UART and the screen.
+// The worst case cycle time is how close we came to losing a cycle; anything above 1000ns would have put cycle accuracy in jeopardy.
+static void ReportBenchmark(const char* drive, unsigned cycles, unsigned elapsedUS, u32 worstClockCycles, u16 worstPC)
+{
+	char buffer[128];
+	unsigned kHz = elapsedUS ? (unsigned)(((u64)cycles * 1000) / elapsedUS) : 0;
+	unsigned worstNS = clockCycles1MHz ? (unsigned)(((u64)worstClockCycles * 1000) / clockCycles1MHz) : 0;
+
+	snprintf(buffer, sizeof(buffer), "%s %d.%03dMHz worst %dns @ $%04X", drive, kHz / 1000, kHz % 1000, worstNS, worstPC);
+	printf("Benchmark %s %u cycles in %uus = %u cycles/s, worst cycle %uns (%u clocks) at PC=$%04X\r\n", drive, cycles, elapsedUS, kHz * 1000, worstNS, worstClockCycles, worstPC);
+
+#if not defined(EXPERIMENTALZERO)
+	DisplayMessage(240, 280, false, buffer, COLOUR_WHITE, COLOUR_BLACK);
+#endif
+	if (screenLCD)
+		DisplayMessage(0, 0, true, buffer, COLOUR_WHITE, COLOUR_BLACK);
+}
+
+// Run the same per cycle sequence as Emulate1541 but without syncing to the 1MHz clock.
+// This tells us how much headroom this Pi has for the mounted image and ROM.
+static void Benchmark1541(unsigned cycles, bool refreshOutsAfterCPUStep)
+{
+	unsigned cycle;
+	u32 ctBefore;
+	u32 ctAfter;
+	u32 ct;
+	u32 worst = 0;
+	u16 worstPC = 0;
+	u32 usBefore = read32(ARM_SYSTIMER_CLO);
+
+	ctBefore = read_cycle_counter();
+	for (cycle = 0; cycle < cycles; ++cycle)
+	{
+		if (refreshOutsAfterCPUStep)
+			IEC_Bus::ReadEmulationMode1541();
+
+		if (pi1541.m6502.SYNC())
+			pc = pi1541.m6502.GetPC();
+
+		pi1541.m6502.Step();
+
+		if (refreshOutsAfterCPUStep)
+			IEC_Bus::RefreshOuts1541();
+
+		IEC_Bus::OutputLED = pi1541.drive.IsLEDOn();
+		IEC_Bus::ReadGPIOUserInput();
+		inputMappings->CheckButtonsEmulationMode();
+
+		pi1541.Update();
+
+		if (!refreshOutsAfterCPUStep)
+		{
+			IEC_Bus::ReadEmulationMode1541();
+			IEC_Bus::RefreshOuts1541();
+		}
+
+		ctAfter = read_cycle_counter();
+		ct = ctAfter - ctBefore;
+		if (ct > worst)
+		{
+			worst = ct;
+			worstPC = pc;
+		}
+		ctBefore = ctAfter;
+	}
+
+	ReportBenchmark("1541", cycles, read32(ARM_SYSTIMER_CLO) - usBefore, worst, worstPC);
+}
+
+#if defined(PI1581SUPPORT)
+static void Benchmark1581(unsigned cycles)
+{
+	unsigned cycle;
+	u32 ctBefore;
+	u32 ctAfter;
+	u32 ct;
+	u32 worst = 0;
+	u16 worstPC = 0;
+	u32 usBefore = read32(ARM_SYSTIMER_CLO);
+
+	ctBefore = read_cycle_counter();
+	for (cycle = 0; cycle < cycles; ++cycle)
+	{
+		IEC_Bus::ReadEmulationMode1581();
+
+		for (int cycle2MHz = 0; cycle2MHz < 2; ++cycle2MHz)
+		{
+			if (pi1581.m6502.SYNC())
+				pc = pi1581.m6502.GetPC();
+			pi1581.m6502.Step();
+			pi1581.Update();
+		}
+
+		IEC_Bus::RefreshOuts1581();
+
+		IEC_Bus::OutputLED = pi1581.IsLEDOn();
+		IEC_Bus::ReadGPIOUserInput();
+		inputMappings->CheckButtonsEmulationMode();
+
+		ctAfter = read_cycle_counter();
+		ct = ctAfter - ctBefore;
+		if (ct > worst)
+		{
+			worst = ct;
+			worstPC = pc;
+		}
+		ctBefore = ctAfter;
+	}
+
+	ReportBenchmark("1581", cycles, read32(ARM_SYSTIMER_CLO) - usBefore, worst, worstPC);
+}
+#endif
+
 EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 {
 	EXIT_TYPE exitReason = EXIT_UNKNOWN;
 	bool oldLED = false;
 	unsigned ctBefore = 0;
 	unsigned ctAfter = 0;
+	unsigned ctCycleStart = 0;
 	int cycleCount = 0;
 	unsigned caddyIndex;
 	int headSoundCounter = 0;
@@ -807,10 +942,8 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 	// Force an update on all the buttons now before we start emulation mode. 
 	IEC_Bus::ReadBrowseMode();
 
-	bool extraRAM = options.GetExtraRAM();
-	DataBusReadFn dataBusRead = extraRAM ? read6502ExtraRAM : read6502;
-	DataBusWriteFn dataBusWrite = extraRAM ? write6502ExtraRAM : write6502;
-	pi1541.m6502.SetBusFunctions(dataBusRead, dataBusWrite);
+	pi1541.MapMemory(options.GetExtraRAM(), options.GetRAMBOard());
+	pi1541.m6502.PowerOn();
 
 	IEC_Bus::VIA = &pi1541.VIA[0];
 	IEC_Bus::port = pi1541.VIA[0].GetPortB();
@@ -849,13 +982,18 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 		cycleCount++;
 	}
 
+	if (options.BenchmarkCycles())
+		Benchmark1541(options.BenchmarkCycles(), refreshOutsAfterCPUStep);
+
 	// Self test code done. Begin realtime emulation.
 
 #if defined(RPI2)
 	asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctBefore));
 #else
 	ctBefore = read32(ARM_SYSTIMER_CLO);
+	ctCycleStart = read_cycle_counter();
 #endif
+	timingStats.Reset(clockCycles1MHz);
 
 	while (exitReason == EXIT_UNKNOWN)
 	{
@@ -947,23 +1085,22 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 				exitReason = EXIT_AUTOLOAD;
 		}
 
+		// If this cycle took too long (ie >1us) then we have lost a cycle and cycle accuracy is now in jeopardy.
+		// If this occurs during critical communication loops then emulation can fail! timingStats records when it happens.
 #if defined(RPI2)
-		do  // Sync to the 1MHz clock
+		asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
+		timingStats.Cycle(ctAfter - ctBefore, pc);
+		while ((ctAfter - ctBefore) < clockCycles1MHz)	// Sync to the 1MHz clock
 		{
 			asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
-		} while ((ctAfter - ctBefore) < clockCycles1MHz);
+		}
 #else
+		timingStats.Cycle(read_cycle_counter() - ctCycleStart, pc);
 		do	// Sync to the 1MHz clock
 		{
 			ctAfter = read32(ARM_SYSTIMER_CLO);
-			unsigned ct = ctAfter - ctBefore;
-			if (ct > 1)
-			{
-				// If this ever occurs then we have taken too long (ie >1us) and lost a cycle.
-				// Cycle accuracy is now in jeopardy. If this occurs during critical communication loops then emulation can fail!
-				//DEBUG_LOG("!");
-			}
 		} while (ctAfter == ctBefore);
+		ctCycleStart = read_cycle_counter();
 #endif
 		ctBefore = ctAfter;
 		
@@ -1007,21 +1144,28 @@ EXIT_TYPE Emulate1541(FileBrowser* fileBrowser)
 			{
 				for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
 				{
-					if (inputMappings->directDiskSwapRequest & (1 << caddyIndex))
+					if ((inputMappings->directDiskSwapRequest & (1 << caddyIndex)) && caddyIndex != diskCaddy.GetSelectedIndex())
 					{
-						DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
-						if (diskImage && diskImage != pi1541.drive.GetDiskImage())
-						{
-							pi1541.drive.Insert(diskImage);
-							break;
-						}
+						pi1541.drive.Insert(diskCaddy.SelectImage(caddyIndex));
+						break;
 					}
 				}
 				inputMappings->directDiskSwapRequest = 0;
 			}
+			else if (diskCaddy.IsImagePending())
+			{
+				// The drive was left empty as core0 had not finished preparing the image. Insert it once it has.
+				DiskImage* diskImage = diskCaddy.GetCurrentDisk();
+				if (diskImage)
+					pi1541.drive.Insert(diskImage);
+			}
 #endif
 		}
 	}
+
+	timingStats.Publish();
+	if (options.DisplayTimingStats())
+		ReportTimingStats("1541");
 	return exitReason;
 }
 
@@ -1032,6 +1176,7 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 	bool oldLED = false;
 	unsigned ctBefore = 0;
 	unsigned ctAfter = 0;
+	unsigned ctCycleStart = 0;
 	int cycleCount = 0;
 	unsigned caddyIndex;
 	int headSoundCounter = 0;
@@ -1056,19 +1201,23 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 	// Force an update on all the buttons now before we start emulation mode. 
 	IEC_Bus::ReadBrowseMode();
 
-	DataBusReadFn dataBusRead = read6502_1581;
-	DataBusWriteFn dataBusWrite = write6502_1581;
-	pi1581.m6502.SetBusFunctions(dataBusRead, dataBusWrite);
+	pi1581.MapMemory();
+	pi1581.m6502.PowerOn();
 
 	IEC_Bus::CIA = &pi1581.CIA;
 	IEC_Bus::port = pi1581.CIA.GetPortB();
 	pi1581.Reset();	// will call IEC_Bus::Reset();
 
+	if (options.BenchmarkCycles())
+		Benchmark1581(options.BenchmarkCycles());
+
 #if defined(RPI2)
 	asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctBefore));
 #else
 	ctBefore = read32(ARM_SYSTIMER_CLO);
+	ctCycleStart = read_cycle_counter();
 #endif
+	timingStats.Reset(clockCycles1MHz);
 
 	//resetWhileEmulating = false;
 	selectedViaIECCommands = false;
@@ -1157,23 +1306,22 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 				exitReason = EXIT_AUTOLOAD;
 		}
 
+		// If this cycle took too long (ie >1us) then we have lost a cycle and cycle accuracy is now in jeopardy.
+		// If this occurs during critical communication loops then emulation can fail! timingStats records when it happens.
 #if defined(RPI2)
-		do  // Sync to the 1MHz clock
+		asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
+		timingStats.Cycle(ctAfter - ctBefore, pc);
+		while ((ctAfter - ctBefore) < clockCycles1MHz)	// Sync to the 1MHz clock
 		{
 			asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (ctAfter));
-		} while ((ctAfter - ctBefore) < clockCycles1MHz);
+		}
 #else
+		timingStats.Cycle(read_cycle_counter() - ctCycleStart, pc);
 		do	// Sync to the 1MHz clock
 		{
 			ctAfter = read32(ARM_SYSTIMER_CLO);
-			unsigned ct = ctAfter - ctBefore;
-			if (ct > 1)
-			{
-				// If this ever occurs then we have taken too long (ie >1us) and lost a cycle.
-				// Cycle accuracy is now in jeopardy. If this occurs during critical communication loops then emulation can fail!
-				//DEBUG_LOG("!");
-			}
 		} while (ctAfter == ctBefore);
+		ctCycleStart = read_cycle_counter();
 #endif
 		ctBefore = ctAfter;
 
@@ -1211,22 +1359,29 @@ EXIT_TYPE Emulate1581(FileBrowser* fileBrowser)
 			{
 				for (caddyIndex = 0; caddyIndex < numberOfImagesMax; ++caddyIndex)
 				{
-					if (inputMappings->directDiskSwapRequest & (1 << caddyIndex))
+					if ((inputMappings->directDiskSwapRequest & (1 << caddyIndex)) && caddyIndex != diskCaddy.GetSelectedIndex())
 					{
-						DiskImage* diskImage = diskCaddy.SelectImage(caddyIndex);
-						if (diskImage && diskImage != pi1581.GetDiskImage())
-						{
-							pi1581.Insert(diskImage);
-							break;
-						}
+						pi1581.Insert(diskCaddy.SelectImage(caddyIndex));
+						break;
 					}
 				}
 				inputMappings->directDiskSwapRequest = 0;
 			}
+			else if (diskCaddy.IsImagePending())
+			{
+				// The drive was left empty as core0 had not finished preparing the image. Insert it once it has.
+				DiskImage* diskImage = diskCaddy.GetCurrentDisk();
+				if (diskImage)
+					pi1581.Insert(diskImage);
+			}
 #endif
 		}
 
 	}
+
+	timingStats.Publish();
+	if (options.DisplayTimingStats())
+		ReportTimingStats("1581");
 	return exitReason;
 }
 #endif
@@ -1248,6 +1403,7 @@ void emulator()
 	m_IEC_Commands.SetAutoBootFB128(options.AutoBootFB128());
 	m_IEC_Commands.Set128BootSectorName(options.Get128BootSectorName());
 	m_IEC_Commands.SetLowercaseBrowseModeFilenames(options.LowercaseBrowseModeFilenames());
+	m_IEC_Commands.SetJiffyDOS(options.BrowseModeJiffyDOS());
 	m_IEC_Commands.SetNewDiskType(options.GetNewDiskType());
 
 	emulating = IEC_COMMANDS;
@@ -1387,12 +1543,18 @@ void emulator()
 		}
 		else
 		{
+#if not defined(EXPERIMENTALZERO)
+			diskCaddy.AllowFlush();
+#endif
 			if (emulating == EMULATING_1541)
 				exitReason = Emulate1541(fileBrowser);
 #if defined(PI1581SUPPORT)
 			else
 				exitReason = Emulate1581(fileBrowser);
 #endif
+#if not defined(EXPERIMENTALZERO)
+			diskCaddy.DisallowFlush();
+#endif
 
 			DEBUG_LOG("Exited emulation\r\n");
 
@@ -1434,10 +1596,20 @@ extern "C"
 	{
 		enable_MMU_and_IDCaches();
 		_enable_unaligned_access();
+		enable_cycle_counter();	// Each core has its own cycle counter.
 
 		DEBUG_LOG("emulator running on core %d\r\n", _get_core());
 		emulator();
 	}
+
+	void run_worker_core()
+	{
+		enable_MMU_and_IDCaches();
+		_enable_unaligned_access();
+		enable_cycle_counter();
+
+		WorkQueue::RunWorker();
+	}
 }
 static void start_core(int core, func_ptr func)
 {
@@ -1984,19 +2156,26 @@ extern "C"
 		GlobalSetDeviceID(deviceID);
 
 		pi1541.drive.SetVIA(&pi1541.VIA[1]);
+#if !defined(EXPERIMENTALZERO)
+		pi1541.drive.SetFluxEngine(options.FluxEngine() != 0);
+#endif
+		DiskImage::SetGCRCacheFolder(options.GetGCRCacheFolder());
 		pi1541.VIA[0].GetPortB()->SetPortOut(0, IEC_Bus::PortB_OnPortOut);
 		IEC_Bus::Initialise();
 		if (screenLCD)
 			screenLCD->ClearInit(0);
 
 #ifdef HAS_MULTICORE
-		start_core(3, _spin_core);
-		start_core(2, _spin_core);
 #ifdef USE_MULTICORE
+		// Cores 2 and 3 help out with work like extracting a NIB's tracks while it is mounted.
+		start_core(3, _init_worker_core);
+		start_core(2, _init_worker_core);
 		start_core(1, _init_core);
 		UpdateScreen();		// core0 now loops here where it will handle interrupts and passively update the screen.
 		while (1);
 #else
+		start_core(3, _spin_core);
+		start_core(2, _spin_core);
 		start_core(1, _spin_core);
 #endif
 #endif
@@ -141,7 +141,12 @@ Options::Options(void)
 	, ignoreReset(0)
 	, autoBootFB128(0)
 	, displayTemperature(0)
+	, displayTimingStats(0)
+	, benchmarkCycles(0)
+	, fluxEngine(0)
+	, diskFlushInterval(5)
 	, lowercaseBrowseModeFilenames(0)
+	, browseModeJiffyDOS(0)
 	, screenWidth(1024)
 	, screenHeight(768)
 	, i2cBusMaster(1)
@@ -162,6 +167,7 @@ Options::Options(void)
 	, rotaryEncoderInvert(0) //ROTARY:
 {
 	autoMountImageName[0] = 0;
+	GCRCacheFolder[0] = 0;
 	strcpy(ROMFontName, "chargen");
 	strcpy(LcdLogoName, "1541ii");
 	strcpy(autoBaseName, "autoname");
@@ -212,6 +218,10 @@ void Options::Process(char* buffer)
 		{
 			strncpy(autoMountImageName, pValue, 255);
 		}
+		else if ((strcasecmp(pOption, "GCRCacheFolder") == 0))
+		{
+			strncpy(GCRCacheFolder, pValue, 255);
+		}
 		ELSE_CHECK_DECIMAL_OPTION(deviceID)
 		ELSE_CHECK_DECIMAL_OPTION(onResetChangeToStartingFolder)
 		ELSE_CHECK_DECIMAL_OPTION(extraRAM)
@@ -231,8 +241,13 @@ void Options::Process(char* buffer)
 		ELSE_CHECK_DECIMAL_OPTION(splitIECLines)
 		ELSE_CHECK_DECIMAL_OPTION(ignoreReset)
 		ELSE_CHECK_DECIMAL_OPTION(lowercaseBrowseModeFilenames)
+		ELSE_CHECK_DECIMAL_OPTION(browseModeJiffyDOS)
 		ELSE_CHECK_DECIMAL_OPTION(autoBootFB128)
 		ELSE_CHECK_DECIMAL_OPTION(displayTemperature)
+		ELSE_CHECK_DECIMAL_OPTION(displayTimingStats)
+		ELSE_CHECK_DECIMAL_OPTION(benchmarkCycles)
+		ELSE_CHECK_DECIMAL_OPTION(fluxEngine)
+		ELSE_CHECK_DECIMAL_OPTION(diskFlushInterval)
 		ELSE_CHECK_DECIMAL_OPTION(screenWidth)
 		ELSE_CHECK_DECIMAL_OPTION(screenHeight)
 		ELSE_CHECK_DECIMAL_OPTION(i2cBusMaster)
@@ -320,6 +335,10 @@ void Options::Process(char* buffer)
 		}
 	}
 
+	// The flush interval is timed in microseconds on the 32 bit system timer, which wraps after 4294 seconds.
+	if (diskFlushInterval > 4294)
+		diskFlushInterval = 4294;
+
 	if (!SplitIECLines())
 	{
 		invertIECInputs = false;
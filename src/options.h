@@ -50,6 +50,7 @@ public:
 	inline unsigned int GetDeviceID() const { return deviceID; }
 	inline unsigned int GetOnResetChangeToStartingFolder() const { return onResetChangeToStartingFolder; }
 	inline const char* GetAutoMountImageName() const { return autoMountImageName; }
+	inline const char* GetGCRCacheFolder() const { return GCRCacheFolder; }
 	inline const char* GetRomFontName() const { return ROMFontName; }
 	const char* GetRomName(int index) const;
 	const char* GetRomName1581() const;
@@ -76,8 +77,14 @@ public:
 	inline const char* Get128BootSectorName() const { return C128BootSectorName; }
 
 	inline unsigned int DisplayTemperature() const { return displayTemperature; }
+	inline unsigned int DisplayTimingStats() const { return displayTimingStats; }
+
+	inline unsigned int BenchmarkCycles() const { return benchmarkCycles; }
+	inline unsigned int FluxEngine() const { return fluxEngine; }
+	inline unsigned int DiskFlushInterval() const { return diskFlushInterval; }
 
 	inline unsigned int LowercaseBrowseModeFilenames() const { return lowercaseBrowseModeFilenames; }
+	inline unsigned int BrowseModeJiffyDOS() const { return browseModeJiffyDOS; }
 	DiskImage::DiskType GetNewDiskType() const;
 
 	inline unsigned int ScreenWidth() const { return screenWidth; }
@@ -141,8 +148,13 @@ private:
 	unsigned int autoBootFB128;
 
 	unsigned int displayTemperature;
+	unsigned int displayTimingStats;
+	unsigned int benchmarkCycles;
+	unsigned int fluxEngine;
+	unsigned int diskFlushInterval;
 
 	unsigned int lowercaseBrowseModeFilenames;
+	unsigned int browseModeJiffyDOS;
 
 	unsigned int screenWidth;
 	unsigned int screenHeight;
@@ -174,6 +186,7 @@ private:
 	char LcdLogoName[256];
 
 	char autoMountImageName[256];
+	char GCRCacheFolder[256];
 	char ROMFontName[256];
 	char ROMName[256];
 	char ROMNameSlot2[256];
@@ -136,6 +136,23 @@ extern "C" {
 #endif
 #include "rpi-mailbox-interface.h"
 
+#if defined(HOST_BUILD)
+	// When building for the host there are no peripherals at these addresses.
+	// Accesses are routed through the HAL (see host/hal.h) which emulates the GPIO and system timer registers.
+	u32 HAL_Read32(unsigned int nAddress);
+	void HAL_Write32(unsigned int nAddress, u32 nValue);
+	u32 HAL_ReadCycleCounter(void);
+
+	static inline u32 read32(unsigned int nAddress)
+	{
+		return HAL_Read32(nAddress);
+	}
+
+	static inline void write32(unsigned int nAddress, u32 nValue)
+	{
+		HAL_Write32(nAddress, nValue);
+	}
+#else
 	static inline u32 read32(unsigned int nAddress)
 	{
 		return *(u32 volatile *)nAddress;
@@ -145,6 +162,7 @@ extern "C" {
 	{
 		*(u32 volatile *)nAddress = nValue;
 	}
+#endif
 
 	static inline void delay_us(u32 amount)
 	{
@@ -163,6 +181,32 @@ extern "C" {
 		}
 	}
 
+	// The ARM's clock cycle counter is used to time things at a finer resolution than the 1MHz system timer.
+	static inline void enable_cycle_counter(void)
+	{
+#if defined(HOST_BUILD)
+#elif defined(RPI2) || defined(RPI3)
+		asm volatile ("mcr p15,0,%0,c9,c12,0" :: "r" (0b0001));
+		asm volatile ("mcr p15,0,%0,c9,c12,1" :: "r" ((1 << 31)));
+#else
+		// ARM1176 performance monitor control register; enable and reset the cycle counter (not divided by 64)
+		asm volatile ("mcr p15,0,%0,c15,c12,0" :: "r" (0b0101));
+#endif
+	}
+
+	static inline u32 read_cycle_counter(void)
+	{
+		u32 count;
+#if defined(HOST_BUILD)
+		count = HAL_ReadCycleCounter();
+#elif defined(RPI2) || defined(RPI3)
+		asm volatile ("mrc p15,0,%0,c9,c13,0" : "=r" (count));
+#else
+		asm volatile ("mrc p15,0,%0,c15,c12,1" : "=r" (count));
+#endif
+		return count;
+	}
+
 	static inline int get_clock_rate(int clk_id)
 	{
 		rpi_mailbox_property_t *buf;
@@ -187,7 +231,13 @@ extern "C" {
 //DMB - It prevents reordering of data accesses instructions across itself. All data accesses by this processor / core before the DMB will be visible to all other masters within the specified shareability domain before any of the data accesses after it.
 //		It also ensures that any explicit preceding data(or unified) cache maintenance operations have completed before any subsequent data accesses are executed.
 
-#if defined(RPI2) || defined(RPI3)
+#if defined(HOST_BUILD)
+	#define DataSyncBarrier()	__sync_synchronize()
+	#define DataMemBarrier() 	__sync_synchronize()
+
+	#define InstructionSyncBarrier()
+	#define InstructionMemBarrier()
+#elif defined(RPI2) || defined(RPI3)
 	#define DataSyncBarrier()	asm volatile ("dsb" ::: "memory")
 	#define DataMemBarrier() 	asm volatile ("dmb" ::: "memory")
 
@@ -40,6 +40,8 @@ extern unsigned int _get_core();
 
 extern void _init_core();
 
+extern void _init_worker_core();
+
 extern void _spin_core();
 
 #ifdef HAS_40PINS
@@ -1375,5 +1375,5 @@ unsigned char WD177x::GetDataRegister()
 void WD177x::Insert(DiskImage* diskImage)
 {
 	this->diskImage = diskImage;
-	writeProtectAsserted = diskImage->GetReadOnly();
+	writeProtectAsserted = diskImage == 0 || diskImage->GetReadOnly();
 }